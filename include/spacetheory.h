@@ -5,4 +5,21 @@
 #include "..\src\third-party\logger\logger.h"
 #include "..\src\application.h"
 #include "..\src\display.h"
-#include "..\src\graphics2d.h"
\ No newline at end of file
+#include "..\src\graphics2d.h"
+#include "..\src\profiler.h"
+#include "..\src\async_log.h"
+#include "..\src\logging.h"
+#include "..\src\job_system.h"
+#include "..\src\graphics2d_command_list.h"
+#include "..\src\layer.h"
+#include "..\src\scene2d.h"
+#include "..\src\render_target_pool.h"
+#include "..\src\gl_state_cache.h"
+#include "..\src\render_device.h"
+#include "..\src\cpu_features.h"
+#include "..\src\rect_batch.h"
+#include "..\src\point_batch.h"
+#include "..\src\uniform_grid.h"
+#include "..\src\loose_quadtree.h"
+#include "..\src\region.h"
+#include "..\src\color_convert.h"
\ No newline at end of file
@@ -11,7 +11,12 @@
 #include "error.h"
 #include <unordered_map>
 #include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <numeric>
+#include <vector>
 #include "graphics2d.h"
+#include "logging.h"
 
 namespace spacetheory {
     application * application::s_app = nullptr;
@@ -19,6 +24,16 @@ namespace spacetheory {
 
 using namespace spacetheory;
 
+static std::string gl_attribute_value(const SDL_GLattr attr, const int value)
+{
+    switch (attr) {
+    case SDL_GL_CONTEXT_FLAGS: return sdltools::SDL_GLcontextFlagToString(value);
+    case SDL_GL_CONTEXT_PROFILE_MASK: return sdltools::SDL_GLprofileToString(value);
+    case SDL_GL_CONTEXT_RELEASE_BEHAVIOR: return sdltools::SDL_GLcontextReleaseFlagToString(value);
+    default: return std::to_string(value);
+    }
+}
+
 application::application()
 {
 #ifdef _WIN32
@@ -75,12 +90,33 @@ application::application()
 
     // NORMAL LOGGING BEGINS:
     xeekworx::log.set_msgonly(false);
-    xeekworx::log << LOGSTAMP << xeekworx::DEBUG2 << "Application constructed" << std::endl;
+
+    // FRAME PROFILER:
+    // Created early so that scopes are recorded from the very first frame, GPU
+    // queries are added once the OpenGL context exists.
+    m_profiler = std::make_unique<spacetheory::profiler>();
+
+    // ASYNCHRONOUS LOG:
+    // For anything logged from the game loop or other threads; xeekworx::log
+    // writes and flushes the file on every line, which is fine for startup and
+    // shutdown but not once per frame. It has its own file since engine.log
+    // belongs to xeekworx::log.
+    spacetheory::async_log::config async_config;
+    async_config.file = SPACETHEORY_ASYNC_LOGFILE;
+#ifdef _DEBUG
+    async_config.level = log_level::debug2;
+#endif
+    m_async_log = std::make_unique<spacetheory::async_log>(async_config);
+    if (!m_async_log->is_open()) {
+        xeekworx::log << LOGSTAMP << xeekworx::logtype::WARNING << "Failed to open " << SPACETHEORY_ASYNC_LOGFILE << std::endl;
+    }
+
+    SPACETHEORY_LOG(log_level::debug2) << "Application constructed" << std::endl;
 }
 
 application::~application()
 {
-    xeekworx::log << LOGSTAMP << xeekworx::DEBUG2 << "Application destructed" << std::endl;
+    SPACETHEORY_LOG(log_level::debug2) << "Application destructed" << std::endl;
 }
 
 int application::run(int argc, char *argv[])
@@ -161,14 +197,30 @@ int application::run(int argc, char *argv[])
 
     // SHUTDOWN:
     auto start_shutdown_clock = tools::clock::now();
+
+    // Anything owning OpenGL objects has to go before the context does:
+    g.reset();
+    m_device.reset();
+    m_profiler->shutdown_gpu();
+
     xeekworx::log << LOGSTAMP << xeekworx::logtype::NOTICE << "Destroying display (game window) ..." << std::endl;
     if (m_display) { // Destroy the game window
+        const gl_state_cache::stats& gl_stats = m_display->gl_state()->get_total_stats();
+        SPACETHEORY_LOG(log_level::debug) << "GL state cache: " << gl_stats.calls << " state changes made, "
+            << gl_stats.avoided << " redundant ones avoided, " << gl_stats.queries << " queries" << std::endl;
+
         delete m_display;
         m_display = nullptr;
     }
     xeekworx::log << LOGSTAMP << xeekworx::logtype::NOTICE << "Shutting down APIs ..." << std::endl;
+    m_jobs.reset();
     shutdown_apis();
 
+    m_async_log->flush();
+    const spacetheory::async_log::stats log_stats = m_async_log->get_stats();
+    xeekworx::log << LOGSTAMP << xeekworx::logtype::DEBUG << "Async log: " << log_stats.written << " messages written in "
+        << log_stats.batches << " batches from " << log_stats.threads << " threads (" << log_stats.rings << " rings), " << log_stats.dropped << " dropped" << std::endl;
+
     xeekworx::log << LOGSTAMP << "Shutdown took " << tools::friendly_duration(start_shutdown_clock, tools::clock::now()) << " to complete" << std::endl;
 
     // STOPWATCH:
@@ -206,7 +258,11 @@ bool application::setup_apis1()
     }
     else xeekworx::log << LOGSTAMP << xeekworx::DEBUG << "SDL Initialized Successfully" << std::endl;
 
-
+    // START THE JOB SYSTEM:
+    // A worker per core, the main thread being the remaining one.
+    const int cores = SDL_GetCPUCount();
+    m_jobs = std::make_unique<job_system>(cores > 1 ? (unsigned) cores - 1 : 1u);
+    xeekworx::log << LOGSTAMP << xeekworx::DEBUG << "Job system started with " << m_jobs->thread_count() << " worker threads" << std::endl;
 
     return true;
 }
@@ -238,21 +294,17 @@ bool application::setup_apis2(const graphics_setup& gfx_setup)
     attributes[SDL_GL_DOUBLEBUFFER] = 1;
     attributes[SDL_GL_MULTISAMPLEBUFFERS] = gfx_setup.msaa ? 1 : 0;
     attributes[SDL_GL_MULTISAMPLESAMPLES] = gfx_setup.msaa_samples;
+    attributes[SDL_GL_FRAMEBUFFER_SRGB_CAPABLE] = gfx_setup.srgb_framebuffer ? 1 : 0;
     //attributes[SDL_GL_SHARE_WITH_CURRENT_CONTEXT] = 1;
 
     xeekworx::log << LOGSTAMP << xeekworx::DEBUG << "Configuring OpenGL Attributes ... " << std::endl;
     for (auto i = attributes.begin(); i != attributes.end(); ++i) {
-        result |= (0 != SDL_GL_SetAttribute((*i).first, (*i).second));
-        if (!result) xeekworx::log << LOGSTAMP << xeekworx::WARNING << "> FAIL : ";
-        else xeekworx::log << LOGSTAMP << xeekworx::DEBUG2 << "> OK : ";
-        xeekworx::log << std::setw(30) << std::left << sdltools::SDL_GLattrToString((*i).first) << " = ";
-        switch ((*i).first) {
-        case SDL_GL_CONTEXT_FLAGS: xeekworx::log << sdltools::SDL_GLcontextFlagToString((*i).second); break;
-        case SDL_GL_CONTEXT_PROFILE_MASK: xeekworx::log << sdltools::SDL_GLprofileToString((*i).second); break;
-        case SDL_GL_CONTEXT_RELEASE_BEHAVIOR: xeekworx::log << sdltools::SDL_GLcontextReleaseFlagToString((*i).second); break;
-        default: xeekworx::log << (*i).second; break;
-        }
-        xeekworx::log << std::endl;
+        const bool ok = 0 == SDL_GL_SetAttribute((*i).first, (*i).second);
+        if (!ok) result = false;
+        // Logged as one line so the whole line is skipped when its level is off:
+        SPACETHEORY_LOG(ok ? log_level::debug2 : log_level::warning) << (ok ? "> OK : " : "> FAIL : ")
+            << std::setw(30) << std::left << sdltools::SDL_GLattrToString((*i).first) << " = "
+            << gl_attribute_value((*i).first, (*i).second) << std::endl;
     }
 
     return result;
@@ -272,7 +324,6 @@ bool application::setup_apis3(const graphics_setup& gfx_setup)
     }
     else {
         m_display->m_glcontext = new_glcontext;
-        m_display->make_current();
         xeekworx::log << LOGSTAMP << xeekworx::DEBUG << "OpenGL context created successfully" << std::endl;
     }
 
@@ -292,20 +343,26 @@ bool application::setup_apis3(const graphics_setup& gfx_setup)
     attributes[SDL_GL_DOUBLEBUFFER] = 0;
     attributes[SDL_GL_MULTISAMPLEBUFFERS] = 0;
     attributes[SDL_GL_MULTISAMPLESAMPLES] = 0;
+    attributes[SDL_GL_FRAMEBUFFER_SRGB_CAPABLE] = 0;
     //attributes[SDL_GL_SHARE_WITH_CURRENT_CONTEXT] = 0;
     xeekworx::log << LOGSTAMP << xeekworx::DEBUG << "Actual OpenGL Attributes: " << std::endl;
     for (auto i = attributes.begin(); i != attributes.end(); ++i) {
-        result |= (0 != SDL_GL_GetAttribute((*i).first, &(*i).second));
-        if (!result) xeekworx::log << LOGSTAMP << xeekworx::WARNING << "> FAIL : ";
-        else xeekworx::log << LOGSTAMP << xeekworx::DEBUG2 << "> OK : ";
-        xeekworx::log << std::setw(30) << std::left << sdltools::SDL_GLattrToString((*i).first) << " = ";
-        switch ((*i).first) {
-        case SDL_GL_CONTEXT_FLAGS: xeekworx::log << sdltools::SDL_GLcontextFlagToString((*i).second); break;
-        case SDL_GL_CONTEXT_PROFILE_MASK: xeekworx::log << sdltools::SDL_GLprofileToString((*i).second); break;
-        case SDL_GL_CONTEXT_RELEASE_BEHAVIOR: xeekworx::log << sdltools::SDL_GLcontextReleaseFlagToString((*i).second); break;
-        default: xeekworx::log << (*i).second; break;
-        }
-        xeekworx::log << std::endl;
+        // Only informational, a value that can't be read back doesn't fail the stage:
+        const bool ok = 0 == SDL_GL_GetAttribute((*i).first, &(*i).second);
+        // Logged as one line so the whole line is skipped when its level is off:
+        SPACETHEORY_LOG(ok ? log_level::debug2 : log_level::warning) << (ok ? "> OK : " : "> FAIL : ")
+            << std::setw(30) << std::left << sdltools::SDL_GLattrToString((*i).first) << " = "
+            << gl_attribute_value((*i).first, (*i).second) << std::endl;
+    }
+
+    // SRGB FRAMEBUFFER:
+    // Only asked for, the context may not have one. Linear blending into a
+    // framebuffer that doesn't encode would come out too dark, so everything
+    // goes with what the context actually has, headless target included:
+    bool linear = gfx_setup.srgb_framebuffer;
+    if (linear && attributes[SDL_GL_FRAMEBUFFER_SRGB_CAPABLE] != 1) {
+        SPACETHEORY_LOG(log_level::warning) << "No sRGB capable framebuffer, blending in sRGB space instead of linear" << std::endl;
+        linear = false;
     }
 
     // INITIALIZE GLAD:
@@ -319,6 +376,14 @@ bool application::setup_apis3(const graphics_setup& gfx_setup)
         xeekworx::log << LOGSTAMP << xeekworx::DEBUG << "GLAD initialized successfully" << std::endl;
     }
 
+    // HEADLESS RENDER TARGET:
+    // Needs GLAD, and has to exist before make_current binds it.
+    if (!m_display->create_offscreen_target(linear)) {
+        xeekworx::log << LOGSTAMP << xeekworx::FATAL << "Failed to create the headless render target" << std::endl;
+        return false;
+    }
+    m_display->make_current();
+
     // LOG OPENGL VERSION, VENDOR (IMPLEMENTATION), RENDERER, GLSL, ETC.:
     xeekworx::log << LOGSTAMP << xeekworx::NOTICE << std::setw(34) << std::left << "OpenGL Version: " << GLVersion.major << "." << GLVersion.minor << std::endl;
     xeekworx::log << LOGSTAMP << xeekworx::NOTICE << std::setw(34) << std::left << "OpenGL Shading Language Version: " << (char *)glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
@@ -347,20 +412,23 @@ bool application::setup_apis3(const graphics_setup& gfx_setup)
     //parameters.push_back(gl_param { "GL_MAX_LIGHTS", GL_MAX_LIGHTS, 1, true }); // For GL 4+
     parameters.push_back(gl_param{ "GL_VIEWPORT", GL_VIEWPORT, 4, true });
 
-    xeekworx::log << LOGSTAMP << xeekworx::DEBUG2 << "OpenGL Context Parameters: " << std::endl;
-    for (auto i = parameters.begin(); i != parameters.end(); ++i) {
-        xeekworx::log << LOGSTAMP << xeekworx::DEBUG2 << "> " << std::setw(35) << std::left << (*i).name << " = ";
-        std::vector<GLint> values((*i).num_values);
-        glGetIntegerv((*i).param, values.data());
-        if (glGetError() != GL_NO_ERROR) xeekworx::log << "ERROR";
-        else {
-            for (auto v = values.begin(); v != values.end(); v++) {
-                if ((*i).num_values > 1 && v != values.begin()) xeekworx::log << ", ";
-                if ((*i).integer) xeekworx::log << (*v);
-                else xeekworx::log << ((*v) ? "TRUE" : "FALSE");
+    // Only queried at all when they'll be logged:
+    if (SPACETHEORY_LOG_ENABLED(log_level::debug2)) {
+        SPACETHEORY_LOG(log_level::debug2) << "OpenGL Context Parameters: " << std::endl;
+        for (auto i = parameters.begin(); i != parameters.end(); ++i) {
+            std::vector<GLint> values((*i).num_values);
+            glGetIntegerv((*i).param, values.data());
+            std::ostringstream line;
+            if (glGetError() != GL_NO_ERROR) line << "ERROR";
+            else {
+                for (auto v = values.begin(); v != values.end(); v++) {
+                    if ((*i).num_values > 1 && v != values.begin()) line << ", ";
+                    if ((*i).integer) line << (*v);
+                    else line << ((*v) ? "TRUE" : "FALSE");
+                }
             }
+            SPACETHEORY_LOG(log_level::debug2) << "> " << std::setw(35) << std::left << (*i).name << " = " << line.str() << std::endl;
         }
-        xeekworx::log << std::endl;
     }
 
     // LOG OPENGL ERRORS:
@@ -370,10 +438,15 @@ bool application::setup_apis3(const graphics_setup& gfx_setup)
     if (SDL_GL_SetSwapInterval(gfx_setup.vsync ? 1 : 0) < 0) {
         xeekworx::log << LOGSTAMP << xeekworx::WARNING << "Unable to " << (gfx_setup.vsync ? "enable" : "disable") << " VSync. SDL Error: \"" << SDL_GetError() << "\"" << std::endl;
     }
-    else xeekworx::log << LOGSTAMP << xeekworx::DEBUG2 << (gfx_setup.vsync ? "Enabled Vertical Sync" : "Disabled Vertical Sync") << std::endl;
+    else SPACETHEORY_LOG(log_level::debug2) << (gfx_setup.vsync ? "Enabled Vertical Sync" : "Disabled Vertical Sync") << std::endl;
 
 
-    g = std::make_unique<graphics2d>();
+    // GPU PROFILING:
+    m_profiler->init_gpu();
+
+    // 2D RENDERING:
+    m_device = std::make_unique<render_device>(linear);
+    g = std::make_unique<graphics2d>(*m_device);
 
     return result;
 }
@@ -401,22 +474,140 @@ bool application::check_glerrors(bool log)
 void application::shutdown()
 {
     m_should_quit = true;
-    xeekworx::log << LOGSTAMP << xeekworx::DEBUG2 << "Shutdown called!" << std::endl;
+    SPACETHEORY_LOG(log_level::debug2) << "Shutdown called!" << std::endl;
 }
 
 void application::game_loop()
 {
     xeekworx::log << LOGSTAMP << xeekworx::NOTICE << "Game Loop Started" << std::endl;
 
+    // LOOP TIMING:
+    // Simulation runs in fixed steps of update_step, rendering happens once per
+    // loop with the leftover time passed along as an interpolation alpha.
+    const loop_setup& setup = m_loop_setup;
+    const tools::clock::duration update_step = std::chrono::duration_cast<tools::clock::duration>(
+        std::chrono::duration<double>(1.0 / (setup.update_rate > 0.0 ? setup.update_rate : 60.0)));
+    const tools::clock::duration max_frame_time = std::chrono::duration_cast<tools::clock::duration>(
+        std::chrono::duration<double>(setup.max_frame_time));
+    const bool frame_capped = setup.frame_rate_cap > 0.0;
+    const tools::clock::duration frame_period = frame_capped
+        ? std::chrono::duration_cast<tools::clock::duration>(std::chrono::duration<double>(1.0 / setup.frame_rate_cap))
+        : tools::clock::duration::zero();
+    const double dt = std::chrono::duration<double>(update_step).count();
+
+    xeekworx::log << LOGSTAMP << xeekworx::DEBUG << "Update rate: " << setup.update_rate << " per second, "
+        << "Frame rate cap: ";
+    if (frame_capped) xeekworx::log << setup.frame_rate_cap << " per second" << std::endl;
+    else xeekworx::log << "None" << std::endl;
+
+    tools::timer_resolution resolution; // Precise sleeps for the frame cap
+    tools::clock::duration accumulator = tools::clock::duration::zero();
+    tools::clock::time_point previous = tools::clock::now();
+    tools::clock::time_point next_frame = previous + frame_period;
+    double simulation_time = 0.0;
+    frame_packet local_packet;
+
+    // RENDER THREAD:
+    // Takes the OpenGL context over for the duration of the loop.
+    if (setup.threaded_rendering) start_render_thread();
+
+    // FRAME LIMIT:
+    // Benchmark runs (usually headless) stop after a fixed number of frames and
+    // report frame times, so the frame times are only kept when there's a limit.
+    unsigned long long frames = 0;
+    std::vector<double> frame_times;
+    if (setup.frame_limit) frame_times.reserve((size_t)setup.frame_limit);
+
     while (!this->m_should_quit) {
+        m_profiler->begin_frame();
+        const tools::clock::time_point frame_start = tools::clock::now();
+
         // Empty the event queue entirely:
-        if (!event_loop()) break;
+        {
+            SPACETHEORY_PROFILE_SCOPE("events");
+            if (!event_loop()) break;
+        }
+
+        // ELAPSED TIME:
+        // Clamped so that a long stall (breakpoint, window drag, loading)
+        // doesn't turn into a flood of catch-up updates.
+        const tools::clock::time_point now = tools::clock::now();
+        tools::clock::duration elapsed = now - previous;
+        previous = now;
+        if (elapsed > max_frame_time) elapsed = max_frame_time;
+        accumulator += elapsed;
+
+        // FIXED UPDATES:
+        unsigned updates = 0;
+        while (accumulator >= update_step && updates < setup.max_updates_per_frame) {
+            SPACETHEORY_PROFILE_SCOPE("update");
+            on_update(dt);
+            accumulator -= update_step;
+            ++updates;
+        }
+        // SPIRAL OF DEATH GUARD:
+        // If updates can't keep up, drop the backlog instead of falling further
+        // behind every frame; the simulation slows down rather than locking up.
+        if (accumulator >= update_step) {
+            const tools::clock::duration dropped = accumulator - accumulator % update_step;
+            SPACETHEORY_LOG_ASYNC(log_level::debug, "Frame %llu: updates fell behind, dropped %.2f ms of simulation",
+                (unsigned long long) m_profiler->frame_number(), std::chrono::duration<double, std::milli>(dropped).count());
+            accumulator = std::chrono::duration_cast<tools::clock::duration>(accumulator % update_step);
+        }
 
-        // Rendering magic:
-        on_frame();
+        // FRAME PACKET:
+        // With a render thread the packet goes in the mailbox's back slot, and
+        // is rendered there while the next frame is simulated here.
+        const double alpha = std::chrono::duration<double>(accumulator).count() / dt;
+        simulation_time += updates * dt;
+        frame_packet& packet = m_render_threaded ? m_frames.back() : local_packet;
+        packet.frame = m_profiler->frame_number();
+        packet.alpha = alpha;
+        packet.time = simulation_time + alpha * dt;
+        packet.commands.reset();
+        {
+            SPACETHEORY_PROFILE_SCOPE("prepare");
+            on_prepare_frame(packet);
+        }
 
-        // Present:
-        m_display->present();
+        if (m_render_threaded) {
+            m_frames.publish();
+            { std::lock_guard<std::mutex> lock(m_render_mutex); }
+            m_render_wake.notify_one();
+        }
+        else render_frame(packet);
+
+        m_profiler->end_frame();
+
+        if (setup.frame_limit) {
+            frame_times.push_back(std::chrono::duration<double, std::milli>(tools::clock::now() - frame_start).count());
+            if (++frames >= setup.frame_limit) this->m_should_quit = true;
+        }
+
+        // FRAME RATE CAP:
+        if (frame_capped) {
+            tools::wait_until(next_frame);
+            next_frame += frame_period;
+            // Don't try to make up for frames that were missed entirely:
+            const tools::clock::time_point after_wait = tools::clock::now();
+            if (next_frame < after_wait) next_frame = after_wait + frame_period;
+        }
+    }
+
+    if (m_render_threaded) stop_render_thread();
+
+    if (!frame_times.empty()) {
+        // Main thread time per frame, excluding the frame rate cap's wait. That
+        // includes rendering and presenting unless there's a render thread:
+        const double total = std::accumulate(frame_times.begin(), frame_times.end(), 0.0);
+        std::sort(frame_times.begin(), frame_times.end());
+        auto percentile = [&frame_times](const double p) {
+            return frame_times[(std::min)(frame_times.size() - 1, (size_t)(p * (frame_times.size() - 1) + 0.5))];
+        };
+        xeekworx::log << LOGSTAMP << xeekworx::NOTICE << "Frame times over " << frame_times.size() << " frames (ms): "
+            << "min " << frame_times.front() << ", avg " << total / frame_times.size()
+            << ", p50 " << percentile(0.50) << ", p95 " << percentile(0.95) << ", p99 " << percentile(0.99)
+            << ", max " << frame_times.back() << std::endl;
     }
 
     xeekworx::log << LOGSTAMP << xeekworx::NOTICE << "Game Loop Ended" << std::endl;
@@ -449,7 +640,102 @@ bool application::event_loop()
     return true;
 }
 
-void application::on_frame()
+void application::render_frame(const frame_packet& packet)
+{
+    m_profiler->begin_gpu_frame();
+
+    // Background loads finished since the last frame:
+    {
+        SPACETHEORY_PROFILE_SCOPE("uploads");
+        m_device->textures()->pump(m_loop_setup.upload_budget_ms);
+    }
+
+    // Rendering magic:
+    {
+        SPACETHEORY_PROFILE_SCOPE("render");
+        on_render_frame(packet);
+    }
+
+    // Present:
+    {
+        SPACETHEORY_PROFILE_SCOPE("present");
+        m_display->present();
+    }
+
+    m_display->gl_state()->end_frame();
+    m_device->end_frame();
+}
+
+void application::start_render_thread()
+{
+    xeekworx::log << LOGSTAMP << xeekworx::DEBUG << "Starting the render thread" << std::endl;
+
+    // A context can only be current on one thread at a time:
+    m_display->release_current();
+    m_device->textures()->set_render_thread(std::thread::id()); // Until render_main takes over
+    m_render_running = true;
+    m_render_threaded = true;
+    m_render_thread = std::thread(&application::render_main, this);
+}
+
+void application::stop_render_thread()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_render_mutex);
+        m_render_running = false;
+    }
+    m_render_wake.notify_one();
+    m_render_thread.join();
+    m_render_threaded = false;
+
+    // Back to the main thread for shutdown:
+    m_display->make_current();
+    m_device->textures()->set_render_thread(std::this_thread::get_id());
+    xeekworx::log << LOGSTAMP << xeekworx::DEBUG << "Render thread stopped" << std::endl;
+}
+
+void application::render_main()
+{
+    m_display->make_current();
+    m_device->textures()->set_render_thread(std::this_thread::get_id());
+
+    while (true) {
+        // Sleeps until the main thread publishes a frame. Only the wakeup goes
+        // through the mutex, the packets themselves are in the mailbox:
+        {
+            std::unique_lock<std::mutex> lock(m_render_mutex);
+            m_render_wake.wait(lock, [this] { return m_frames.has_update() || !m_render_running; });
+            if (!m_render_running) break;
+        }
+
+        m_frames.update();
+        render_frame(m_frames.front());
+    }
+
+    m_display->release_current();
+}
+
+void application::on_prepare_frame(frame_packet& packet)
+{
+}
+
+void application::on_render_frame(const frame_packet& packet)
+{
+    // RECORDED FRAME:
+    // Whatever on_prepare_frame recorded is all there is to draw.
+    if (!packet.commands.empty()) {
+        g->begin();
+        packet.commands.replay(*g);
+        g->end();
+    }
+    else on_render(packet.alpha);
+}
+
+void application::on_update(const double dt)
+{
+}
+
+void application::on_render(const double alpha)
 {
     g->begin();
     g->clear(graphics2d::white);
@@ -4,6 +4,15 @@
 #include <memory>
 #include "display.h"
 #include "graphics_setup.h"
+#include "loop_setup.h"
+#include "profiler.h"
+#include "async_log.h"
+#include "job_system.h"
+#include "frame_packet.h"
+#include "triple_buffer.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "graphics2d.h"
 
 namespace spacetheory {
@@ -19,17 +28,46 @@ namespace spacetheory {
 
         static application * app() { return s_app; }
         display * display() { return m_display; }
+        spacetheory::profiler * profiler() { return m_profiler.get(); }
+        spacetheory::async_log * async_log() { return m_async_log.get(); }
+        job_system * jobs() { return m_jobs.get(); } // Started in API configuration stage 1
+        render_device * device() { return m_device.get(); }
+        graphics2d * graphics() { return g.get(); } // The display's, created with the device
+
+        const loop_setup& get_loop_setup() const { return m_loop_setup; }
+        void set_loop_setup(const loop_setup& setup) { m_loop_setup = setup; }
 
     protected:
         virtual bool on_start(const std::vector<std::string>& args, display_setup& disp_setup, graphics_setup& gfx_setup) = 0;
-        virtual void on_frame();
+        virtual void on_update(const double dt); // fixed simulation step, dt in seconds
+        virtual void on_render(const double alpha); // alpha is how far between the last two updates (0 to 1)
+
+        // Split frames, needed for loop_setup::threaded_rendering: prepare runs
+        // on the main thread after the updates and copies whatever rendering
+        // needs into the packet; render runs on the render thread (or right
+        // after on the main thread) and by default calls on_render.
+        virtual void on_prepare_frame(frame_packet& packet);
+        virtual void on_render_frame(const frame_packet& packet);
 
     private:
         static spacetheory::application * s_app;
         spacetheory::display * m_display = nullptr;
         bool m_should_quit = false;
+        loop_setup m_loop_setup;
+        std::unique_ptr<spacetheory::profiler> m_profiler;
+        std::unique_ptr<spacetheory::async_log> m_async_log;
+        std::unique_ptr<job_system> m_jobs;
+        std::unique_ptr<render_device> m_device; // Created in API configuration stage 3
         std::unique_ptr<graphics2d> g;
 
+        // Render thread, for loop_setup::threaded_rendering:
+        std::thread m_render_thread;
+        triple_buffer<frame_packet> m_frames; // Latest packet from the main thread
+        std::mutex m_render_mutex;
+        std::condition_variable m_render_wake;
+        bool m_render_running = false; // Guarded by m_render_mutex
+        bool m_render_threaded = false;
+
         bool create_display(const display_setup& disp_setup);
         bool setup_apis1(); // stage 1, before any apis have initialized
         bool setup_apis2(const graphics_setup& gfx_setup); // stage 2, before the window (display) is created
@@ -40,6 +78,10 @@ namespace spacetheory {
 
         void game_loop();
         bool event_loop();
+        void render_frame(const frame_packet& packet);
+        void start_render_thread();
+        void stop_render_thread();
+        void render_main();
     };
 
 }
\ No newline at end of file
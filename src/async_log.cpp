@@ -0,0 +1,272 @@
+#include "async_log.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include "profiler.h"
+
+using namespace spacetheory;
+
+spacetheory::async_log * spacetheory::async_log::s_current = nullptr;
+const size_t spacetheory::async_log::message_size;
+const size_t spacetheory::async_log::ring_slots;
+const size_t spacetheory::async_log::max_threads;
+
+static std::atomic<uint64_t> next_instance(1);
+
+// Each thread remembers its ring in the log it last wrote to; the instance
+// number keeps a new log at a recycled address from reusing a stale ring.
+// The alive flag is shared with that ring and cleared when the thread exits
+// (or moves on to another log), which frees the ring for another thread. It's
+// shared so it outlives whichever of the two goes first.
+struct thread_ring_cache {
+    uint64_t instance = 0;
+    void * ring = nullptr;
+    std::shared_ptr<std::atomic<bool>> alive;
+
+    ~thread_ring_cache() { release(); }
+    void release()
+    {
+        // Everything this thread queued was published before this:
+        if (alive) alive->store(false, std::memory_order_release);
+        alive.reset();
+    }
+};
+static thread_local thread_ring_cache ring_cache;
+
+static const char * level_name(const log_level level)
+{
+    switch (level) {
+    case log_level::fatal: return "FATAL";
+    case log_level::error: return "ERROR";
+    case log_level::warning: return "WARNING";
+    case log_level::notice: return "NOTICE";
+    case log_level::info: return "INFO";
+    case log_level::debug: return "DEBUG";
+    case log_level::debug2: return "DEBUG2";
+    default: return "?";
+    }
+}
+
+static uint64_t steady_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+async_log::async_log(const config& setup)
+    : m_config(setup), m_epoch(steady_ns()), m_instance(next_instance.fetch_add(1, std::memory_order_relaxed)),
+    m_ring_count(0), m_thread_count(0), m_running(true), m_flush_requested(0), m_flush_completed(0),
+    m_written(0), m_dropped(0), m_batches(0), m_previous_terminate(nullptr)
+{
+    for (auto& r : m_rings) r.store(nullptr, std::memory_order_relaxed);
+
+    m_file.open(m_config.file, std::ios::out | std::ios::binary | std::ios::trunc);
+    m_batch.reserve(ring_slots * 64);
+
+    if (!s_current) {
+        s_current = this;
+        // Whatever is still queued when the process goes down is written out
+        // before the previous handler (usually abort) runs:
+        m_previous_terminate = std::set_terminate(&async_log::on_terminate);
+    }
+
+    m_writer = std::thread(&async_log::writer_main, this);
+}
+
+async_log::~async_log()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wake_mutex);
+        m_running = false;
+    }
+    m_wake.notify_all();
+    m_flushed.notify_all();
+    if (m_writer.joinable()) m_writer.join();
+
+    drain();
+
+    if (s_current == this) {
+        std::set_terminate(m_previous_terminate);
+        s_current = nullptr;
+    }
+
+    for (auto& r : m_rings) delete r.exchange(nullptr, std::memory_order_acq_rel);
+}
+
+async_log::ring * async_log::thread_ring()
+{
+    if (ring_cache.instance == m_instance) return (ring *) ring_cache.ring;
+
+    // FIRST MESSAGE FROM THIS THREAD:
+    ring_cache.release();
+    ring_cache.instance = m_instance;
+    ring_cache.ring = nullptr;
+    ring_cache.alive = std::make_shared<std::atomic<bool>>(true);
+
+    std::lock_guard<std::mutex> lock(m_register_mutex);
+    m_thread_count.fetch_add(1, std::memory_order_relaxed);
+
+    // A ring left by a thread that exited is taken over as it is, anything it
+    // still holds is written out ahead of the new thread's messages:
+    ring * r = nullptr;
+    const size_t count = m_ring_count.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count && !r; ++i) {
+        ring * candidate = m_rings[i].load(std::memory_order_relaxed);
+        if (!candidate->owner_alive->load(std::memory_order_acquire)) r = candidate;
+    }
+
+    if (!r) {
+        if (count >= max_threads) return nullptr;
+        r = new ring();
+        r->head.store(0, std::memory_order_relaxed);
+        r->tail.store(0, std::memory_order_relaxed);
+        m_rings[count].store(r, std::memory_order_release);
+        m_ring_count.store(count + 1, std::memory_order_release);
+    }
+
+    r->thread_id = profiler::thread_id(); // Same ids as the profiler's trace lanes
+    r->owner_alive = ring_cache.alive;
+    ring_cache.ring = r;
+    return r;
+}
+
+bool async_log::write(const log_level level, const char * format, ...)
+{
+    if (!enabled(level)) return false;
+
+    ring * r = thread_ring();
+    if (!r) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    const size_t head = r->head.load(std::memory_order_relaxed);
+    const size_t queued = head - r->tail.load(std::memory_order_acquire);
+    if (queued >= ring_slots) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    message& m = r->slots[head & (ring_slots - 1)];
+    m.time_ns = steady_ns() - m_epoch;
+    m.thread_id = r->thread_id;
+    m.level = level;
+
+    va_list args;
+    va_start(args, format);
+    const int length = vsnprintf(m.text, message_size, format, args);
+    va_end(args);
+    m.length = (uint16_t) (length < 0 ? 0 : std::min<size_t>((size_t) length, message_size - 1));
+
+    r->head.store(head + 1, std::memory_order_release);
+
+    // WAKE THE WRITER EARLY:
+    // Severe messages are flushed right away (fatal ones before returning, the
+    // process may not get much further), and a ring filling up is drained
+    // before the interval runs out so it doesn't start dropping.
+    if (level <= m_config.flush_level) request_flush(level == log_level::fatal);
+    else if (queued + 1 == ring_slots / 2) request_flush(false); // A bare notify wouldn't get past the writer's wait predicate
+
+    return true;
+}
+
+size_t async_log::drain()
+{
+    std::lock_guard<std::mutex> lock(m_drain_mutex);
+
+    m_batch.clear();
+    size_t count = 0;
+    char header[64];
+
+    const size_t rings = m_ring_count.load(std::memory_order_acquire);
+    for (size_t i = 0; i < rings; ++i) {
+        ring * r = m_rings[i].load(std::memory_order_acquire);
+
+        size_t tail = r->tail.load(std::memory_order_relaxed);
+        const size_t head = r->head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail) {
+            const message& m = r->slots[tail & (ring_slots - 1)];
+            const int header_length = snprintf(header, sizeof(header), "[%12.6f] %-7s T%-2u ",
+                m.time_ns / 1000000000.0, level_name(m.level), m.thread_id);
+            if (header_length > 0) m_batch.append(header, std::min<size_t>((size_t) header_length, sizeof(header) - 1));
+            m_batch.append(m.text, m.length);
+            m_batch.push_back('\n');
+            ++count;
+        }
+        r->tail.store(tail, std::memory_order_release);
+    }
+
+    // Messages from different threads are grouped per thread within a batch,
+    // the timestamps give the real order.
+    if (count && m_file.is_open()) {
+        m_file.write(m_batch.data(), m_batch.size());
+        m_file.flush();
+        m_batches.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_written.fetch_add(count, std::memory_order_relaxed);
+    return count;
+}
+
+void async_log::writer_main()
+{
+    const std::chrono::milliseconds interval(std::max(1u, m_config.flush_interval_ms));
+
+    std::unique_lock<std::mutex> lock(m_wake_mutex);
+    while (m_running) {
+        m_wake.wait_for(lock, interval, [this] { return !m_running || m_flush_requested != m_flush_completed; });
+        const uint64_t requested = m_flush_requested;
+        lock.unlock();
+
+        drain();
+
+        lock.lock();
+        m_flush_completed = requested;
+        m_flushed.notify_all();
+    }
+}
+
+void async_log::request_flush(const bool wait)
+{
+    std::unique_lock<std::mutex> lock(m_wake_mutex);
+    if (!m_running) {
+        lock.unlock();
+        drain();
+        return;
+    }
+
+    const uint64_t target = ++m_flush_requested;
+    m_wake.notify_one();
+    if (wait) m_flushed.wait(lock, [this, target] { return !m_running || m_flush_completed >= target; });
+}
+
+void async_log::flush()
+{
+    request_flush(true);
+}
+
+void async_log::on_terminate()
+{
+    // The writer may be stuck or gone, so the crashing thread drains itself
+    // (unless it is the writer, which could be holding the drain lock):
+    async_log * log = s_current;
+    std::terminate_handler previous = nullptr;
+    if (log) {
+        if (std::this_thread::get_id() != log->m_writer.get_id()) log->drain();
+        previous = log->m_previous_terminate;
+    }
+
+    if (previous) previous();
+    std::abort();
+}
+
+async_log::stats async_log::get_stats() const
+{
+    stats result;
+    result.written = m_written.load(std::memory_order_relaxed);
+    result.dropped = m_dropped.load(std::memory_order_relaxed);
+    result.batches = m_batches.load(std::memory_order_relaxed);
+    result.threads = m_thread_count.load(std::memory_order_relaxed);
+    result.rings = m_ring_count.load(std::memory_order_relaxed);
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace spacetheory {
+
+    // Same order as xeekworx::logtype, most severe first:
+    enum class log_level : uint8_t {
+        fatal, error, warning, notice, info, debug, debug2
+    };
+
+    // Logging for the hot path (game loop, render thread, jobs). Producers
+    // format straight into a fixed-size slot of their own thread's ring, no
+    // locks or allocations, and a background thread drains every ring in
+    // batches to the log file. When a ring is full the message is dropped and
+    // counted rather than blocking the producer.
+    class async_log
+    {
+    public:
+        static const size_t message_size = 240;    // bytes of text per message, longer ones are truncated
+        static const size_t ring_slots = 512;       // messages per producer thread, power of two
+        static const size_t max_threads = 64;       // producer threads at once, messages from more are dropped
+
+        struct config {
+            std::string file;
+            log_level level = log_level::debug;         // messages above this are ignored
+            log_level flush_level = log_level::error;   // messages at or above this flush the file
+            unsigned flush_interval_ms = 100;           // longest a message waits to be written
+        };
+
+        struct stats {
+            uint64_t written = 0;   // messages written to the file
+            uint64_t dropped = 0;   // messages lost to full rings
+            uint64_t batches = 0;   // writes to the file
+            size_t threads = 0;     // producer threads seen, including ones that exited
+            size_t rings = 0;       // rings they used, reused after a thread exits
+        };
+
+    private:
+        static async_log * s_current;
+
+        struct message {
+            uint64_t time_ns;
+            uint32_t thread_id;
+            log_level level;
+            uint16_t length;
+            char text[message_size];
+        };
+
+        struct ring {
+            // Single producer (the owning thread), single consumer (the writer):
+            std::atomic<size_t> head;   // next slot the producer writes
+            std::atomic<size_t> tail;   // next slot the writer reads
+            uint32_t thread_id;
+            // Cleared when the owning thread exits, the ring then goes to the
+            // next thread that registers. Guarded by m_register_mutex:
+            std::shared_ptr<std::atomic<bool>> owner_alive;
+            message slots[ring_slots];
+        };
+
+        config m_config;
+        std::ofstream m_file;
+        uint64_t m_epoch;
+
+        // Rings are registered the first time a thread logs and live as long as
+        // the log, so the writer can walk them without a lock. Only which thread
+        // owns one changes:
+        const uint64_t m_instance;
+        std::atomic<ring *> m_rings[max_threads];
+        std::atomic<size_t> m_ring_count;
+        std::mutex m_register_mutex;
+        std::atomic<size_t> m_thread_count;
+
+        std::mutex m_drain_mutex; // writer thread vs. a flush from a crashing thread
+        std::string m_batch;
+
+        std::thread m_writer;
+        std::mutex m_wake_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_flushed;
+        bool m_running;
+        uint64_t m_flush_requested, m_flush_completed;
+
+        std::atomic<uint64_t> m_written, m_dropped, m_batches;
+        std::terminate_handler m_previous_terminate;
+
+        ring * thread_ring();
+        void writer_main();
+        size_t drain();
+        void request_flush(const bool wait);
+
+        static void on_terminate();
+
+    public:
+        async_log(const config& setup);
+        ~async_log();
+        async_log(const async_log&) = delete;
+        async_log& operator=(const async_log&) = delete;
+
+        static async_log * current() { return s_current; }
+
+        bool is_open() const { return m_file.is_open(); }
+        bool enabled(const log_level level) const { return level <= m_config.level; }
+
+        // printf-style, returns false if the message was filtered or dropped:
+        bool write(const log_level level, const char * format, ...);
+
+        // Blocks until everything logged before the call is in the file:
+        void flush();
+
+        stats get_stats() const;
+    };
+
+}
\ No newline at end of file
@@ -1,10 +1,11 @@
 #pragma once
 #include <stdint.h>
-#include <cstdlib>      // std::strtoul
 #include <string>
+#include <string_view>
 #include <sstream>      // std::stringstream
 #include <ios>          // std::hex
 #include <algorithm>    // std::transform
+#include <type_traits>
 #include "third-party\glm\glm\glm.hpp"
 #include "html_colors.h"
 
@@ -22,7 +23,6 @@ namespace spacetheory {
         uint8_t r, g, b, a;
 
         color() : color(color::transparent) {}
-        color(const color& c) : r(c.r), g(c.g), b(c.b), a(c.a) {}
         color(uint32_t rgba_value) { *this = color::from_rgba(rgba_value); }
         color(uint8_t r, uint8_t g, uint8_t b, uint8_t a) : r(r), g(g), b(b), a(a) {}
         color(float r, float g, float b, float a = 255.f) : 
@@ -30,7 +30,7 @@ namespace spacetheory {
             g(static_cast<uint8_t>(std::round(g * 255.f))), 
             b(static_cast<uint8_t>(std::round(b * 255.f))), 
             a(static_cast<uint8_t>(std::round(a * 255.f))) {}
-        color(const std::string& html) { *this = color::from_html(html); }
+        color(const std::string_view html) { *this = color::from_html(html); }
         color(const glm::vec4& v) : color(v.r, v.g, v.b, v.a) {}
         color(const glm::vec3& v) : color(v.r, v.g, v.b) {}
 
@@ -47,17 +47,48 @@ namespace spacetheory {
             return !(c1 == c2);
         }
 
-        static color from_html(const std::string& html) {
-            std::string formatted(html);
-            formatted.erase(std::find(formatted.begin(), formatted.end(), '#'));
-            if (formatted.length() == 8)
-                return color::from_rgba(std::strtoul(formatted.c_str(), 0, 16));
-            else if (formatted.length() == 6)
-                return color::from_rgb(std::strtoul(formatted.c_str(), 0, 16));
-            else
-                return color::black;
+        // Parses #rgb, #rgba, #rrggbb, #rrggbbaa or a color name from
+        // html_colors (any case), without allocating. Hex without the # is
+        // accepted when it isn't a name. Returns false and leaves the result
+        // alone when the text is none of those:
+        static bool try_from_html(const std::string_view html, color& result) {
+            uint32_t value = 0;
+            if (!html.empty() && html[0] == '#') {
+                if (!parse_hex(html.substr(1), value)) return false;
+            }
+            else if (!html_colors::lookup(html, value) && !parse_hex(html, value)) return false;
+
+            result = color::from_rgba(value);
+            return true;
+        }
+
+        // Black when the text can't be parsed:
+        static color from_html(const std::string_view html) {
+            color result(color::black);
+            color::try_from_html(html, result);
+            return result;
+        }
+
+        // Color channels scaled by alpha (c * a / 255, rounded), the way render
+        // targets hold colors and blending expects them:
+        color premultiplied() const {
+            return color(premultiply_channel(r, a), premultiply_channel(g, a), premultiply_channel(b, a), a);
+        }
+
+        // Back to straight alpha, to the nearest value. Nothing can be
+        // recovered from alpha 0, it gives black:
+        color unpremultiplied() const {
+            if (a == 0) return color((uint8_t) 0, (uint8_t) 0, (uint8_t) 0, (uint8_t) 0);
+            const float scale = 255.0f / (float) a;
+            return color(unpremultiply_channel(r, scale), unpremultiply_channel(g, scale), unpremultiply_channel(b, scale), a);
         }
 
+        // Colors are sRGB encoded. These give the linear light values (alpha
+        // unchanged, everything 0 to 1) and the nearest color back; they're
+        // defined with color_convert and match its bulk conversions exactly:
+        glm::vec4 linear() const;
+        static color from_linear(const glm::vec4& v);
+
         static color from_rgba(uint32_t v) {
             return color(
                 (uint8_t)((v >> 24) & 0xFF),   // red
@@ -145,6 +176,44 @@ namespace spacetheory {
             else return ss.str();
         }
 
+    private:
+        static uint8_t premultiply_channel(const uint8_t c, const uint8_t alpha) {
+            const unsigned t = (unsigned) c * alpha + 128;
+            return (uint8_t) ((t + (t >> 8)) >> 8);
+        }
+
+        static uint8_t unpremultiply_channel(const uint8_t c, const float scale) {
+            const float v = (float) c * scale + 0.5f;
+            return v < 255.0f ? (uint8_t) (int) v : 255;
+        }
+
+        static constexpr int hex_digit(const char c) {
+            return (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+        }
+
+        // Hex digits to an rgba value, short forms repeat each digit (f is ff)
+        // and leaving out alpha makes it opaque:
+        static constexpr bool parse_hex(const std::string_view digits, uint32_t& rgba) {
+            const size_t length = digits.size();
+            if (length != 3 && length != 4 && length != 6 && length != 8) return false;
+
+            uint32_t value = 0;
+            for (size_t i = 0; i < length; ++i) {
+                const int digit = hex_digit(digits[i]);
+                if (digit < 0) return false;
+                if (length <= 4) value = (value << 8) | (uint32_t) (digit * 0x11);
+                else value = (value << 4) | (uint32_t) digit;
+            }
+
+            rgba = (length == 3 || length == 6) ? (value << 8) | 0xFF : value;
+            return true;
+        }
+
     };
 
+    // Buffers of colors are converted in bulk by color_convert, which treats
+    // them as plain bytes:
+    static_assert(std::is_trivially_copyable<color>::value, "color must stay trivially copyable");
+    static_assert(sizeof(color) == 4, "color must stay 4 packed bytes");
+
 }
\ No newline at end of file
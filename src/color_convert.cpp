@@ -0,0 +1,638 @@
+#include "color_convert.h"
+#include "cpu_features.h"
+#include <cmath>
+#if SPACETHEORY_SIMD_X86
+#include <immintrin.h>
+#endif
+
+// The NEON kernels divide in vector registers, which only AArch64 can do:
+#if SPACETHEORY_SIMD_NEON && (defined(__aarch64__) || defined(_M_ARM64))
+#define SPACETHEORY_COLOR_NEON 1
+#include <arm_neon.h>
+#else
+#define SPACETHEORY_COLOR_NEON 0
+#endif
+
+using namespace spacetheory;
+
+namespace {
+
+    // ------------------------------------------------------------------------
+    // SRGB TABLES
+    // ------------------------------------------------------------------------
+
+    struct srgb_tables {
+        float to_linear[256];
+        float lower_edges[257];     // Smallest linear value that encodes to each code, the one past 255 can't be reached
+        uint8_t coarse[4096 + 3];   // Code at the start of each 1/4096 step, padded for 32 bit gathers
+    };
+
+    double srgb_decode(const double encoded)
+    {
+        return encoded <= 0.04045 ? encoded / 12.92 : std::pow((encoded + 0.055) / 1.055, 2.4);
+    }
+
+    srgb_tables build_srgb_tables()
+    {
+        srgb_tables t = {};
+        for (int code = 0; code < 256; ++code) t.to_linear[code] = (float) srgb_decode(code / 255.0);
+
+        // A code's lower edge is halfway between it and the one below:
+        t.lower_edges[0] = 0.0f;
+        for (int code = 1; code < 256; ++code) t.lower_edges[code] = (float) srgb_decode((code - 0.5) / 255.0);
+        t.lower_edges[256] = 2.0f;
+
+        // Edges are closest in the dark end and still more than 1/4096 apart
+        // there, so each step crosses at most one of them:
+        int code = 0;
+        for (int step = 0; step < 4096; ++step) {
+            while (code < 255 && t.lower_edges[code + 1] <= step / 4096.0f) code++;
+            t.coarse[step] = (uint8_t) code;
+        }
+        return t;
+    }
+
+    const srgb_tables& get_srgb_tables()
+    {
+        static const srgb_tables tables = build_srgb_tables();
+        return tables;
+    }
+
+    // ------------------------------------------------------------------------
+    // KERNELS
+    // ------------------------------------------------------------------------
+    // The vector ones return how many pixels they did, the scalar ones do the
+    // rest and define the results.
+
+    // SCALAR:
+
+    inline float clamp_unit(const float c)
+    {
+        const float positive = c > 0.0f ? c : 0.0f; // NaN fails the comparison as well
+        return positive < 1.0f ? positive : 1.0f;
+    }
+
+    inline uint8_t unorm8(const float c)
+    {
+        return (uint8_t) (int) (clamp_unit(c) * 255.0f + 0.5f);
+    }
+
+    inline uint8_t srgb_code(const float c, const srgb_tables& t)
+    {
+        const float x = clamp_unit(c);
+        int step = (int) (x * 4096.0f);
+        if (step > 4095) step = 4095;
+        int code = t.coarse[step];
+        if (x >= t.lower_edges[code + 1]) code++;
+        return (uint8_t) code;
+    }
+
+    inline uint32_t reverse_bytes(const uint32_t v)
+    {
+        return (v >> 24) | ((v >> 8) & 0xFF00) | ((v << 8) & 0xFF0000) | (v << 24);
+    }
+
+    void swizzle_scalar(const uint32_t * s, uint32_t * d, size_t i, const size_t count)
+    {
+        for (; i < count; ++i) d[i] = reverse_bytes(s[i]);
+    }
+
+    void to_rgba_scalar(const uint8_t * s, uint32_t * d, size_t i, const size_t count)
+    {
+        for (; i < count; ++i) {
+            const uint8_t * p = s + i * 4;
+            d[i] = ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+        }
+    }
+
+    void from_rgba_scalar(const uint32_t * s, uint8_t * d, size_t i, const size_t count)
+    {
+        for (; i < count; ++i) {
+            uint8_t * p = d + i * 4;
+            p[0] = (uint8_t) (s[i] >> 24);
+            p[1] = (uint8_t) (s[i] >> 16);
+            p[2] = (uint8_t) (s[i] >> 8);
+            p[3] = (uint8_t) s[i];
+        }
+    }
+
+    void to_float_scalar(const uint8_t * s, float * d, size_t i, const size_t count)
+    {
+        for (i *= 4; i < count * 4; ++i) d[i] = (float) s[i] / 255.0f;
+    }
+
+    void to_unorm8_scalar(const float * s, uint8_t * d, size_t i, const size_t count)
+    {
+        for (i *= 4; i < count * 4; ++i) d[i] = unorm8(s[i]);
+    }
+
+    void premultiply_scalar(const uint8_t * s, uint8_t * d, size_t i, const size_t count)
+    {
+        for (; i < count; ++i) {
+            const uint8_t * p = s + i * 4;
+            uint8_t * out = d + i * 4;
+            const unsigned a = p[3];
+            for (int c = 0; c < 3; ++c) {
+                // Exact c * a / 255 rounded, without dividing:
+                const unsigned t = p[c] * a + 128;
+                out[c] = (uint8_t) ((t + (t >> 8)) >> 8);
+            }
+            out[3] = (uint8_t) a;
+        }
+    }
+
+    void unpremultiply_scalar(const uint8_t * s, uint8_t * d, size_t i, const size_t count)
+    {
+        for (; i < count; ++i) {
+            const uint8_t * p = s + i * 4;
+            uint8_t * out = d + i * 4;
+            const uint8_t a = p[3];
+            if (a == 0) {
+                out[0] = out[1] = out[2] = 0;
+            }
+            else {
+                const float scale = 255.0f / (float) a;
+                for (int c = 0; c < 3; ++c) {
+                    const float v = (float) p[c] * scale + 0.5f;
+                    out[c] = v < 255.0f ? (uint8_t) (int) v : 255;
+                }
+            }
+            out[3] = a;
+        }
+    }
+
+    void srgb_to_linear_scalar(const uint8_t * s, float * d, size_t i, const size_t count, const srgb_tables& t)
+    {
+        for (; i < count; ++i) {
+            const uint8_t * p = s + i * 4;
+            float * out = d + i * 4;
+            out[0] = t.to_linear[p[0]];
+            out[1] = t.to_linear[p[1]];
+            out[2] = t.to_linear[p[2]];
+            out[3] = (float) p[3] / 255.0f;
+        }
+    }
+
+    void linear_to_srgb_scalar(const float * s, uint8_t * d, size_t i, const size_t count, const srgb_tables& t)
+    {
+        for (; i < count; ++i) {
+            const float * p = s + i * 4;
+            uint8_t * out = d + i * 4;
+            out[0] = srgb_code(p[0], t);
+            out[1] = srgb_code(p[1], t);
+            out[2] = srgb_code(p[2], t);
+            out[3] = unorm8(p[3]);
+        }
+    }
+
+#if SPACETHEORY_SIMD_X86
+    // SSE2:
+    // Four pixels at a time. There's no byte shuffle or gather before SSSE3
+    // and AVX2, so swizzling goes through 16 bit shifts and the table lookups
+    // are left to the scalar loops.
+
+    inline __m128 clamp_unit_sse2(const __m128 v)
+    {
+        // max returns its second operand for NaN:
+        return _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    }
+
+    inline __m128i unorm8_sse2(const float * p)
+    {
+        const __m128 v = clamp_unit_sse2(_mm_loadu_ps(p));
+        return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+    }
+
+    inline __m128i keep_alpha_sse2(const __m128i original, const __m128i converted)
+    {
+        const __m128i alpha = _mm_set1_epi32((int) 0xFF000000);
+        return _mm_or_si128(_mm_and_si128(original, alpha), _mm_andnot_si128(alpha, converted));
+    }
+
+    size_t swizzle_sse2(const uint32_t * s, uint32_t * d, const size_t count)
+    {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i *) (s + i));
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)); // Bytes within each half
+            v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1);  // Then the halves
+            _mm_storeu_si128((__m128i *) (d + i), v);
+        }
+        return i;
+    }
+
+    size_t to_float_sse2(const uint8_t * s, float * d, const size_t count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128 scale = _mm_set1_ps(255.0f);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const __m128i bytes = _mm_loadu_si128((const __m128i *) (s + i * 4));
+            const __m128i low = _mm_unpacklo_epi8(bytes, zero), high = _mm_unpackhi_epi8(bytes, zero);
+            float * out = d + i * 4;
+            _mm_storeu_ps(out, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale));
+            _mm_storeu_ps(out + 4, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale));
+            _mm_storeu_ps(out + 8, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale));
+            _mm_storeu_ps(out + 12, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale));
+        }
+        return i;
+    }
+
+    size_t to_unorm8_sse2(const float * s, uint8_t * d, const size_t count)
+    {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const float * p = s + i * 4;
+            const __m128i low = _mm_packs_epi32(unorm8_sse2(p), unorm8_sse2(p + 4));
+            const __m128i high = _mm_packs_epi32(unorm8_sse2(p + 8), unorm8_sse2(p + 12));
+            _mm_storeu_si128((__m128i *) (d + i * 4), _mm_packus_epi16(low, high));
+        }
+        return i;
+    }
+
+    inline __m128i premultiply_sse2(const __m128i channels)
+    {
+        // Two pixels as 16 bit channels, alpha copied across each:
+        const __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(channels, 0xFF), 0xFF);
+        const __m128i t = _mm_add_epi16(_mm_mullo_epi16(channels, a), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    }
+
+    size_t premultiply_sse2(const uint8_t * s, uint8_t * d, const size_t count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const __m128i bytes = _mm_loadu_si128((const __m128i *) (s + i * 4));
+            const __m128i low = premultiply_sse2(_mm_unpacklo_epi8(bytes, zero));
+            const __m128i high = premultiply_sse2(_mm_unpackhi_epi8(bytes, zero));
+            _mm_storeu_si128((__m128i *) (d + i * 4), keep_alpha_sse2(bytes, _mm_packus_epi16(low, high)));
+        }
+        return i;
+    }
+
+    inline __m128i unpremultiply_sse2(const __m128i pixel)
+    {
+        // One pixel as 32 bit channels:
+        const __m128 v = _mm_cvtepi32_ps(pixel);
+        const __m128 a = _mm_shuffle_ps(v, v, 0xFF);
+        const __m128 scaled = _mm_add_ps(_mm_mul_ps(v, _mm_div_ps(_mm_set1_ps(255.0f), a)), _mm_set1_ps(0.5f));
+        const __m128 opaque = _mm_cmpneq_ps(a, _mm_setzero_ps()); // Clears the infinities and NaNs of alpha 0
+        return _mm_cvttps_epi32(_mm_and_ps(_mm_min_ps(scaled, _mm_set1_ps(255.0f)), opaque));
+    }
+
+    size_t unpremultiply_sse2(const uint8_t * s, uint8_t * d, const size_t count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const __m128i bytes = _mm_loadu_si128((const __m128i *) (s + i * 4));
+            const __m128i low = _mm_unpacklo_epi8(bytes, zero), high = _mm_unpackhi_epi8(bytes, zero);
+            const __m128i first = _mm_packs_epi32(unpremultiply_sse2(_mm_unpacklo_epi16(low, zero)), unpremultiply_sse2(_mm_unpackhi_epi16(low, zero)));
+            const __m128i second = _mm_packs_epi32(unpremultiply_sse2(_mm_unpacklo_epi16(high, zero)), unpremultiply_sse2(_mm_unpackhi_epi16(high, zero)));
+            _mm_storeu_si128((__m128i *) (d + i * 4), keep_alpha_sse2(bytes, _mm_packus_epi16(first, second)));
+        }
+        return i;
+    }
+
+    // AVX2:
+    // Eight pixels at a time, with gathers for the sRGB tables. Packing works
+    // within 128 bit lanes, so packed pixels come out in the order 0 2 4 6 1 3
+    // 5 7 and are put back in order with one permute.
+
+    SPACETHEORY_TARGET_AVX2 inline __m256 clamp_unit_avx2(const __m256 v)
+    {
+        return _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+    }
+
+    SPACETHEORY_TARGET_AVX2 inline __m256i unorm8_avx2(const __m256 clamped)
+    {
+        return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(clamped, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+    }
+
+    // Four vectors of two pixels each, as 32 bit channels, to 8 pixels of bytes:
+    SPACETHEORY_TARGET_AVX2 inline __m256i pack_pixels_avx2(const __m256i a, const __m256i b, const __m256i c, const __m256i e)
+    {
+        const __m256i bytes = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, e));
+        return _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+    }
+
+    SPACETHEORY_TARGET_AVX2 inline __m256i keep_alpha_avx2(const __m256i original, const __m256i converted)
+    {
+        const __m256i alpha = _mm256_set1_epi32((int) 0xFF000000);
+        return _mm256_or_si256(_mm256_and_si256(original, alpha), _mm256_andnot_si256(alpha, converted));
+    }
+
+    SPACETHEORY_TARGET_AVX2 inline __m256i load_two_pixels_avx2(const uint8_t * p)
+    {
+        return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) p));
+    }
+
+    SPACETHEORY_TARGET_AVX2 size_t swizzle_avx2(const uint32_t * s, uint32_t * d, const size_t count)
+    {
+        const __m256i reverse = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                                 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const __m256i v = _mm256_loadu_si256((const __m256i *) (s + i));
+            _mm256_storeu_si256((__m256i *) (d + i), _mm256_shuffle_epi8(v, reverse));
+        }
+        return i;
+    }
+
+    SPACETHEORY_TARGET_AVX2 size_t to_float_avx2(const uint8_t * s, float * d, const size_t count)
+    {
+        const __m256 scale = _mm256_set1_ps(255.0f);
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2) {
+            _mm256_storeu_ps(d + i * 4, _mm256_div_ps(_mm256_cvtepi32_ps(load_two_pixels_avx2(s + i * 4)), scale));
+        }
+        return i;
+    }
+
+    SPACETHEORY_TARGET_AVX2 size_t to_unorm8_avx2(const float * s, uint8_t * d, const size_t count)
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const float * p = s + i * 4;
+            const __m256i a = unorm8_avx2(clamp_unit_avx2(_mm256_loadu_ps(p)));
+            const __m256i b = unorm8_avx2(clamp_unit_avx2(_mm256_loadu_ps(p + 8)));
+            const __m256i c = unorm8_avx2(clamp_unit_avx2(_mm256_loadu_ps(p + 16)));
+            const __m256i e = unorm8_avx2(clamp_unit_avx2(_mm256_loadu_ps(p + 24)));
+            _mm256_storeu_si256((__m256i *) (d + i * 4), pack_pixels_avx2(a, b, c, e));
+        }
+        return i;
+    }
+
+    SPACETHEORY_TARGET_AVX2 inline __m256i premultiply_avx2(const __m256i channels)
+    {
+        const __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(channels, 0xFF), 0xFF);
+        const __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(channels, a), _mm256_set1_epi16(128));
+        return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+    }
+
+    SPACETHEORY_TARGET_AVX2 size_t premultiply_avx2(const uint8_t * s, uint8_t * d, const size_t count)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            // Unpacking and packing within the same lanes keeps the order:
+            const __m256i bytes = _mm256_loadu_si256((const __m256i *) (s + i * 4));
+            const __m256i low = premultiply_avx2(_mm256_unpacklo_epi8(bytes, zero));
+            const __m256i high = premultiply_avx2(_mm256_unpackhi_epi8(bytes, zero));
+            _mm256_storeu_si256((__m256i *) (d + i * 4), keep_alpha_avx2(bytes, _mm256_packus_epi16(low, high)));
+        }
+        return i;
+    }
+
+    SPACETHEORY_TARGET_AVX2 inline __m256i unpremultiply_avx2(const __m256i pixels)
+    {
+        const __m256 v = _mm256_cvtepi32_ps(pixels);
+        const __m256 a = _mm256_permute_ps(v, 0xFF);
+        const __m256 scaled = _mm256_add_ps(_mm256_mul_ps(v, _mm256_div_ps(_mm256_set1_ps(255.0f), a)), _mm256_set1_ps(0.5f));
+        const __m256 opaque = _mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_NEQ_UQ);
+        return _mm256_cvttps_epi32(_mm256_and_ps(_mm256_min_ps(scaled, _mm256_set1_ps(255.0f)), opaque));
+    }
+
+    SPACETHEORY_TARGET_AVX2 size_t unpremultiply_avx2(const uint8_t * s, uint8_t * d, const size_t count)
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const uint8_t * p = s + i * 4;
+            const __m256i bytes = _mm256_loadu_si256((const __m256i *) p);
+            const __m256i converted = pack_pixels_avx2(
+                unpremultiply_avx2(load_two_pixels_avx2(p)), unpremultiply_avx2(load_two_pixels_avx2(p + 8)),
+                unpremultiply_avx2(load_two_pixels_avx2(p + 16)), unpremultiply_avx2(load_two_pixels_avx2(p + 24)));
+            _mm256_storeu_si256((__m256i *) (d + i * 4), keep_alpha_avx2(bytes, converted));
+        }
+        return i;
+    }
+
+    SPACETHEORY_TARGET_AVX2 size_t srgb_to_linear_avx2(const uint8_t * s, float * d, const size_t count, const srgb_tables& t)
+    {
+        const __m256 scale = _mm256_set1_ps(255.0f);
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2) {
+            const __m256i codes = load_two_pixels_avx2(s + i * 4);
+            const __m256 linear = _mm256_i32gather_ps(t.to_linear, codes, 4);
+            const __m256 alpha = _mm256_div_ps(_mm256_cvtepi32_ps(codes), scale);
+            _mm256_storeu_ps(d + i * 4, _mm256_blend_ps(linear, alpha, 0x88));
+        }
+        return i;
+    }
+
+    SPACETHEORY_TARGET_AVX2 inline __m256i srgb_code_avx2(const float * p, const srgb_tables& t)
+    {
+        const __m256 x = clamp_unit_avx2(_mm256_loadu_ps(p));
+        const __m256i step = _mm256_min_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(4096.0f))), _mm256_set1_epi32(4095));
+        __m256i code = _mm256_and_si256(_mm256_i32gather_epi32((const int *) t.coarse, step, 1), _mm256_set1_epi32(0xFF));
+        const __m256 edge = _mm256_i32gather_ps(t.lower_edges + 1, code, 4);
+        code = _mm256_sub_epi32(code, _mm256_castps_si256(_mm256_cmp_ps(x, edge, _CMP_GE_OQ))); // True is -1
+        return _mm256_blend_epi32(code, unorm8_avx2(x), 0x88);
+    }
+
+    SPACETHEORY_TARGET_AVX2 size_t linear_to_srgb_avx2(const float * s, uint8_t * d, const size_t count, const srgb_tables& t)
+    {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const float * p = s + i * 4;
+            const __m256i packed = pack_pixels_avx2(srgb_code_avx2(p, t), srgb_code_avx2(p + 8, t), srgb_code_avx2(p + 16, t), srgb_code_avx2(p + 24, t));
+            _mm256_storeu_si256((__m256i *) (d + i * 4), packed);
+        }
+        return i;
+    }
+#endif
+
+#if SPACETHEORY_COLOR_NEON
+    // NEON:
+    // Loads that split pixels into a register per channel make premultiplying
+    // straightforward. Unpremultiplying and the sRGB tables run scalar here.
+
+    size_t swizzle_neon(const uint32_t * s, uint32_t * d, const size_t count)
+    {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            vst1q_u8((uint8_t *) (d + i), vrev32q_u8(vld1q_u8((const uint8_t *) (s + i))));
+        }
+        return i;
+    }
+
+    size_t to_float_neon(const uint8_t * s, float * d, const size_t count)
+    {
+        const float32x4_t scale = vdupq_n_f32(255.0f);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const uint8x16_t bytes = vld1q_u8(s + i * 4);
+            const uint16x8_t low = vmovl_u8(vget_low_u8(bytes)), high = vmovl_u8(vget_high_u8(bytes));
+            float * out = d + i * 4;
+            vst1q_f32(out, vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(low))), scale));
+            vst1q_f32(out + 4, vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(low))), scale));
+            vst1q_f32(out + 8, vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(high))), scale));
+            vst1q_f32(out + 12, vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(high))), scale));
+        }
+        return i;
+    }
+
+    inline int16x4_t unorm8_neon(const float * p)
+    {
+        // Selects rather than vmaxq, which would keep a NaN:
+        const float32x4_t zero = vdupq_n_f32(0.0f), one = vdupq_n_f32(1.0f);
+        float32x4_t v = vld1q_f32(p);
+        v = vbslq_f32(vcgtq_f32(v, zero), v, zero);
+        v = vbslq_f32(vcltq_f32(v, one), v, one);
+        return vqmovn_s32(vcvtq_s32_f32(vaddq_f32(vmulq_f32(v, vdupq_n_f32(255.0f)), vdupq_n_f32(0.5f))));
+    }
+
+    size_t to_unorm8_neon(const float * s, uint8_t * d, const size_t count)
+    {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const float * p = s + i * 4;
+            const uint8x8_t low = vqmovun_s16(vcombine_s16(unorm8_neon(p), unorm8_neon(p + 4)));
+            const uint8x8_t high = vqmovun_s16(vcombine_s16(unorm8_neon(p + 8), unorm8_neon(p + 12)));
+            vst1q_u8(d + i * 4, vcombine_u8(low, high));
+        }
+        return i;
+    }
+
+    inline uint8x8_t premultiply_neon(const uint8x8_t c, const uint8x8_t a)
+    {
+        const uint16x8_t t = vaddq_u16(vmull_u8(c, a), vdupq_n_u16(128));
+        return vshrn_n_u16(vaddq_u16(t, vshrq_n_u16(t, 8)), 8);
+    }
+
+    size_t premultiply_neon(const uint8_t * s, uint8_t * d, const size_t count)
+    {
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            uint8x16x4_t p = vld4q_u8(s + i * 4);
+            const uint8x16_t a = p.val[3];
+            for (int c = 0; c < 3; ++c) {
+                p.val[c] = vcombine_u8(premultiply_neon(vget_low_u8(p.val[c]), vget_low_u8(a)), premultiply_neon(vget_high_u8(p.val[c]), vget_high_u8(a)));
+            }
+            vst4q_u8(d + i * 4, p);
+        }
+        return i;
+    }
+#endif
+
+}
+
+// ----------------------------------------------------------------------------
+// COLOR CONVERT
+// ----------------------------------------------------------------------------
+
+void color_convert::swizzle(const uint32_t * source, uint32_t * destination, const size_t count)
+{
+    size_t done = 0;
+#if SPACETHEORY_SIMD_X86
+    done = cpu_features::get().avx2 ? swizzle_avx2(source, destination, count) : swizzle_sse2(source, destination, count);
+#elif SPACETHEORY_COLOR_NEON
+    done = swizzle_neon(source, destination, count);
+#endif
+    swizzle_scalar(source, destination, done, count);
+}
+
+void color_convert::to_rgba(const uint8_t * source, uint32_t * destination, const size_t count)
+{
+    // On little-endian a pixel read as a whole is already abgr:
+    size_t done = 0;
+#if SPACETHEORY_SIMD_X86
+    done = cpu_features::get().avx2 ? swizzle_avx2((const uint32_t *) source, destination, count) : swizzle_sse2((const uint32_t *) source, destination, count);
+#elif SPACETHEORY_COLOR_NEON
+    done = swizzle_neon((const uint32_t *) source, destination, count);
+#endif
+    to_rgba_scalar(source, destination, done, count);
+}
+
+void color_convert::from_rgba(const uint32_t * source, uint8_t * destination, const size_t count)
+{
+    size_t done = 0;
+#if SPACETHEORY_SIMD_X86
+    done = cpu_features::get().avx2 ? swizzle_avx2(source, (uint32_t *) destination, count) : swizzle_sse2(source, (uint32_t *) destination, count);
+#elif SPACETHEORY_COLOR_NEON
+    done = swizzle_neon(source, (uint32_t *) destination, count);
+#endif
+    from_rgba_scalar(source, destination, done, count);
+}
+
+void color_convert::to_float(const uint8_t * source, float * destination, const size_t count)
+{
+    size_t done = 0;
+#if SPACETHEORY_SIMD_X86
+    done = cpu_features::get().avx2 ? to_float_avx2(source, destination, count) : to_float_sse2(source, destination, count);
+#elif SPACETHEORY_COLOR_NEON
+    done = to_float_neon(source, destination, count);
+#endif
+    to_float_scalar(source, destination, done, count);
+}
+
+void color_convert::to_unorm8(const float * source, uint8_t * destination, const size_t count)
+{
+    size_t done = 0;
+#if SPACETHEORY_SIMD_X86
+    done = cpu_features::get().avx2 ? to_unorm8_avx2(source, destination, count) : to_unorm8_sse2(source, destination, count);
+#elif SPACETHEORY_COLOR_NEON
+    done = to_unorm8_neon(source, destination, count);
+#endif
+    to_unorm8_scalar(source, destination, done, count);
+}
+
+void color_convert::premultiply(const uint8_t * source, uint8_t * destination, const size_t count)
+{
+    size_t done = 0;
+#if SPACETHEORY_SIMD_X86
+    done = cpu_features::get().avx2 ? premultiply_avx2(source, destination, count) : premultiply_sse2(source, destination, count);
+#elif SPACETHEORY_COLOR_NEON
+    done = premultiply_neon(source, destination, count);
+#endif
+    premultiply_scalar(source, destination, done, count);
+}
+
+void color_convert::unpremultiply(const uint8_t * source, uint8_t * destination, const size_t count)
+{
+    size_t done = 0;
+#if SPACETHEORY_SIMD_X86
+    done = cpu_features::get().avx2 ? unpremultiply_avx2(source, destination, count) : unpremultiply_sse2(source, destination, count);
+#endif
+    unpremultiply_scalar(source, destination, done, count);
+}
+
+void color_convert::srgb_to_linear(const uint8_t * source, float * destination, const size_t count)
+{
+    const srgb_tables& t = get_srgb_tables();
+    size_t done = 0;
+#if SPACETHEORY_SIMD_X86
+    if (cpu_features::get().avx2) done = srgb_to_linear_avx2(source, destination, count, t);
+#endif
+    srgb_to_linear_scalar(source, destination, done, count, t);
+}
+
+void color_convert::linear_to_srgb(const float * source, uint8_t * destination, const size_t count)
+{
+    const srgb_tables& t = get_srgb_tables();
+    size_t done = 0;
+#if SPACETHEORY_SIMD_X86
+    if (cpu_features::get().avx2) done = linear_to_srgb_avx2(source, destination, count, t);
+#endif
+    linear_to_srgb_scalar(source, destination, done, count, t);
+}
+
+// ----------------------------------------------------------------------------
+// COLOR
+// ----------------------------------------------------------------------------
+
+glm::vec4 color::linear() const
+{
+    float v[4];
+    color_convert::srgb_to_linear(this, v, 1);
+    return glm::vec4(v[0], v[1], v[2], v[3]);
+}
+
+color color::from_linear(const glm::vec4& linear)
+{
+    const float v[4] = { linear.r, linear.g, linear.b, linear.a };
+    color c;
+    color_convert::linear_to_srgb(v, &c, 1);
+    return c;
+}
\ No newline at end of file
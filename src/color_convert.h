@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+#include "color.h"
+
+namespace spacetheory {
+
+    // Bulk conversions over whole buffers, the per-pixel conversions in color
+    // are fine for a handful of colors but not for images or vertex colors.
+    // Pixels are 4 bytes in r, g, b, a order (the layout of color, and of
+    // decoded images), float pixels are 4 floats in the same order, and every
+    // count is in pixels.
+    //
+    // Each runs on AVX2, SSE2 or NEON where available and gives exactly the
+    // same bytes as its scalar loop; the formulas are spelled out below so
+    // callers know what they get. Where source and destination are the same
+    // size they may be the same buffer.
+    class color_convert {
+    public:
+        // Packed values between 0xRRGGBBAA (color::to_rgba) and 0xAABBGGRR
+        // (color::to_abgr), either way since it's a byte reversal:
+        static void swizzle(const uint32_t * source, uint32_t * destination, const size_t count);
+
+        // Pixels to packed color::to_rgba values and back:
+        static void to_rgba(const uint8_t * source, uint32_t * destination, const size_t count);
+        static void from_rgba(const uint32_t * source, uint8_t * destination, const size_t count);
+
+        // Channel / 255:
+        static void to_float(const uint8_t * source, float * destination, const size_t count);
+        // Channels clamped to [0, 1] (NaN becomes 0), then trunc(c * 255 + 0.5):
+        static void to_unorm8(const float * source, uint8_t * destination, const size_t count);
+
+        // Color channels become c * a / 255 rounded to nearest, alpha is kept:
+        static void premultiply(const uint8_t * source, uint8_t * destination, const size_t count);
+        // Color channels become min(trunc(c * (255 / a) + 0.5), 255), or 0 when
+        // alpha is 0, alpha is kept:
+        static void unpremultiply(const uint8_t * source, uint8_t * destination, const size_t count);
+
+        // sRGB encoded pixels to linear floats through a 256 entry table, alpha
+        // is converted like to_float:
+        static void srgb_to_linear(const uint8_t * source, float * destination, const size_t count);
+        // Linear floats to the nearest sRGB code, found with a 4096 entry table
+        // and one comparison against that code's lower edge. Clamped like
+        // to_unorm8, which is also what alpha goes through:
+        static void linear_to_srgb(const float * source, uint8_t * destination, const size_t count);
+
+        // THE SAME FOR COLORS:
+
+        static inline void to_rgba(const color * source, uint32_t * destination, const size_t count) { to_rgba((const uint8_t *) source, destination, count); }
+        static inline void from_rgba(const uint32_t * source, color * destination, const size_t count) { from_rgba(source, (uint8_t *) destination, count); }
+        static inline void to_float(const color * source, float * destination, const size_t count) { to_float((const uint8_t *) source, destination, count); }
+        static inline void to_unorm8(const float * source, color * destination, const size_t count) { to_unorm8(source, (uint8_t *) destination, count); }
+        static inline void premultiply(const color * source, color * destination, const size_t count) { premultiply((const uint8_t *) source, (uint8_t *) destination, count); }
+        static inline void unpremultiply(const color * source, color * destination, const size_t count) { unpremultiply((const uint8_t *) source, (uint8_t *) destination, count); }
+        static inline void srgb_to_linear(const color * source, float * destination, const size_t count) { srgb_to_linear((const uint8_t *) source, destination, count); }
+        static inline void linear_to_srgb(const float * source, color * destination, const size_t count) { linear_to_srgb(source, (uint8_t *) destination, count); }
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "cpu_features.h"
+#include <stdint.h>
+#if SPACETHEORY_SIMD_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+using namespace spacetheory;
+
+#if SPACETHEORY_SIMD_X86
+static void cpuid(int info[4], const int leaf, const int subleaf)
+{
+#if defined(_MSC_VER)
+    __cpuidex(info, leaf, subleaf);
+#else
+    unsigned int a = 0, b = 0, c = 0, d = 0;
+    __cpuid_count(leaf, subleaf, a, b, c, d);
+    info[0] = (int) a; info[1] = (int) b; info[2] = (int) c; info[3] = (int) d;
+#endif
+}
+
+static uint64_t xgetbv0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int eax = 0, edx = 0;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t) edx << 32) | eax;
+#endif
+}
+#endif
+
+static cpu_features detect()
+{
+    cpu_features f;
+
+#if SPACETHEORY_SIMD_X86
+    int info[4];
+    cpuid(info, 0, 0);
+    const int max_leaf = info[0];
+
+    cpuid(info, 1, 0);
+    f.sse2 = (info[3] & (1 << 26)) != 0;
+    f.sse41 = (info[2] & (1 << 19)) != 0;
+
+    // AVX needs the OS to save the YMM registers on context switches (XCR0
+    // bits 1 and 2), which it only reports through XGETBV when OSXSAVE is set:
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if(osxsave && avx && max_leaf >= 7 && (xgetbv0() & 0x6) == 0x6) {
+        cpuid(info, 7, 0);
+        f.avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#endif
+
+#if SPACETHEORY_SIMD_NEON
+    f.neon = true;
+#endif
+
+    return f;
+}
+
+const cpu_features& cpu_features::get()
+{
+    static const cpu_features features = detect();
+    return features;
+}
\ No newline at end of file
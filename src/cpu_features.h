@@ -0,0 +1,54 @@
+#pragma once
+
+// INSTRUCTION SETS:
+// SSE2 is always there on x86-64 (and what MSVC targets on x86 by default), so
+// it's used unconditionally. AVX2 is chosen at runtime with cpu_features, its
+// functions are compiled for it one at a time with SPACETHEORY_TARGET_AVX2.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SPACETHEORY_SIMD_X86 1
+#else
+#define SPACETHEORY_SIMD_X86 0
+#endif
+
+#if defined(__ARM_NEON) || defined(_M_ARM64) || defined(_M_ARM)
+#define SPACETHEORY_SIMD_NEON 1
+#else
+#define SPACETHEORY_SIMD_NEON 0
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SPACETHEORY_TARGET_AVX2
+#else
+#define SPACETHEORY_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace spacetheory {
+
+    struct cpu_features {
+        bool sse2 = false;
+        bool sse41 = false;
+        bool avx2 = false;      // Also checks that the OS saves the AVX registers
+        bool neon = false;
+
+        // Detected once, on first use:
+        static const cpu_features& get();
+    };
+
+    // Index of the lowest set bit, for walking SIMD compare masks. Undefined
+    // for 0:
+    inline unsigned lowest_bit(const unsigned mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return (unsigned) index;
+#else
+        return (unsigned) __builtin_ctz(mask);
+#endif
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,795 @@
+#include "benchmarks.h"
+#include <spacetheory.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using namespace spacetheory;
+
+namespace {
+
+    using bench_clock = std::chrono::steady_clock;
+
+    inline double elapsed_ns(const bench_clock::time_point& start)
+    {
+        return std::chrono::duration<double, std::nano>(bench_clock::now() - start).count();
+    }
+
+    // Keeps the optimizer from dropping work whose result isn't used:
+    volatile double sink;
+
+    // ------------------------------------------------------------------------
+    // ASYNC LOG
+    // ------------------------------------------------------------------------
+    // Time spent on the calling thread per message, against the synchronous
+    // logger the engine uses outside the game loop. Messages go out in bursts
+    // small enough for the rings, flushed between bursts outside the timing.
+
+    int async_log_benchmark()
+    {
+        const int bursts = 2000, burst_size = 64;
+        int failed = 0;
+
+        // SYNCHRONOUS:
+        {
+            xeekworx::logger sync_log;
+            xeekworx::logger::config config = xeekworx::logger::default_config();
+            config.file = "bench_sync.log";
+            config.output_to_file = true;
+            config.output_to_vs = false;
+            sync_log.enable(config);
+
+            double ns = 0.0;
+            for (int b = 0; b < bursts; ++b) {
+                const bench_clock::time_point start = bench_clock::now();
+                for (int i = 0; i < burst_size; ++i) {
+                    sync_log << LOGSTAMP << xeekworx::DEBUG << "Frame " << b << " took " << i * 0.25 << " ms" << std::endl;
+                }
+                ns += elapsed_ns(start);
+            }
+            printf("xeekworx::logger, 1 thread: %.1f ns per message\n", ns / (bursts * burst_size));
+        }
+
+        // ASYNCHRONOUS:
+        for (const int threads : { 1, 4 }) {
+            async_log::config config;
+            config.file = "bench_async.log";
+            async_log log(config);
+
+            std::vector<double> ns(threads, 0.0);
+            std::vector<std::thread> producers;
+            for (int t = 0; t < threads; ++t) {
+                producers.emplace_back([&log, &ns, t, bursts, burst_size]() {
+                    for (int b = 0; b < bursts; ++b) {
+                        const bench_clock::time_point start = bench_clock::now();
+                        for (int i = 0; i < burst_size; ++i) log.write(log_level::debug, "Frame %d took %.2f ms", b, i * 0.25);
+                        ns[t] += elapsed_ns(start);
+                        log.flush();
+                    }
+                });
+            }
+            for (std::thread& p : producers) p.join();
+
+            double total = 0.0;
+            for (const double n : ns) total += n;
+            const async_log::stats stats = log.get_stats();
+            printf("async_log, %d threads: %.1f ns per message, %llu written, %llu dropped\n", threads,
+                total / ((double) threads * bursts * burst_size), (unsigned long long) stats.written, (unsigned long long) stats.dropped);
+        }
+
+        // THREAD CHURN:
+        // Far more short-lived threads than rings, one after the other. Each
+        // exited thread's ring goes to the next, so nothing may be dropped.
+        {
+            async_log::config config;
+            config.file = "bench_async.log";
+            async_log log(config);
+
+            const int churn = (int) async_log::max_threads * 4;
+            for (int t = 0; t < churn; ++t) {
+                std::thread([&log, t]() {
+                    for (int i = 0; i < 8; ++i) log.write(log_level::debug, "Thread %d message %d", t, i);
+                }).join();
+            }
+            log.flush();
+
+            const async_log::stats stats = log.get_stats();
+            const bool ok = stats.dropped == 0 && stats.written == (uint64_t) churn * 8;
+            printf("async_log, %d threads in turn: %llu rings, %llu dropped: %s\n", churn,
+                (unsigned long long) stats.rings, (unsigned long long) stats.dropped, ok ? "OK" : "FAILED");
+            if (!ok) failed = 1;
+        }
+
+        return failed;
+    }
+
+    // ------------------------------------------------------------------------
+    // JOB SYSTEM
+    // ------------------------------------------------------------------------
+    // Overhead per job through each way in, how stolen jobs and parallel_for
+    // scale from 1 worker up to one per hardware thread, and exceptions coming
+    // back out of wait() instead of ending the process.
+
+    int job_system_benchmark()
+    {
+        job_system jobs;
+        const int count = 100000;
+        int failed = 0;
+        printf("%u worker threads\n", jobs.thread_count());
+
+        // EMPTY JOBS FROM THIS THREAD (the shared queue):
+        {
+            job_counter counter;
+            const bench_clock::time_point start = bench_clock::now();
+            for (int i = 0; i < count; ++i) jobs.run([]() {}, &counter);
+            jobs.wait(counter);
+            printf("run + wait from a non-worker: %.1f ns per job\n", elapsed_ns(start) / count);
+        }
+
+        // DEPENDENCY CHAIN:
+        // Every job starts once the previous one is done, nothing runs in parallel.
+        {
+            const int links = 10000;
+            std::vector<job_counter> counters(links);
+            const bench_clock::time_point start = bench_clock::now();
+            jobs.run([]() {}, &counters[0]);
+            for (int i = 1; i < links; ++i) jobs.run_after(counters[i - 1], []() {}, &counters[i]);
+            jobs.wait(counters[links - 1]);
+            printf("run_after chain: %.1f ns per link\n", elapsed_ns(start) / links);
+        }
+
+        // SCALING:
+        // Jobs submitted from a worker (its own deque, stolen by the others)
+        // and parallel_for, on a fresh job_system for each worker count up to
+        // one per hardware thread. parallel_for's calling thread takes part,
+        // so 1 worker already runs it on two threads. Best of a few runs.
+        {
+            const unsigned max_workers = std::max(std::thread::hardware_concurrency(), 1u);
+            const int runs = 3;
+
+            std::vector<float> values(1 << 22);
+            for (size_t i = 0; i < values.size(); ++i) values[i] = (float) i;
+            auto work = [&values](const size_t first, const size_t last) {
+                for (size_t i = first; i < last; ++i) values[i] = std::sqrt(values[i] * 1.0001f + 1.0f);
+            };
+
+            double serial = std::numeric_limits<double>::max();
+            for (int r = 0; r < runs; ++r) {
+                const bench_clock::time_point start = bench_clock::now();
+                work(0, values.size());
+                serial = std::min(serial, elapsed_ns(start));
+            }
+            sink = values[values.size() / 2];
+            printf("plain loop over %zu floats: %.2f ms, %.0f M floats/s\n", values.size(), serial / 1e6, values.size() / serial * 1e3);
+
+            double steal_base = 0.0, parallel_base = 0.0;
+            for (unsigned workers = 1; workers <= max_workers; ++workers) {
+                job_system scaled(workers);
+
+                double steal = std::numeric_limits<double>::max();
+                for (int r = 0; r < runs; ++r) {
+                    job_counter root;
+                    double ns = 0.0;
+                    scaled.run([&scaled, &ns, count]() {
+                        job_counter counter;
+                        const bench_clock::time_point start = bench_clock::now();
+                        for (int i = 0; i < count; ++i) scaled.run([]() {}, &counter);
+                        scaled.wait(counter);
+                        ns = elapsed_ns(start);
+                    }, &root);
+                    scaled.wait(root);
+                    steal = std::min(steal, ns);
+                }
+
+                double parallel = std::numeric_limits<double>::max();
+                for (int r = 0; r < runs; ++r) {
+                    const bench_clock::time_point start = bench_clock::now();
+                    scaled.parallel_for(0, values.size(), 4096, work);
+                    parallel = std::min(parallel, elapsed_ns(start));
+                }
+                sink = values[values.size() / 2];
+
+                if (workers == 1) {
+                    steal_base = steal;
+                    parallel_base = parallel;
+                }
+                printf("%2u workers: run + wait from a worker %6.2f M jobs/s (%.2fx), parallel_for %6.0f M floats/s (%.2fx, %.1fx the plain loop)\n",
+                    workers, count / steal * 1e3, steal_base / steal,
+                    values.size() / parallel * 1e3, parallel_base / parallel, serial / parallel);
+            }
+        }
+
+        // EXCEPTIONS:
+        {
+            job_counter counter;
+            for (int i = 0; i < 64; ++i) {
+                jobs.run([i]() { if (i % 8 == 3) throw std::runtime_error("job failed"); }, &counter);
+            }
+            bool caught = false;
+            try {
+                jobs.wait(counter);
+            }
+            catch (const std::runtime_error&) {
+                caught = true;
+            }
+
+            bool caught_chunk = false;
+            try {
+                jobs.parallel_for(0, 1000, 10, [](const size_t first, const size_t last) {
+                    if (first <= 500 && 500 < last) throw std::runtime_error("chunk failed");
+                });
+            }
+            catch (const std::runtime_error&) {
+                caught_chunk = true;
+            }
+
+            const bool ok = caught && caught_chunk && counter.done();
+            printf("exceptions rethrown by wait and parallel_for: %s\n", ok ? "OK" : "FAILED");
+            if (!ok) failed = 1;
+        }
+
+        return failed;
+    }
+
+    // ------------------------------------------------------------------------
+    // SPATIAL INDEX
+    // ------------------------------------------------------------------------
+    // Viewport-sized rect queries (culling) and point queries (hit-testing)
+    // through uniform_grid and loose_quadtree against a linear scan, at 1k,
+    // 10k and 100k entries, over a sweep of cell sizes and depths. Entries are
+    // mostly small with some large ones mixed in. Every query's hit count is
+    // checked against the scan.
+
+    struct spatial_workload {
+        rectangle area;
+        std::vector<rectangle> entries;
+        std::vector<rectangle> views;
+        std::vector<point> points;
+        std::vector<size_t> view_hits, point_hits; // From the linear scan
+    };
+
+    template <typename index>
+    int spatial_run(const char * name, const int parameter, index& idx, const spatial_workload& w)
+    {
+        std::vector<uint32_t> hits;
+        hits.reserve(w.entries.size());
+
+        bench_clock::time_point start = bench_clock::now();
+        for (size_t i = 0; i < w.entries.size(); ++i) idx.insert((uint32_t) i, w.entries[i]);
+        const double build = elapsed_ns(start);
+
+        bool ok = true;
+        start = bench_clock::now();
+        for (size_t q = 0; q < w.views.size(); ++q) {
+            hits.clear();
+            if (idx.query(w.views[q], hits) != w.view_hits[q]) ok = false;
+        }
+        const double views = elapsed_ns(start);
+
+        start = bench_clock::now();
+        for (size_t q = 0; q < w.points.size(); ++q) {
+            hits.clear();
+            if (idx.query(w.points[q], hits) != w.point_hits[q]) ok = false;
+        }
+        const double points = elapsed_ns(start);
+
+        // Everything nudged, the way moving entities are every frame:
+        start = bench_clock::now();
+        for (size_t i = 0; i < w.entries.size(); ++i) {
+            rectangle r = w.entries[i];
+            r.x += 3;
+            r.y -= 2;
+            idx.move((uint32_t) i, r);
+        }
+        const double moves = elapsed_ns(start);
+
+        printf("  %-20s %-4d build %7.2f ms, move %6.1f ns, rect query %9.2f us, point query %7.3f us%s\n", name, parameter,
+            build / 1e6, moves / w.entries.size(), views / w.views.size() / 1e3, points / w.points.size() / 1e3, ok ? "" : " MISMATCH");
+        return ok ? 0 : 1;
+    }
+
+    int spatial_index_benchmark()
+    {
+        int failed = 0;
+
+        for (const size_t count : { (size_t) 1000, (size_t) 10000, (size_t) 100000 }) {
+            // Same layout every run, the density stays the same at every count:
+            uint32_t seed = 12345;
+            auto next = [&seed](const int range) { seed = seed * 1664525u + 1013904223u; return (int) ((seed >> 8) % (uint32_t) range); };
+
+            spatial_workload w;
+            const int side = (int) std::sqrt((double) count) * 64;
+            w.area = rectangle(0, 0, side, side);
+            for (size_t i = 0; i < count; ++i) {
+                const int size = (i % 32 == 0) ? 64 + next(448) : 4 + next(60);
+                w.entries.push_back(rectangle(next(side), next(side), size, size));
+            }
+            for (int q = 0; q < 200; ++q) w.views.push_back(rectangle(next(side) - 640, next(side) - 360, 1280, 720));
+            for (int q = 0; q < 2000; ++q) w.points.push_back(point(next(side), next(side)));
+
+            // LINEAR SCAN:
+            bench_clock::time_point start = bench_clock::now();
+            for (const rectangle& v : w.views) {
+                size_t n = 0;
+                for (const rectangle& e : w.entries) n += e.has_intersection(v) ? 1 : 0;
+                w.view_hits.push_back(n);
+            }
+            const double views = elapsed_ns(start);
+
+            start = bench_clock::now();
+            for (const point& pt : w.points) {
+                size_t n = 0;
+                for (const rectangle& e : w.entries) n += e.contains(pt) ? 1 : 0;
+                w.point_hits.push_back(n);
+            }
+            const double points = elapsed_ns(start);
+
+            printf("%zu entries over %dx%d:\n", count, side, side);
+            printf("  %-58s rect query %9.2f us, point query %7.3f us\n",
+                "linear scan", views / w.views.size() / 1e3, points / w.points.size() / 1e3);
+
+            // UNIFORM GRID, BY CELL SIZE:
+            for (const int cell_size : { 16, 32, 64, 128, 256, 512 }) {
+                uniform_grid grid(w.area, cell_size);
+                failed |= spatial_run("uniform_grid cell", cell_size, grid, w);
+            }
+
+            // LOOSE QUADTREE, BY DEPTH:
+            for (const int depth : { 3, 4, 5, 6, 7, 8 }) {
+                loose_quadtree tree(w.area, depth);
+                failed |= spatial_run("loose_quadtree depth", depth, tree, w);
+            }
+        }
+
+        return failed;
+    }
+
+    // ------------------------------------------------------------------------
+    // ENCLOSE POINTS
+    // ------------------------------------------------------------------------
+    // rectangle::enclose_points over contiguous points (SSE2 or AVX2) against
+    // the one point at a time loop it replaced, with and without a clip
+    // rectangle. Results are checked at every count up to a few registers'
+    // worth, so every remainder goes through the scalar tail.
+
+    bool enclose_reference(const std::vector<point>& points, const size_t count, const rectangle * clip, rectangle& result)
+    {
+        if (clip && clip->empty()) return false;
+
+        bool found = false;
+        int min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const point& pt = points[i];
+            if (clip && !clip->contains(pt)) continue;
+            if (!found) {
+                min_x = max_x = pt.x;
+                min_y = max_y = pt.y;
+                found = true;
+                continue;
+            }
+            if (pt.x < min_x) min_x = pt.x;
+            if (pt.x > max_x) max_x = pt.x;
+            if (pt.y < min_y) min_y = pt.y;
+            if (pt.y > max_y) max_y = pt.y;
+        }
+        if (found) result = rectangle(min_x, min_y, (max_x - min_x) + 1, (max_y - min_y) + 1);
+        return found;
+    }
+
+    int enclose_points_benchmark()
+    {
+        int failed = 0;
+        uint32_t seed = 12345;
+        auto next = [&seed](const int range) { seed = seed * 1664525u + 1013904223u; return (int) ((seed >> 8) % (uint32_t) range); };
+
+        std::vector<point> points(1 << 16);
+        for (point& pt : points) pt = point(next(8192) - 4096, next(8192) - 4096);
+        const rectangle clip(-1000, -1500, 2500, 2000);
+        const rectangle empty_clip(10, 10, 0, 0);
+
+        // SAME RESULTS:
+        bool ok = true;
+        for (size_t count = 0; count <= 67; ++count) {
+            for (const rectangle * c : { (const rectangle *) nullptr, &clip, &empty_clip }) {
+                rectangle expected, actual;
+                const bool expected_found = enclose_reference(points, count, c, expected);
+                const bool found = rectangle::enclose_points(points.data(), count, c, &actual);
+                if (found != expected_found || (found && (actual.x != expected.x || actual.y != expected.y || actual.w != expected.w || actual.h != expected.h))) ok = false;
+            }
+        }
+        printf("enclose_points matches the scalar loop at counts 0 to 67: %s\n", ok ? "OK" : "FAILED");
+        if (!ok) failed = 1;
+
+        // THROUGHPUT:
+        for (const size_t count : { (size_t) 16, (size_t) 256, (size_t) 4096, (size_t) 65536 }) {
+            const int repeats = (int) ((1 << 24) / count);
+            for (const rectangle * c : { (const rectangle *) nullptr, &clip }) {
+                rectangle r;
+                bench_clock::time_point start = bench_clock::now();
+                for (int i = 0; i < repeats; ++i) {
+                    enclose_reference(points, count, c, r);
+                    sink = r.w;
+                }
+                const double scalar = elapsed_ns(start);
+
+                start = bench_clock::now();
+                for (int i = 0; i < repeats; ++i) {
+                    rectangle::enclose_points(points.data(), count, c, &r);
+                    sink = r.w;
+                }
+                const double simd = elapsed_ns(start);
+
+                const double per_point = 1.0 / ((double) repeats * count);
+                printf("%6zu points%s: scalar loop %.3f ns, enclose_points %.3f ns per point, %.1fx\n", count, c ? ", clipped" : "",
+                    scalar * per_point, simd * per_point, scalar / simd);
+            }
+        }
+
+        return failed;
+    }
+
+    // ------------------------------------------------------------------------
+    // COLOR PARSE
+    // ------------------------------------------------------------------------
+    // color::try_from_html over every html_colors name (in the case it's
+    // declared in and lowercased), hex in every length and text that's
+    // neither, against a linear search of the names. Every name has to come
+    // back with its own value, whatever the case.
+
+    bool linear_lookup(const std::string_view name, uint32_t& value)
+    {
+        for (const html_colors::named_color& c : html_colors::by_name) {
+            if (html_colors::detail::equal(c.name, name)) {
+                value = c.value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename parse>
+    double parse_ns(const std::vector<std::string>& texts, const int repeats, parse p)
+    {
+        const bench_clock::time_point start = bench_clock::now();
+        for (int r = 0; r < repeats; ++r) {
+            for (const std::string& t : texts) sink = p(t);
+        }
+        return elapsed_ns(start) / ((double) repeats * texts.size());
+    }
+
+    int color_parse_benchmark()
+    {
+        int failed = 0;
+
+        std::vector<std::string> names, lowercase, hex, misses;
+        for (const html_colors::named_color& c : html_colors::by_name) {
+            names.push_back(std::string(c.name));
+            std::string lower(c.name);
+            for (char& ch : lower) ch = html_colors::detail::lower(ch);
+            lowercase.push_back(lower);
+        }
+        hex = { "#fff", "#0f08", "#1e90ff", "#1e90ff80", "1E90FF", "#ABCDEF", "#00000000", "#c0c0c0" };
+        misses = { "darkslategrayish", "notacolor", "#12345", "#ggg", "", "blu", "Reddish", "#1e90ff8" };
+
+        // SAME VALUES:
+        bool ok = true;
+        for (size_t i = 0; i < names.size(); ++i) {
+            const color expected = color::from_rgba(html_colors::by_name[i].value);
+            color parsed, parsed_lower;
+            if (!color::try_from_html(names[i], parsed) || parsed != expected) ok = false;
+            if (!color::try_from_html(lowercase[i], parsed_lower) || parsed_lower != expected) ok = false;
+        }
+        for (const std::string& m : misses) {
+            uint32_t value = 0;
+            if (html_colors::lookup(m, value)) ok = false;
+        }
+        printf("%zu names found by the perfect hash in any case, misses rejected: %s\n", names.size(), ok ? "OK" : "FAILED");
+        if (!ok) failed = 1;
+
+        // THROUGHPUT:
+        const int repeats = 20000;
+        auto parse = [](const std::string& t) { color c; return color::try_from_html(t, c) ? (double) c.r : -1.0; };
+        auto lookup = [](const std::string& t) { uint32_t v = 0; return html_colors::lookup(t, v) ? (double) v : -1.0; };
+        auto linear = [](const std::string& t) { uint32_t v = 0; return linear_lookup(t, v) ? (double) v : -1.0; };
+        printf("names, perfect hash lookup: %.1f ns, linear search: %.1f ns\n", parse_ns(names, repeats, lookup), parse_ns(names, repeats, linear));
+        printf("misses, perfect hash lookup: %.1f ns, linear search: %.1f ns\n", parse_ns(misses, repeats * 16, lookup), parse_ns(misses, repeats * 16, linear));
+        printf("try_from_html: names %.1f ns, lowercase names %.1f ns, hex %.1f ns, neither %.1f ns\n",
+            parse_ns(names, repeats, parse), parse_ns(lowercase, repeats, parse), parse_ns(hex, repeats * 16, parse), parse_ns(misses, repeats * 16, parse));
+
+        return failed;
+    }
+
+    // ------------------------------------------------------------------------
+    // COLOR CONVERT
+    // ------------------------------------------------------------------------
+    // Every color_convert kernel against a plain version of the formula
+    // color_convert.h documents, at every count up to a few vector widths and
+    // from unaligned starts, so each vector loop and every remainder through
+    // the scalar tail is covered (NEON too, on AArch64). Floats include NaN,
+    // infinities and values out of range; premultiply, unpremultiply and the
+    // sRGB conversions are also checked exhaustively. Nothing past the count
+    // may be written.
+
+    double srgb_decode(const double encoded)
+    {
+        return encoded <= 0.04045 ? encoded / 12.92 : std::pow((encoded + 0.055) / 1.055, 2.4);
+    }
+
+    float reference_clamp(const float c)
+    {
+        if (!(c > 0.0f)) return 0.0f; // NaN too
+        return c < 1.0f ? c : 1.0f;
+    }
+
+    uint8_t reference_unorm8(const float c)
+    {
+        return (uint8_t) std::trunc(reference_clamp(c) * 255.0f + 0.5f);
+    }
+
+    // The largest code whose lower edge, halfway to the code below, is at or
+    // under the value:
+    uint8_t reference_srgb_code(const float c)
+    {
+        static std::vector<float> edges;
+        if (edges.empty()) {
+            edges.push_back(0.0f);
+            for (int code = 1; code < 256; ++code) edges.push_back((float) srgb_decode((code - 0.5) / 255.0));
+        }
+        const float x = reference_clamp(c);
+        int code = 0;
+        while (code < 255 && edges[code + 1] <= x) code++;
+        return (uint8_t) code;
+    }
+
+    void reference_swizzle(const uint32_t * s, uint32_t * d, const size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            const uint32_t v = s[i];
+            d[i] = ((v & 0xFF) << 24) | ((v & 0xFF00) << 8) | ((v >> 8) & 0xFF00) | (v >> 24);
+        }
+    }
+
+    void reference_to_rgba(const uint8_t * s, uint32_t * d, const size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) d[i] = color::to_rgba(color(s[i * 4], s[i * 4 + 1], s[i * 4 + 2], s[i * 4 + 3]));
+    }
+
+    void reference_from_rgba(const uint32_t * s, uint8_t * d, const size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            const color c = color::from_rgba(s[i]);
+            d[i * 4] = c.r;
+            d[i * 4 + 1] = c.g;
+            d[i * 4 + 2] = c.b;
+            d[i * 4 + 3] = c.a;
+        }
+    }
+
+    void reference_to_float(const uint8_t * s, float * d, const size_t count)
+    {
+        for (size_t i = 0; i < count * 4; ++i) d[i] = (float) s[i] / 255.0f;
+    }
+
+    void reference_to_unorm8(const float * s, uint8_t * d, const size_t count)
+    {
+        for (size_t i = 0; i < count * 4; ++i) d[i] = reference_unorm8(s[i]);
+    }
+
+    void reference_premultiply(const uint8_t * s, uint8_t * d, const size_t count)
+    {
+        for (size_t i = 0; i < count * 4; i += 4) {
+            const unsigned a = s[i + 3];
+            // c * a / 255 is never exactly halfway, 255 being odd:
+            for (int c = 0; c < 3; ++c) d[i + c] = (uint8_t) ((2 * s[i + c] * a + 255) / 510);
+            d[i + 3] = (uint8_t) a;
+        }
+    }
+
+    void reference_unpremultiply(const uint8_t * s, uint8_t * d, const size_t count)
+    {
+        for (size_t i = 0; i < count * 4; i += 4) {
+            const uint8_t a = s[i + 3];
+            for (int c = 0; c < 3; ++c) {
+                d[i + c] = a == 0 ? 0 : (uint8_t) std::min(std::trunc((float) s[i + c] * (255.0f / (float) a) + 0.5f), 255.0f);
+            }
+            d[i + 3] = a;
+        }
+    }
+
+    void reference_srgb_to_linear(const uint8_t * s, float * d, const size_t count)
+    {
+        for (size_t i = 0; i < count * 4; i += 4) {
+            for (int c = 0; c < 3; ++c) d[i + c] = (float) srgb_decode(s[i + c] / 255.0);
+            d[i + 3] = (float) s[i + 3] / 255.0f;
+        }
+    }
+
+    void reference_linear_to_srgb(const float * s, uint8_t * d, const size_t count)
+    {
+        for (size_t i = 0; i < count * 4; i += 4) {
+            for (int c = 0; c < 3; ++c) d[i + c] = reference_srgb_code(s[i + c]);
+            d[i + 3] = reference_unorm8(s[i + 3]);
+        }
+    }
+
+    // Elements per pixel of each buffer type, packed values are a pixel each:
+    template <typename T> constexpr size_t pixel_elements() { return std::is_same<T, uint32_t>::value ? 1 : 4; }
+
+    // Bytes compared, so -0.0 against 0.0 counts as a difference too:
+    template <typename source_type, typename destination_type>
+    bool convert_matches(const char * name, const std::vector<source_type>& input,
+        void (*kernel)(const source_type *, destination_type *, const size_t),
+        void (*reference)(const source_type *, destination_type *, const size_t))
+    {
+        const size_t in = pixel_elements<source_type>(), out = pixel_elements<destination_type>();
+        const size_t pixels = input.size() / in;
+        const size_t guard = 4; // Pixels past the count that must stay untouched
+        bool ok = true;
+
+        auto compare = [&](const size_t offset, const size_t count) {
+            std::vector<destination_type> expected((count + guard) * out), actual((count + guard) * out);
+            std::memset(expected.data(), 0xA5, expected.size() * sizeof(destination_type));
+            std::memset(actual.data(), 0xA5, actual.size() * sizeof(destination_type));
+            reference(input.data() + offset * in, expected.data(), count);
+            kernel(input.data() + offset * in, actual.data(), count);
+            if (std::memcmp(expected.data(), actual.data(), expected.size() * sizeof(destination_type)) != 0) ok = false;
+
+            // In place, where source and destination are the same size:
+            if constexpr (std::is_same<source_type, destination_type>::value) {
+                std::vector<destination_type> buffer(input.begin() + offset * in, input.begin() + (offset + count) * in);
+                kernel(buffer.data(), buffer.data(), count);
+                if (count && std::memcmp(expected.data(), buffer.data(), count * out * sizeof(destination_type)) != 0) ok = false;
+            }
+        };
+
+        // EVERY REMAINDER, FROM EVERY ALIGNMENT:
+        for (size_t offset = 0; offset < 8; ++offset) {
+            for (size_t count = 0; count <= 40 && offset + count <= pixels; ++count) compare(offset, count);
+        }
+        // ALL OF IT:
+        compare(0, pixels);
+        compare(3, pixels - 3);
+
+        // ALL OF IT ONE PIXEL AT A TIME, which only the scalar loop takes:
+        std::vector<destination_type> expected(pixels * out), actual(pixels * out);
+        reference(input.data(), expected.data(), pixels);
+        for (size_t i = 0; i < pixels; ++i) kernel(input.data() + i * in, actual.data() + i * out, 1);
+        if (std::memcmp(expected.data(), actual.data(), expected.size() * sizeof(destination_type)) != 0) ok = false;
+
+        printf("%s: %s\n", name, ok ? "OK" : "FAILED");
+        return ok;
+    }
+
+    template <typename source_type, typename destination_type>
+    void convert_time(const char * name, const std::vector<source_type>& input,
+        void (*kernel)(const source_type *, destination_type *, const size_t),
+        void (*reference)(const source_type *, destination_type *, const size_t))
+    {
+        const size_t pixels = input.size() / pixel_elements<source_type>();
+        std::vector<destination_type> output(pixels * pixel_elements<destination_type>());
+        const int repeats = 50;
+
+        bench_clock::time_point start = bench_clock::now();
+        for (int r = 0; r < repeats; ++r) {
+            reference(input.data(), output.data(), pixels);
+            sink = (double) output[r % output.size()];
+        }
+        const double plain = elapsed_ns(start);
+
+        start = bench_clock::now();
+        for (int r = 0; r < repeats; ++r) {
+            kernel(input.data(), output.data(), pixels);
+            sink = (double) output[r % output.size()];
+        }
+        const double converted = elapsed_ns(start);
+
+        const double per_pixel = 1.0 / ((double) repeats * pixels);
+        printf("  %-15s %.2f ns per pixel, plain loop %.2f ns, %.1fx\n", name, converted * per_pixel, plain * per_pixel, plain / converted);
+    }
+
+    int color_convert_benchmark()
+    {
+        uint32_t seed = 12345;
+        auto next = [&seed]() { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+
+        // BYTES:
+        // Random pixels, then every (channel, alpha) pair and every code.
+        std::vector<uint8_t> bytes;
+        for (int i = 0; i < 4096 * 4; ++i) bytes.push_back((uint8_t) next());
+        for (int a = 0; a < 256; ++a) {
+            for (int c = 0; c < 256; ++c) {
+                const uint8_t pixel[4] = { (uint8_t) c, (uint8_t) (255 - c), (uint8_t) (c ^ a), (uint8_t) a };
+                bytes.insert(bytes.end(), pixel, pixel + 4);
+            }
+        }
+        std::vector<uint32_t> packed(bytes.size() / 4);
+        std::memcpy(packed.data(), bytes.data(), bytes.size());
+
+        // FLOATS:
+        // Random values around [0, 1], values that aren't numbers or are far
+        // out of range, then both sides of every unorm8 rounding point and of
+        // every sRGB code's lower edge.
+        const float specials[] = { std::numeric_limits<float>::quiet_NaN(), -std::numeric_limits<float>::quiet_NaN(),
+            std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(), -0.0f, 0.0f, 1.0f, -1.0f, 2.0f,
+            1e30f, -1e30f, std::numeric_limits<float>::denorm_min(), std::numeric_limits<float>::min(), std::nextafter(1.0f, 2.0f),
+            std::nextafter(1.0f, 0.0f), 0.5f / 255.0f };
+        std::vector<float> floats;
+        for (int i = 0; i < 4096 * 4; ++i) {
+            if (i % 7 == 3) floats.push_back(specials[next() % (sizeof(specials) / sizeof(specials[0]))]);
+            else floats.push_back((float) (next() % 1000000) / 800000.0f - 0.125f);
+        }
+        for (int code = 0; code < 256; ++code) {
+            const float rounding = (code + 0.5f) / 255.0f;
+            const float edge = (float) srgb_decode((code + 0.5) / 255.0);
+            for (const float v : { rounding, edge }) {
+                floats.push_back(std::nextafter(v, -1.0f));
+                floats.push_back(v);
+                floats.push_back(std::nextafter(v, 2.0f));
+            }
+        }
+        while (floats.size() % 4) floats.push_back(0.0f);
+
+        // SAME BYTES:
+        bool ok = true;
+        ok &= convert_matches<uint32_t, uint32_t>("swizzle", packed, color_convert::swizzle, reference_swizzle);
+        ok &= convert_matches<uint8_t, uint32_t>("to_rgba", bytes, color_convert::to_rgba, reference_to_rgba);
+        ok &= convert_matches<uint32_t, uint8_t>("from_rgba", packed, color_convert::from_rgba, reference_from_rgba);
+        ok &= convert_matches<uint8_t, float>("to_float", bytes, color_convert::to_float, reference_to_float);
+        ok &= convert_matches<float, uint8_t>("to_unorm8", floats, color_convert::to_unorm8, reference_to_unorm8);
+        ok &= convert_matches<uint8_t, uint8_t>("premultiply", bytes, color_convert::premultiply, reference_premultiply);
+        ok &= convert_matches<uint8_t, uint8_t>("unpremultiply", bytes, color_convert::unpremultiply, reference_unpremultiply);
+        ok &= convert_matches<uint8_t, float>("srgb_to_linear", bytes, color_convert::srgb_to_linear, reference_srgb_to_linear);
+        ok &= convert_matches<float, uint8_t>("linear_to_srgb", floats, color_convert::linear_to_srgb, reference_linear_to_srgb);
+
+        // THROUGHPUT:
+        printf("%zu pixels at a time:\n", bytes.size() / 4);
+        convert_time<uint32_t, uint32_t>("swizzle", packed, color_convert::swizzle, reference_swizzle);
+        convert_time<uint8_t, uint32_t>("to_rgba", bytes, color_convert::to_rgba, reference_to_rgba);
+        convert_time<uint32_t, uint8_t>("from_rgba", packed, color_convert::from_rgba, reference_from_rgba);
+        convert_time<uint8_t, float>("to_float", bytes, color_convert::to_float, reference_to_float);
+        convert_time<float, uint8_t>("to_unorm8", floats, color_convert::to_unorm8, reference_to_unorm8);
+        convert_time<uint8_t, uint8_t>("premultiply", bytes, color_convert::premultiply, reference_premultiply);
+        convert_time<uint8_t, uint8_t>("unpremultiply", bytes, color_convert::unpremultiply, reference_unpremultiply);
+        convert_time<uint8_t, float>("srgb_to_linear", bytes, color_convert::srgb_to_linear, reference_srgb_to_linear);
+        convert_time<float, uint8_t>("linear_to_srgb", floats, color_convert::linear_to_srgb, reference_linear_to_srgb);
+
+        return ok ? 0 : 1;
+    }
+
+    // ------------------------------------------------------------------------
+    // REGISTRY
+    // ------------------------------------------------------------------------
+
+    struct benchmark {
+        const char * name;
+        int (*run)();
+    };
+
+    const benchmark benchmarks[] = {
+        { "async_log", async_log_benchmark },
+        { "job_system", job_system_benchmark },
+        { "spatial_index", spatial_index_benchmark },
+        { "enclose_points", enclose_points_benchmark },
+        { "color_parse", color_parse_benchmark },
+        { "color_convert", color_convert_benchmark },
+    };
+
+}
+
+bool run_benchmark(const std::string& name, int& exitcode)
+{
+    for (const benchmark& b : benchmarks) {
+        if (name == b.name) {
+            exitcode = b.run();
+            return true;
+        }
+    }
+    return false;
+}
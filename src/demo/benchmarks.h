@@ -0,0 +1,10 @@
+#pragma once
+#include <string>
+
+// Micro-benchmarks and checks of engine code that runs without a window, with
+// "demo --bench <name>" instead of the demo. The ones that render are scenes
+// (see demo_scenes.h). Results go to stdout.
+//
+// Returns false if there's no benchmark by that name, otherwise exitcode is
+// set, non-zero when one of its checks failed.
+bool run_benchmark(const std::string& name, int& exitcode);
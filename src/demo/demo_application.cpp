@@ -1,4 +1,5 @@
 #include "demo_application.h"
+#include <iostream>
 
 demo_application::demo_application()
 {
@@ -11,6 +12,12 @@ demo_application::demo_application()
 
 demo_application::~demo_application()
 {
+    if (m_scene) {
+        const std::string summary = m_scene->summary();
+        applog << LOGSTAMP << xeekworx::NOTICE << summary << std::endl;
+        std::cout << summary << std::endl;
+    }
+
     applog << LOGSTAMP << xeekworx::DEBUG << "Demo application destructed" << std::endl;
 }
 
@@ -23,5 +30,35 @@ bool demo_application::on_start(const std::vector<std::string>& args, spacetheor
     disp_setup.name = "Spacetheory Demo Application";
     gfx_setup.vsync = false;
 
+    // Without vsync, cap the frame rate instead of rendering identical frames
+    // as fast as possible:
+    spacetheory::loop_setup loop = get_loop_setup();
+    loop.frame_rate_cap = 144.0;
+
+    // BENCHMARK SCENES:
+    // "--bench <scene> [--frames <count>]" renders the scene headless and as
+    // fast as possible, then quits and reports.
+    for (size_t i = 1; i + 1 < args.size(); ++i) {
+        if (args[i] == "--bench") {
+            m_scene = demo_scene::create(args[i + 1]);
+            if (!m_scene) {
+                applog << LOGSTAMP << xeekworx::ERR << "There's no benchmark named " << args[i + 1] << std::endl;
+                return false;
+            }
+            disp_setup.mode = spacetheory::window_mode::headless;
+            loop.frame_rate_cap = 0.0;
+            if (!loop.frame_limit) loop.frame_limit = 1000;
+        }
+        else if (args[i] == "--frames") loop.frame_limit = std::stoull(args[i + 1]);
+    }
+
+    set_loop_setup(loop);
+
     return true;
 }
+
+void demo_application::on_render(const double alpha)
+{
+    if (m_scene) m_scene->render(*graphics());
+    else spacetheory::application::on_render(alpha);
+}
@@ -1,11 +1,14 @@
 #pragma once
 #include <spacetheory.h>
+#include <memory>
+#include "demo_scenes.h"
 
 class demo_application :
     public spacetheory::application
 {
 private:
     xeekworx::logger applog;
+    std::unique_ptr<demo_scene> m_scene; // Only for benchmark runs
 
 public:
     demo_application();
@@ -13,5 +16,6 @@ public:
 
 protected:
     bool on_start(const std::vector<std::string>& args, spacetheory::display_setup& disp_setup, spacetheory::graphics_setup& gfx_setup) override;
+    void on_render(const double alpha) override;
 };
 
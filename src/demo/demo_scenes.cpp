@@ -0,0 +1,175 @@
+#include "demo_scenes.h"
+#include <vector>
+#include <sstream>
+
+using namespace spacetheory;
+
+void demo_scene::render(graphics2d& g)
+{
+    // Frames are timed start to start, so each one includes the previous
+    // frame's present, which waits for the GPU when headless:
+    m_last = std::chrono::steady_clock::now();
+    if (m_frames++ == 0) m_first = m_last;
+
+    g.begin();
+    draw(g);
+    g.end();
+}
+
+std::string demo_scene::summary() const
+{
+    if (m_frames < 2) return "Too few frames to measure";
+
+    const double seconds = std::chrono::duration<double>(m_last - m_first).count();
+    return report(seconds, m_frames - 1);
+}
+
+// ----------------------------------------------------------------------------
+// RECTS
+// ----------------------------------------------------------------------------
+// Filled, bordered and rounded rectangles, everything the quad batch takes.
+// The same items go through NanoVG paths instead (nvgRect and
+// nvgRoundedRectVarying, the way they were drawn before batching) with
+// "rects_nanovg", for the rate with and without the batch.
+
+class rects_scene : public demo_scene
+{
+private:
+    static const size_t count = 20000;
+    const bool m_batched;
+
+    struct item {
+        rectangle rect;
+        color fill;
+        int kind;
+    };
+    std::vector<item> m_items;
+
+protected:
+    void draw(graphics2d& g) override
+    {
+        g.set_batching(m_batched);
+        g.clear(graphics2d::black);
+        for (item& i : m_items) {
+            switch (i.kind) {
+            case 0: g.fill_rect(i.rect, i.fill); break;
+            case 1: g.draw_rect(i.rect, 2.0f, graphics2d::white, i.fill); break;
+            default: g.draw_roundrect(i.rect, corner_radius(6.0f), 1.0f, graphics2d::white, i.fill); break;
+            }
+        }
+        g.set_batching(true);
+    }
+
+    std::string report(const double seconds, const unsigned long long frames) const override
+    {
+        std::ostringstream s;
+        s << (m_batched ? "rects (quad batch): " : "rects (NanoVG paths): ") << count << " per frame, " << (unsigned long long) (count * frames / seconds) << " rects/s";
+        return s.str();
+    }
+
+public:
+    rects_scene(const bool batched) : m_batched(batched)
+    {
+        // Same layout every run:
+        uint32_t seed = 12345;
+        auto next = [&seed](const int range) { seed = seed * 1664525u + 1013904223u; return (int) ((seed >> 8) % (uint32_t) range); };
+
+        m_items.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            item it = { rectangle(next(1240), next(680), 8 + next(32), 8 + next(32)),
+                color((uint8_t) next(256), (uint8_t) next(256), (uint8_t) next(256), (uint8_t) 192), (int) (i % 4 == 3 ? 2 : i % 2) };
+            m_items.push_back(it);
+        }
+    }
+};
+
+// ----------------------------------------------------------------------------
+// CLEAR
+// ----------------------------------------------------------------------------
+// The whole target and then clipped tiles set to a color, with clear() (GL
+// clears scissored through the state cache) or, for comparison, with
+// fill_rect() as quads through the batch ("clear_quads") or as NanoVG rect
+// paths, the way clear() used to fill ("clear_nanovg").
+
+class clear_scene : public demo_scene
+{
+public:
+    enum class method { clear, quads, nanovg };
+
+private:
+    static const int tiles = 256;
+    const method m_method;
+    rectangle m_tiles[tiles];
+    color m_colors[tiles];
+
+    // What clear() used to be: a NanoVG rect path over the area, with the
+    // transform and clip reset around it and put back after:
+    static void fill_nanovg(graphics2d& g, rectangle& rect, const color& c)
+    {
+        const graphics2d::drawing_state state = g.get_drawing_state();
+        g.reset_transform();
+        g.reset_clip();
+        g.fill_rect(rect, c);
+        g.set_drawing_state(state);
+    }
+
+protected:
+    void draw(graphics2d& g) override
+    {
+        rectangle full(0, 0, (int) g.width(), (int) g.height());
+        g.set_batching(m_method != method::nanovg);
+
+        switch (m_method) {
+        case method::clear:
+            g.clear(graphics2d::black);
+            for (int i = 0; i < tiles; ++i) {
+                g.clip(m_tiles[i]);
+                g.clear(m_colors[i]);
+            }
+            g.reset_clip();
+            break;
+        case method::quads:
+            g.fill_rect(full, graphics2d::black);
+            for (int i = 0; i < tiles; ++i) g.fill_rect(m_tiles[i], m_colors[i]);
+            break;
+        case method::nanovg:
+            fill_nanovg(g, full, graphics2d::black);
+            for (int i = 0; i < tiles; ++i) fill_nanovg(g, m_tiles[i], m_colors[i]);
+            break;
+        }
+
+        g.set_batching(true);
+    }
+
+    std::string report(const double seconds, const unsigned long long frames) const override
+    {
+        static const char * const names[] = { "clear: ", "clear_quads: ", "clear_nanovg: " };
+        std::ostringstream s;
+        s << names[(int) m_method] << "1 full and " << tiles << " tiles per frame, "
+            << (unsigned long long) (frames * (tiles + 1) / seconds) << " fills/s";
+        return s.str();
+    }
+
+public:
+    clear_scene(const method m) : m_method(m)
+    {
+        // Same layout every run, opaque so both ways give the same picture:
+        uint32_t seed = 54321;
+        auto next = [&seed](const int range) { seed = seed * 1664525u + 1013904223u; return (int) ((seed >> 8) % (uint32_t) range); };
+
+        for (int i = 0; i < tiles; ++i) {
+            m_tiles[i] = rectangle(next(1200), next(640), 16 + next(160), 16 + next(120));
+            m_colors[i] = color((uint8_t) next(256), (uint8_t) next(256), (uint8_t) next(256), (uint8_t) 255);
+        }
+    }
+};
+
+std::unique_ptr<demo_scene> demo_scene::create(const std::string& name)
+{
+    if (name == "rects") return std::make_unique<rects_scene>(true);
+    if (name == "rects_nanovg") return std::make_unique<rects_scene>(false);
+    if (name == "clear") return std::make_unique<clear_scene>(clear_scene::method::clear);
+    if (name == "clear_quads") return std::make_unique<clear_scene>(clear_scene::method::quads);
+    if (name == "clear_nanovg") return std::make_unique<clear_scene>(clear_scene::method::nanovg);
+    return nullptr;
+}
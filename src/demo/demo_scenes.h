@@ -0,0 +1,30 @@
+#pragma once
+#include <spacetheory.h>
+#include <memory>
+#include <string>
+#include <chrono>
+
+// Benchmark scenes, rendered headless for a fixed number of frames with
+// "demo --bench <scene> [--frames <count>]". The engine logs the frame times
+// when the frame limit is reached, each scene adds its own throughput. The
+// ones that don't render are in benchmarks.h.
+class demo_scene
+{
+private:
+    std::chrono::steady_clock::time_point m_first, m_last;
+    unsigned long long m_frames = 0;
+
+protected:
+    virtual void draw(spacetheory::graphics2d& g) = 0;
+    // Throughput over the frames rendered, work done per second:
+    virtual std::string report(const double seconds, const unsigned long long frames) const = 0;
+
+public:
+    virtual ~demo_scene() {}
+
+    void render(spacetheory::graphics2d& g);
+    std::string summary() const;
+
+    // nullptr for a name that isn't a scene:
+    static std::unique_ptr<demo_scene> create(const std::string& name);
+};
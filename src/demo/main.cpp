@@ -1,12 +1,21 @@
-#include "demo_application.h"
-#include <memory>
-
-int main(int argc, char *argv[])
-{
-    int exitcode = 0;
-    {
-        std::unique_ptr<demo_application> app = std::make_unique<demo_application>();
-        exitcode = app->run(argc, argv);
-    }
-    return exitcode;
+#include "demo_application.h"
+#include "benchmarks.h"
+#include <memory>
+#include <string>
+
+int main(int argc, char *argv[])
+{
+    int exitcode = 0;
+
+    // Benchmarks that don't need the engine running, the ones that render are
+    // scenes the application picks up:
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--bench" && run_benchmark(argv[i + 1], exitcode)) return exitcode;
+    }
+
+    {
+        std::unique_ptr<demo_application> app = std::make_unique<demo_application>();
+        exitcode = app->run(argc, argv);
+    }
+    return exitcode;
 }
\ No newline at end of file
@@ -1,11 +1,16 @@
 #include "display.h"
 #include "error.h"
 #include "logger.h"
+#include "logging.h"
 #include <SDL.h>
+#include <glad\glad.h>
 
 using namespace spacetheory;
 
-display::display(const display_setup& setup) : m_sdlwindow(nullptr), m_glcontext(nullptr)
+display::display(const display_setup& setup) 
+    : m_sdlwindow(nullptr), m_glcontext(nullptr), m_headless(setup.mode == window_mode::headless),
+    m_width(setup.bounds.w), m_height(setup.bounds.h),
+    m_framebuffer(0), m_color_buffer(0), m_depth_stencil_buffer(0), m_gl_state(new gl_state_cache())
 {
     // LOG BOUNDS:
     xeekworx::log << LOGSTAMP << xeekworx::logtype::DEBUG << "Game window setup ..." << std::endl;
@@ -49,6 +54,10 @@ display::display(const display_setup& setup) : m_sdlwindow(nullptr), m_glcontext
     case window_mode::windowed:
         xeekworx::log << "Windowed" << std::endl;
         break;
+    case window_mode::headless:
+        wndflags |= SDL_WINDOW_HIDDEN;
+        xeekworx::log << "Headless" << std::endl;
+        break;
     default:
         xeekworx::log << "Unknown" << std::endl;
         break;
@@ -62,18 +71,30 @@ display::display(const display_setup& setup) : m_sdlwindow(nullptr), m_glcontext
         setup.bounds.w, setup.bounds.h,
         wndflags
     );
+    if (m_sdlwindow == NULL && m_headless) {
+        // Without a display server (build farms, CI) the regular video driver
+        // can't create even a hidden window. SDL's offscreen driver can, with
+        // an EGL context on Mesa's llvmpipe for example:
+        xeekworx::log << LOGSTAMP << xeekworx::logtype::WARNING << "Hidden window failed (" << SDL_GetError() << "), retrying with the offscreen video driver" << std::endl;
+        SDL_VideoQuit();
+        if (SDL_VideoInit("offscreen") == 0) {
+            m_sdlwindow = SDL_CreateWindow(setup.name.c_str(), x, y, setup.bounds.w, setup.bounds.h, wndflags);
+        }
+    }
     if (m_sdlwindow == NULL) {
         const std::string msg = "SDL_CreateWindow() failed with error: " + std::string(SDL_GetError());
         xeekworx::log << LOGSTAMP << xeekworx::logtype::ERR << msg << std::endl;
         throw(spacetheory::error(msg));
     }
 
-    xeekworx::log << LOGSTAMP << xeekworx::logtype::DEBUG2 << "Game window constructed" << std::endl;
+    SPACETHEORY_LOG(log_level::debug2) << "Game window constructed" << std::endl;
 }
 
 display::~display()
 {
+    if (gl_state_cache::current() == m_gl_state.get()) gl_state_cache::set_current(nullptr);
     if (m_glcontext) {
+        delete_offscreen_target();
         SDL_GL_DeleteContext((SDL_GLContext)m_glcontext);
         m_glcontext = nullptr;
     }
@@ -82,15 +103,81 @@ display::~display()
         m_sdlwindow = nullptr;
     }
 
-    xeekworx::log << LOGSTAMP << xeekworx::logtype::DEBUG2 << "Game window destroyed" << std::endl;
+    SPACETHEORY_LOG(log_level::debug2) << "Game window destroyed" << std::endl;
+}
+
+bool display::create_offscreen_target(const bool srgb)
+{
+    if (!m_headless || m_framebuffer) return true;
+
+    // A hidden window's own framebuffer may not be rendered at all (pixel
+    // ownership), so headless rendering goes to a framebuffer object the size
+    // of the requested bounds:
+    glGenRenderbuffers(1, &m_color_buffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_color_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, m_width, m_height);
+    glGenRenderbuffers(1, &m_depth_stencil_buffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depth_stencil_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_width, m_height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_color_buffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depth_stencil_buffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        xeekworx::log << LOGSTAMP << xeekworx::logtype::ERR << "Headless framebuffer is incomplete" << std::endl;
+        delete_offscreen_target();
+        return false;
+    }
+
+    glViewport(0, 0, m_width, m_height);
+    xeekworx::log << LOGSTAMP << xeekworx::logtype::DEBUG << "Headless framebuffer created (" << m_width << " x " << m_height << ")" << std::endl;
+    return true;
+}
+
+void display::delete_offscreen_target()
+{
+    if (m_framebuffer) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &m_framebuffer);
+        m_framebuffer = 0;
+        m_gl_state->forget(gl_state_cache::framebuffer_state);
+    }
+    if (m_color_buffer) {
+        glDeleteRenderbuffers(1, &m_color_buffer);
+        m_color_buffer = 0;
+    }
+    if (m_depth_stencil_buffer) {
+        glDeleteRenderbuffers(1, &m_depth_stencil_buffer);
+        m_depth_stencil_buffer = 0;
+    }
 }
 
 void display::make_current() const
 {
     SDL_GL_MakeCurrent((SDL_Window*)m_sdlwindow, (SDL_GLContext)m_glcontext);
+
+    // Whatever happened to the context while it wasn't current here, the
+    // shadow state doesn't know about:
+    m_gl_state->forget();
+    gl_state_cache::set_current(m_gl_state.get());
+    if (m_framebuffer) m_gl_state->bind_framebuffer(m_framebuffer);
+}
+
+void display::release_current() const
+{
+    if (gl_state_cache::current() == m_gl_state.get()) gl_state_cache::set_current(nullptr);
+    SDL_GL_MakeCurrent((SDL_Window*)m_sdlwindow, NULL);
 }
 
 void display::present() const
 {
-    SDL_GL_SwapWindow((SDL_Window*)m_sdlwindow);
+    if (m_headless) {
+        // Nothing to swap; waiting for the GPU keeps frame times honest instead
+        // of letting the driver queue up frames without a swap to throttle it.
+        glFinish();
+    }
+    else SDL_GL_SwapWindow((SDL_Window*)m_sdlwindow);
 }
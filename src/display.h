@@ -2,7 +2,9 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <stdint.h>
 #include "display_setup.h"
+#include "gl_state_cache.h"
 
 namespace spacetheory {
 
@@ -14,14 +16,30 @@ namespace spacetheory {
     private:
         void * m_sdlwindow;
         void * m_glcontext;
+        bool m_headless;
+        int m_width, m_height;
+
+        // Headless rendering target, used instead of the window's framebuffer:
+        uint32_t m_framebuffer;
+        uint32_t m_color_buffer;
+        uint32_t m_depth_stencil_buffer;
+
+        std::unique_ptr<gl_state_cache> m_gl_state; // For the context, current along with it
 
         display(const display_setup& setup);
 
+        bool create_offscreen_target(const bool srgb = false); // after the OpenGL context is created
+        void delete_offscreen_target();
+
     public:
         ~display();
 
         void make_current() const;
+        void release_current() const; // So another thread can make it current
         void present() const;
+
+        bool is_headless() const { return m_headless; }
+        gl_state_cache * gl_state() const { return m_gl_state.get(); }
     };
 
 }
\ No newline at end of file
@@ -5,7 +5,8 @@
 namespace spacetheory {
 
     enum class window_mode {
-        windowed, fullscreen, native_fullscreen
+        windowed, fullscreen, native_fullscreen,
+        headless // hidden window, rendering goes to an offscreen framebuffer
     };
 
     enum class window_positioning {
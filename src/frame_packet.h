@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+#include "graphics2d_command_list.h"
+
+namespace spacetheory {
+
+    // What the main thread hands the renderer for one frame. Filled in by
+    // application::on_prepare_frame, rendered by on_render_frame; with a
+    // render thread the two run on different threads, so anything rendering
+    // needs from the simulation has to be copied in here.
+    struct frame_packet {
+        uint64_t frame = 0;     // Profiler frame number
+        double time = 0.0;      // Simulated seconds, interpolated
+        double alpha = 0.0;     // How far between the last two updates (0 to 1)
+        graphics2d_command_list commands; // Emptied before on_prepare_frame, replayed by the default on_render_frame
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,268 @@
+#include "gl_state_cache.h"
+#include <glad\glad.h>
+
+using namespace spacetheory;
+
+const unsigned spacetheory::gl_state_cache::texture_units;
+thread_local gl_state_cache * spacetheory::gl_state_cache::s_current = nullptr;
+
+gl_state_cache::gl_state_cache()
+    : m_known(0), m_viewport(), m_blend(false), m_blend_src(GL_ONE), m_blend_dst(GL_ZERO),
+    m_framebuffer(0), m_program(0), m_active_texture(0), m_textures(), m_scissor(false), m_scissor_box(),
+    m_unpack_alignment(4), m_depth_test(false), m_cull_face(false)
+{
+}
+
+gl_state_cache& gl_state_cache::active()
+{
+    if(s_current) return *s_current;
+
+    static thread_local gl_state_cache fallback;
+    fallback.forget();
+    return fallback;
+}
+
+void gl_state_cache::forget(const uint32_t states)
+{
+    m_known &= ~states;
+}
+
+void gl_state_cache::viewport(const int x, const int y, const int width, const int height)
+{
+    if(known(viewport_state) && m_viewport[0] == x && m_viewport[1] == y && m_viewport[2] == width && m_viewport[3] == height) {
+        avoided();
+        return;
+    }
+
+    glViewport(x, y, width, height);
+    m_viewport[0] = x;
+    m_viewport[1] = y;
+    m_viewport[2] = width;
+    m_viewport[3] = height;
+    m_known |= viewport_state;
+    called();
+}
+
+const int * gl_state_cache::get_viewport()
+{
+    if(!known(viewport_state)) {
+        glGetIntegerv(GL_VIEWPORT, m_viewport);
+        m_known |= viewport_state;
+        m_frame.queries++;
+    }
+    return m_viewport;
+}
+
+void gl_state_cache::enable_blend(const bool enable)
+{
+    // Known blend state covers both the switch and the function, so forgetting
+    // it sets both again:
+    if(known(blend_state) && m_blend == enable) {
+        avoided();
+        return;
+    }
+
+    if(enable) glEnable(GL_BLEND);
+    else glDisable(GL_BLEND);
+    m_blend = enable;
+    called();
+
+    if(!known(blend_state)) {
+        glBlendFunc(m_blend_src, m_blend_dst);
+        m_known |= blend_state;
+        called();
+    }
+}
+
+void gl_state_cache::blend_func(const uint32_t src, const uint32_t dst)
+{
+    if(known(blend_state) && m_blend_src == src && m_blend_dst == dst) {
+        avoided();
+        return;
+    }
+
+    glBlendFunc(src, dst);
+    m_blend_src = src;
+    m_blend_dst = dst;
+    called();
+
+    if(!known(blend_state)) {
+        if(m_blend) glEnable(GL_BLEND);
+        else glDisable(GL_BLEND);
+        m_known |= blend_state;
+        called();
+    }
+}
+
+void gl_state_cache::bind_framebuffer(const uint32_t framebuffer)
+{
+    if(known(framebuffer_state) && m_framebuffer == framebuffer) {
+        avoided();
+        return;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    m_framebuffer = framebuffer;
+    m_known |= framebuffer_state;
+    called();
+}
+
+uint32_t gl_state_cache::get_framebuffer()
+{
+    if(!known(framebuffer_state)) {
+        GLint binding = 0;
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &binding);
+        m_framebuffer = (uint32_t) binding;
+        m_known |= framebuffer_state;
+        m_frame.queries++;
+    }
+    return m_framebuffer;
+}
+
+void gl_state_cache::use_program(const uint32_t program)
+{
+    if(known(program_state) && m_program == program) {
+        avoided();
+        return;
+    }
+
+    glUseProgram(program);
+    m_program = program;
+    m_known |= program_state;
+    called();
+}
+
+void gl_state_cache::active_texture(const unsigned unit)
+{
+    if(known(texture_state) && m_active_texture == unit) {
+        avoided();
+        return;
+    }
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    m_active_texture = unit;
+    called();
+}
+
+void gl_state_cache::bind_texture_2d(const unsigned unit, const uint32_t texture)
+{
+    if(unit >= texture_units) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        m_known &= ~texture_state; // The active unit is now one the shadow doesn't have
+        called();
+        return;
+    }
+
+    if(known(texture_state) && m_textures[unit] == texture) {
+        avoided();
+        return;
+    }
+
+    // Forgotten texture state forgets every unit, they're all bound again
+    // as they come up:
+    if(!known(texture_state)) {
+        for(auto& t : m_textures) t = 0xFFFFFFFF;
+        glActiveTexture(GL_TEXTURE0 + unit);
+        m_active_texture = unit;
+        m_known |= texture_state;
+        called();
+    }
+    else active_texture(unit);
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    m_textures[unit] = texture;
+    called();
+}
+
+void gl_state_cache::enable_scissor(const bool enable)
+{
+    // Same as blending, known state covers the switch and the box:
+    if(known(scissor_state) && m_scissor == enable) {
+        avoided();
+        return;
+    }
+
+    if(enable) glEnable(GL_SCISSOR_TEST);
+    else glDisable(GL_SCISSOR_TEST);
+    m_scissor = enable;
+    called();
+
+    if(!known(scissor_state)) {
+        glScissor(m_scissor_box[0], m_scissor_box[1], m_scissor_box[2], m_scissor_box[3]);
+        m_known |= scissor_state;
+        called();
+    }
+}
+
+void gl_state_cache::scissor(const int x, const int y, const int width, const int height)
+{
+    if(known(scissor_state) && m_scissor_box[0] == x && m_scissor_box[1] == y && m_scissor_box[2] == width && m_scissor_box[3] == height) {
+        avoided();
+        return;
+    }
+
+    glScissor(x, y, width, height);
+    m_scissor_box[0] = x;
+    m_scissor_box[1] = y;
+    m_scissor_box[2] = width;
+    m_scissor_box[3] = height;
+    called();
+
+    if(!known(scissor_state)) {
+        if(m_scissor) glEnable(GL_SCISSOR_TEST);
+        else glDisable(GL_SCISSOR_TEST);
+        m_known |= scissor_state;
+        called();
+    }
+}
+
+void gl_state_cache::unpack_alignment(const int alignment)
+{
+    if(known(unpack_state) && m_unpack_alignment == alignment) {
+        avoided();
+        return;
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    m_unpack_alignment = alignment;
+    m_known |= unpack_state;
+    called();
+}
+
+void gl_state_cache::enable_depth_test(const bool enable)
+{
+    if(known(depth_test_state) && m_depth_test == enable) {
+        avoided();
+        return;
+    }
+
+    if(enable) glEnable(GL_DEPTH_TEST);
+    else glDisable(GL_DEPTH_TEST);
+    m_depth_test = enable;
+    m_known |= depth_test_state;
+    called();
+}
+
+void gl_state_cache::enable_cull_face(const bool enable)
+{
+    if(known(cull_face_state) && m_cull_face == enable) {
+        avoided();
+        return;
+    }
+
+    if(enable) glEnable(GL_CULL_FACE);
+    else glDisable(GL_CULL_FACE);
+    m_cull_face = enable;
+    m_known |= cull_face_state;
+    called();
+}
+
+void gl_state_cache::end_frame()
+{
+    m_total.calls += m_frame.calls;
+    m_total.avoided += m_frame.avoided;
+    m_total.queries += m_frame.queries;
+    m_last_frame = m_frame;
+    m_frame = stats();
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+#include <stdint.h>
+
+namespace spacetheory {
+
+    // Shadow copy of the OpenGL state the engine sets most often: redundant
+    // changes are skipped, and reading the state back comes from the shadow
+    // instead of glGet, which stalls on some drivers until the GPU catches up.
+    //
+    // Only calls made through the cache keep it in sync. After handing the
+    // context to code that sets state on its own (NanoVG rendering, creating
+    // or deleting images), forget() what it may have touched and the next
+    // call goes through unconditionally. Owned by the display, and current on the thread its
+    // context is current on.
+    class gl_state_cache {
+    public:
+        enum state : uint32_t {
+            viewport_state = 1 << 0,
+            blend_state = 1 << 1,       // Enable and function
+            framebuffer_state = 1 << 2,
+            program_state = 1 << 3,
+            texture_state = 1 << 4,     // Active unit and 2D bindings
+            scissor_state = 1 << 5,     // Test and box
+            unpack_state = 1 << 6,      // Pixel unpack alignment
+            depth_test_state = 1 << 7,
+            cull_face_state = 1 << 8,
+            all_state = 0xFFFFFFFF
+        };
+
+        struct stats {
+            size_t calls = 0;       // State changes that reached GL
+            size_t avoided = 0;     // Redundant ones that didn't
+            size_t queries = 0;     // glGet calls to fill in forgotten state
+        };
+
+        static const unsigned texture_units = 8;
+
+    private:
+        static thread_local gl_state_cache * s_current;
+
+        uint32_t m_known; // state bits the shadow is valid for
+        int m_viewport[4];
+        bool m_blend;
+        uint32_t m_blend_src, m_blend_dst;
+        uint32_t m_framebuffer;
+        uint32_t m_program;
+        uint32_t m_active_texture; // Unit index
+        uint32_t m_textures[texture_units];
+        bool m_scissor;
+        int m_scissor_box[4];
+        int m_unpack_alignment;
+        bool m_depth_test;
+        bool m_cull_face;
+
+        stats m_frame, m_last_frame, m_total;
+
+        inline bool known(const state s) const { return (m_known & s) != 0; }
+        inline void avoided() { m_frame.avoided++; }
+        inline void called() { m_frame.calls++; }
+        void active_texture(const unsigned unit);
+
+    public:
+        gl_state_cache();
+        gl_state_cache(const gl_state_cache&) = delete;
+        gl_state_cache& operator=(const gl_state_cache&) = delete;
+
+        // The cache for the context current on this thread, if any:
+        static gl_state_cache * current() { return s_current; }
+        static void set_current(gl_state_cache * cache) { s_current = cache; }
+        // The current cache, or one that never trusts its shadow when no
+        // display made its context current on this thread:
+        static gl_state_cache& active();
+
+        void forget(const uint32_t states = all_state);
+
+        void viewport(const int x, const int y, const int width, const int height);
+        const int * get_viewport(); // x, y, width, height
+
+        void enable_blend(const bool enable);
+        void blend_func(const uint32_t src, const uint32_t dst);
+
+        void bind_framebuffer(const uint32_t framebuffer); // GL_FRAMEBUFFER, read and draw
+        uint32_t get_framebuffer();
+
+        void use_program(const uint32_t program);
+        void bind_texture_2d(const unsigned unit, const uint32_t texture);
+
+        void enable_scissor(const bool enable);
+        void scissor(const int x, const int y, const int width, const int height);
+
+        void unpack_alignment(const int alignment);
+
+        void enable_depth_test(const bool enable);
+        void enable_cull_face(const bool enable);
+
+        // Once a frame, rolls the frame's counts into the totals:
+        void end_frame();
+        inline const stats& get_frame_stats() const { return m_last_frame; }
+        inline const stats& get_total_stats() const { return m_total; }
+    };
+
+}
\ No newline at end of file
@@ -1,16 +1,17 @@
 #include "graphics2d.h"
 #include <glad\glad.h>
-#define NANOVG_GL3_IMPLEMENTATION
 #include <nanovg.h>
 #include <nanovg_gl.h>
 #include <nanovg_gl_utils.h>
 #include <exception>
+#include <algorithm>
+#include <cmath>
+#include "gl_state_cache.h"
+#include "error.h"
+#include "profiler.h"
 
 using namespace spacetheory;
 
-static NVGcontext * nvg_context = NULL; // Created on the first constructor
-static size_t nvg_instance_count = 0;
-
 const color spacetheory::graphics2d::transparent(0.0f, 0.0f, 0.0f, 0.0f);
 const color spacetheory::graphics2d::black(0.0f, 0.0f, 0.0f, 1.0f);
 const color spacetheory::graphics2d::white(1.0f, 1.0f, 1.0f, 1.0f);
@@ -18,88 +19,118 @@ const color spacetheory::graphics2d::red(1.0f, 0.0f, 0.0f, 1.0f);
 const color spacetheory::graphics2d::green(0.0f, 1.0f, 0.4f, 1.0f);
 const color spacetheory::graphics2d::blue(0.0f, 0.2f, 1.0f, 1.0f);
 
-static int testimage = 0;
-
-graphics2d::graphics2d(const bool antialias)
-    : m_fbo(nullptr), m_width(0.0f), m_height(0.0f), m_ready(false), m_antialias(antialias)
+static gl_state_cache * gl_state()
 {
-    graphics2d::create_nvg_context();
+    return &gl_state_cache::active();
+}
 
-    GLfloat v[4];
-    glGetFloatv(GL_VIEWPORT, &v[0]);
-    m_width = v[2];
-    m_height = v[3];
+// What NanoVG sets on its own while rendering, and leaves set (it turns face
+// culling on). It blends the same way begin() does, so the cached blend state
+// still holds:
+static const uint32_t nanovg_state = gl_state_cache::program_state | gl_state_cache::texture_state | gl_state_cache::scissor_state |
+    gl_state_cache::depth_test_state | gl_state_cache::cull_face_state;
 
-    testimage = nvgCreateImage(nvg_context, "test.png", 0);
+static render_device& default_device()
+{
+    render_device * device = render_device::current();
+    if(!device) throw spacetheory::error("No render device to create graphics2d with");
+    return *device;
 }
 
-graphics2d::graphics2d(const uint32_t width, const uint32_t height, const bool antialias)
-    : m_fbo(nullptr), m_width(0.0f), m_height(0.0f), m_ready(false), m_antialias(antialias)
+// NanoVG takes straight alpha and premultiplies it itself; linear devices get
+// the decoded channels:
+static NVGcolor paint_color(const color& c, const bool linear)
 {
-    graphics2d::create_nvg_context();
+    if(!linear) return nvgRGBA(c.r, c.g, c.b, c.a);
+    const glm::vec4 v = c.linear();
+    return nvgRGBAf(v.r, v.g, v.b, v.a);
+}
 
-    if(NULL == (m_fbo = nvgluCreateFramebuffer(nvg_context, width, height, 0/*NVG_IMAGE_REPEATX | NVG_IMAGE_REPEATY*/))) {
-        throw std::exception("Failed to create NVG Frame Buffer");
-    }
+graphics2d::graphics2d(const bool antialias) : graphics2d(default_device(), antialias)
+{
+}
 
-    m_width = (float) width;
-    m_height = (float) height;
+graphics2d::graphics2d(const uint32_t width, const uint32_t height, const bool antialias) : graphics2d(default_device(), width, height, antialias)
+{
 }
 
-graphics2d::~graphics2d()
+graphics2d::graphics2d(render_device& device, const bool antialias)
+    : m_device(&device), m_fbo(nullptr), m_width(0.0f), m_height(0.0f), m_ready(false), m_antialias(antialias), m_batching(true), m_clipped(false), m_pending(pending_work::none),
+    m_suspended(nullptr), m_suspended_transform(), m_profile_frame(0), m_profile_cpu_event(profiler::invalid_event), m_profile_gpu_event(profiler::invalid_event)
 {
-    if(is_ready()) end();
-    if(m_fbo) nvgluDeleteFramebuffer((NVGLUframebuffer *) m_fbo);
+    const int * viewport = gl_state()->get_viewport();
+    m_width = (float) viewport[2];
+    m_height = (float) viewport[3];
 
-    graphics2d::delete_nvg_context();
+    m_test_image = m_device->textures()->load("test.png");
 }
 
-void graphics2d::create_nvg_context()
+graphics2d::graphics2d(render_device& device, const uint32_t width, const uint32_t height, const bool antialias)
+    : m_device(&device), m_fbo(nullptr), m_width(0.0f), m_height(0.0f), m_ready(false), m_antialias(antialias), m_batching(true), m_clipped(false), m_pending(pending_work::none),
+    m_suspended(nullptr), m_suspended_transform(), m_profile_frame(0), m_profile_cpu_event(profiler::invalid_event), m_profile_gpu_event(profiler::invalid_event)
 {
-    int flags = NVG_STENCIL_STROKES | NVG_ANTIALIAS;
-#ifdef _DEBUG
-    flags |= NVG_DEBUG;
-#endif
-    if(NULL == (nvg_context = nvgCreateGL3(flags))) {
-        throw std::exception("Failed to create NVG Context");
+    // Drawn premultiplied, so composited without premultiplying again:
+    if(NULL == (m_fbo = m_device->targets()->acquire((int) width, (int) height, NVG_IMAGE_PREMULTIPLIED))) {
+        throw spacetheory::error("Failed to create NVG Frame Buffer");
     }
 
-    nvg_instance_count++;
+    m_width = (float) width;
+    m_height = (float) height;
 }
 
-void graphics2d::delete_nvg_context()
+graphics2d::~graphics2d()
 {
-    nvg_instance_count--;
-
-    if(nvg_context && nvg_instance_count == 0) {
-        nvgDeleteGL3(nvg_context);
-        nvg_context = NULL;
-    }
+    if(is_ready()) end();
+    if(m_fbo) m_device->targets()->release(m_fbo);
 }
 
 void graphics2d::begin()
 {
     if(!is_ready()) {
-        // SAVE VIEWPORT:
-        glGetFloatv(GL_VIEWPORT, m_glstate.viewport);
+        // NESTED:
+        // The NanoVG context and quad batch are the device's, whatever the
+        // drawing graphics2d has queued goes out before they're reset.
+        graphics2d * active = m_device->active_target();
+        if(active) active->suspend();
+        m_suspended = active;
+
+        // PROFILING:
+        // Timed on the CPU and with GPU timestamps until end() is called.
+        profiler * p = profiler::current();
+        if(p) {
+            m_profile_cpu_event = p->begin_event("graphics2d", m_profile_frame);
+            m_profile_gpu_event = p->begin_gpu_event("graphics2d");
+        }
+
+        // SAVE VIEWPORT AND FRAMEBUFFER:
+        // From the state cache, a glGet here would stall on some drivers.
+        gl_state_cache * gl = gl_state();
+        const int * viewport = gl->get_viewport();
+        for(int i = 0; i < 4; ++i) m_glstate.viewport[i] = viewport[i];
+        m_glstate.framebuffer = gl->get_framebuffer();
         
         // FBO:
         if(m_fbo) {
-            nvgluBindFramebuffer((NVGLUframebuffer *) m_fbo);
-            glViewport(0, 0, (GLsizei) m_width, (GLsizei) m_height);
+            gl->bind_framebuffer(((NVGLUframebuffer *) m_fbo)->fbo);
+            gl->viewport(0, 0, (int) m_width, (int) m_height);
         }
         else {
-            m_width = m_glstate.viewport[2];
-            m_height = m_glstate.viewport[3];
+            m_width = (float) m_glstate.viewport[2];
+            m_height = (float) m_glstate.viewport[3];
         }
 
         // ENABLE BLENDING:
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        // Premultiplied source over, what NanoVG and the quad batch use too.
+        gl->enable_blend(true);
+        gl->blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
         // BEGIN NANOVG DRAWING:
-        nvgBeginFrame(nvg_context, (int) m_width, (int) m_height, 1.f);
+        nvgBeginFrame(nvg(), (int) m_width, (int) m_height, 1.f);
+        m_device->quads()->begin(m_width, m_height);
+        m_pending = pending_work::none;
+        m_clipped = false;
 
+        m_device->set_active_target(this);
         m_ready = true;
     }
 }
@@ -109,50 +140,131 @@ void graphics2d::end()
     if(is_ready()) {
         m_ready = false;
 
+        // Batched quads were queued after any NanoVG paths still pending, but
+        // NanoVG was flushed when the batch started so nothing is out of order:
+        if(m_pending == pending_work::quads) m_device->quads()->flush();
+        m_pending = pending_work::none;
+
         // End nanovg drawing:
-        nvgEndFrame(nvg_context);
+        nvgEndFrame(nvg());
 
-        // FBO:
-        if(m_fbo) {
-            nvgluBindFramebuffer(NULL);
+        gl_state_cache * gl = gl_state();
+        gl->forget(nanovg_state);
+
+        // RESTORE SAVED FRAMEBUFFER AND VIEWPORT:
+        // Whatever was bound before, the display's headless target included.
+        gl->bind_framebuffer(m_glstate.framebuffer);
+        gl->viewport(m_glstate.viewport[0], m_glstate.viewport[1], m_glstate.viewport[2], m_glstate.viewport[3]);
+
+        // PROFILING:
+        profiler * p = profiler::current();
+        if(p) {
+            p->end_gpu_event(m_profile_gpu_event);
+            p->end_event(m_profile_frame, m_profile_cpu_event);
         }
 
-        // RESTORE SAVED VIEWPORT:
-        glViewport(
-            (GLint) m_glstate.viewport[0], 
-            (GLint) m_glstate.viewport[1], 
-            (GLsizei) m_glstate.viewport[2], 
-            (GLsizei) m_glstate.viewport[3]
-        );
+        // NESTED:
+        m_device->set_active_target(nullptr);
+        if(m_suspended) {
+            graphics2d * suspended = m_suspended;
+            m_suspended = nullptr;
+            suspended->resume();
+        }
     }
 }
 
 void graphics2d::cancel()
 {
-    nvgCancelFrame(nvg_context);
+    nvgCancelFrame(nvg());
+    m_device->quads()->begin(m_width, m_height);
+    m_pending = pending_work::none;
+}
+
+void graphics2d::use_paths()
+{
+    // Quads queued before this path have to reach the GPU first:
+    if(m_pending == pending_work::quads) m_device->quads()->flush();
+    m_pending = pending_work::paths;
+}
+
+void graphics2d::use_quads()
+{
+    if(m_pending == pending_work::paths) flush_paths();
+    m_pending = pending_work::quads;
+}
+
+void graphics2d::flush_paths()
+{
+    // NanoVG only renders on nvgEndFrame, so queued paths are flushed by
+    // ending and restarting the NanoVG frame. Restarting resets the transform,
+    // it's saved and reapplied:
+    float xform[6];
+    nvgCurrentTransform(nvg(), xform);
+    nvgEndFrame(nvg());
+    gl_state()->forget(nanovg_state);
+    nvgBeginFrame(nvg(), (int) m_width, (int) m_height, 1.f);
+    nvgTransform(nvg(), xform[0], xform[1], xform[2], xform[3], xform[4], xform[5]);
+    if(m_clipped) apply_clip();
+}
+
+void graphics2d::suspend()
+{
+    // Like flush_paths(), but the frame stays ended until resume():
+    if(m_pending == pending_work::quads) m_device->quads()->flush();
+    m_pending = pending_work::none;
+    nvgCurrentTransform(nvg(), m_suspended_transform);
+    nvgEndFrame(nvg());
+    gl_state()->forget(nanovg_state);
+}
+
+void graphics2d::resume()
+{
+    // The framebuffer and viewport were put back by the nested end():
+    const float * xform = m_suspended_transform;
+    nvgBeginFrame(nvg(), (int) m_width, (int) m_height, 1.f);
+    nvgTransform(nvg(), xform[0], xform[1], xform[2], xform[3], xform[4], xform[5]);
+    m_device->quads()->begin(m_width, m_height);
+    if(m_clipped) apply_clip();
+    m_device->set_active_target(this);
+}
+
+bool graphics2d::batch_transform(const rectangle& rect, float bounds[4], float& scale) const
+{
+    // Only scales and translations keep a rectangle axis-aligned:
+    float xform[6];
+    nvgCurrentTransform(nvg(), xform);
+    if(xform[1] != 0.0f || xform[2] != 0.0f) return false;
+
+    const float x1 = xform[0] * rect.x + xform[4];
+    const float y1 = xform[3] * rect.y + xform[5];
+    const float x2 = xform[0] * (rect.x + rect.w) + xform[4];
+    const float y2 = xform[3] * (rect.y + rect.h) + xform[5];
+    bounds[0] = std::min(x1, x2);
+    bounds[1] = std::min(y1, y2);
+    bounds[2] = std::abs(x2 - x1);
+    bounds[3] = std::abs(y2 - y1);
+
+    // Border widths and radii scale the same way NanoVG scales stroke widths:
+    scale = (std::abs(xform[0]) + std::abs(xform[3])) * 0.5f;
+    return true;
 }
 
 void graphics2d::test()
 {
     if(is_ready()) {
-        //nvgReset(nvg_context);
-        //nvgBeginPath(nvg_context);
-        //nvgRect(nvg_context, 0, 0, 150, 150);
-        //nvgFillColor(nvg_context, nvgRGBA(0, 255, 100, 255));
-        //nvgFill(nvg_context);
+        use_paths();
+
+        //nvgReset(nvg());
+        //nvgBeginPath(nvg());
+        //nvgRect(nvg(), 0, 0, 150, 150);
+        //nvgFillColor(nvg(), nvgRGBA(0, 255, 100, 255));
+        //nvgFill(nvg());
 
         //draw_roundrect(rectangle(200, 200, 150, 150), corner_radius(20.0f), 1.f, green, green);
 
         draw_rect(rectangle(300, 300, 100, 100), 1.0f, html_colors::Black, html_colors::Aquamarine);
 
-        NVGpaint paint_img = nvgImagePattern(nvg_context, 0, 0, 256, 256, 0.0f, testimage, 1.0f);
-        nvgBeginPath(nvg_context);
-        nvgRect(nvg_context, 0, 0, 256, 256);
-        // https://github.com/memononen/nanovg/issues/450
-        paint_img.innerColor = nvgRGBA(0, 255, 100, 255);
-        nvgFillPaint(nvg_context, paint_img);
-
-        nvgFill(nvg_context);
+        draw_image(m_test_image, rectangle(0, 0, 256, 256));
     }
 }
 
@@ -163,7 +275,7 @@ void graphics2d::scale_percent(const float percent)
 
 void graphics2d::scale_percent(const float x_percent, const float y_percent)
 {
-    nvgScale(nvg_context, x_percent / 100.0f, y_percent / 100.0f);
+    nvgScale(nvg(), x_percent / 100.0f, y_percent / 100.0f);
 }
 
 void graphics2d::scale_factor(const float factor)
@@ -173,45 +285,140 @@ void graphics2d::scale_factor(const float factor)
 
 void graphics2d::scale_factor(const float x_factor, const float y_factor)
 {
-    nvgScale(nvg_context, x_factor, y_factor);
+    nvgScale(nvg(), x_factor, y_factor);
 }
 
 void graphics2d::reset_transform()
 {
-    nvgResetTransform(nvg_context);
+    nvgResetTransform(nvg());
 }
 
-void graphics2d::clear(const color& c)
+void graphics2d::clip(const rectangle& area)
 {
     if(is_ready()) {
-        // This will always clear as opaque since premultiplied alpha is being used
-        // with nanovg's fbo.
-        //glClearColor(c.r, c.g, c.b, c.a);
-        //glClear(GL_COLOR_BUFFER_BIT);
-
-        NVGcontext * vg = nvg_context;
-        nvgSave(vg);
-        nvgReset(vg);
-        nvgBeginPath(vg);
-        nvgRect(vg, 0, 0, m_width, m_height);
-        nvgFillColor(vg, nvgRGBA(c.r, c.g, c.b, c.a));
-        nvgFill(vg);
-        nvgRestore(vg);
+        m_clipped = true;
+        m_clip = area;
+        apply_clip();
+    }
+}
+
+void graphics2d::reset_clip()
+{
+    if(is_ready()) {
+        m_clipped = false;
+        apply_clip();
+    }
+}
+
+graphics2d::drawing_state graphics2d::get_drawing_state() const
+{
+    drawing_state state;
+    nvgCurrentTransform(nvg(), state.transform);
+    state.clipped = m_clipped;
+    state.clip = m_clip;
+    return state;
+}
+
+void graphics2d::set_drawing_state(const drawing_state& state)
+{
+    if(is_ready()) {
+        const float * xform = state.transform;
+        nvgResetTransform(nvg());
+        nvgTransform(nvg(), xform[0], xform[1], xform[2], xform[3], xform[4], xform[5]);
+        m_clipped = state.clipped;
+        m_clip = state.clip;
+        apply_clip();
+    }
+}
+
+void graphics2d::apply_clip()
+{
+    // NanoVG transforms the scissor by the current transform, so it's set
+    // with the identity and the transform put back after:
+    float xform[6];
+    nvgCurrentTransform(nvg(), xform);
+    nvgResetTransform(nvg());
+    if(m_clipped) nvgScissor(nvg(), (float) m_clip.x, (float) m_clip.y, (float) m_clip.w, (float) m_clip.h);
+    else nvgResetScissor(nvg());
+    nvgTransform(nvg(), xform[0], xform[1], xform[2], xform[3], xform[4], xform[5]);
+
+    if(m_clipped) m_device->quads()->set_scissor((float) m_clip.x, (float) m_clip.y, (float) m_clip.w, (float) m_clip.h);
+    else m_device->quads()->reset_scissor();
+}
+
+glm::vec4 graphics2d::render_color(const color& c) const
+{
+    const glm::vec4 v = m_device->linear() ? c.linear() : glm::vec4(c.r / 255.0f, c.g / 255.0f, c.b / 255.0f, c.a / 255.0f);
+    return glm::vec4(v.r * v.a, v.g * v.a, v.b * v.a, v.a);
+}
+
+void graphics2d::clear(const color& c, const uint32_t buffers, const float depth, const int stencil)
+{
+    if(!is_ready()) return;
+
+    // EARLIER DRAWING FIRST:
+    // It's still queued and has to land before the clear does.
+    if(m_pending == pending_work::quads) m_device->quads()->flush();
+    else if(m_pending == pending_work::paths) flush_paths();
+    m_pending = pending_work::none;
+
+    // SCISSOR TO THE CLIP:
+    // GL's origin is the bottom-left. NanoVG and the quad batch switch the
+    // test off after drawing anyway, so it's left off here too.
+    gl_state_cache * gl = gl_state();
+    if(m_clipped) {
+        gl->enable_scissor(true);
+        gl->scissor(m_clip.x, (int) m_height - m_clip.y - m_clip.h, std::max(m_clip.w, 0), std::max(m_clip.h, 0));
+    }
+
+    // CLEAR:
+    // Write masks are opened first, NanoVG closes some of them between fills
+    // and sets them again before the next.
+    if(buffers & color_buffer) {
+        const glm::vec4 v = render_color(c);
+        const GLfloat value[4] = { v.r, v.g, v.b, v.a };
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glClearBufferfv(GL_COLOR, 0, value);
     }
+    if(buffers & depth_buffer) glDepthMask(GL_TRUE);
+    if(buffers & stencil_buffer) glStencilMask(0xFF);
+    if((buffers & depth_buffer) && (buffers & stencil_buffer)) glClearBufferfi(GL_DEPTH_STENCIL, 0, depth, stencil);
+    else if(buffers & depth_buffer) glClearBufferfv(GL_DEPTH, 0, &depth);
+    else if(buffers & stencil_buffer) glClearBufferiv(GL_STENCIL, 0, &stencil);
+
+    if(m_clipped) gl->enable_scissor(false);
 }
 
 void graphics2d::draw_rect(rectangle& rect, const float border_width, const color& border_color, const color& fill_color)
 {
-    NVGcontext * vg = nvg_context;
-    NVGcolor nvg_stroke_color = nvgRGBA(border_color.r, border_color.g, border_color.b, border_color.a);
-    NVGcolor nvg_fill_color = nvgRGBA(fill_color.r, fill_color.g, fill_color.b, fill_color.a);
+    NVGcontext * vg = nvg();
+
+    // BATCHED QUADS:
+    // As long as the transform keeps the rectangle axis-aligned it's drawn by
+    // the quad batch, otherwise NanoVG takes over as a general path.
+    float bounds[4], scale;
+    if(is_ready() && m_batching && batch_transform(rect, bounds, scale)) {
+        if(border_width <= 0.0f && fill_color == transparent) return;
+
+        use_quads();
+        m_device->quads()->add(bounds[0], bounds[1], bounds[2], bounds[3], border_width * scale, border_color, fill_color);
+        return;
+    }
+
+    use_paths();
+
+    NVGcolor nvg_stroke_color = paint_color(border_color, m_device->linear());
+    NVGcolor nvg_fill_color = paint_color(fill_color, m_device->linear());
 
     //NVGpaint gradient = nvgLinearGradient(vg, rect.x, 0, rect.x + rect.w, 0, nvgRGB(255, 255, 255), nvgRGB(0, 0, 0));
     nvgBeginPath(vg);
     nvgRect(vg, (float) rect.x, (float) rect.y, (float) rect.w, (float) rect.h);
-    nvgStrokeWidth(vg, border_width);
-    nvgStrokeColor(vg, nvg_stroke_color);
-    nvgStroke(vg);
+    // A border that isn't there would still go to the GPU as a stroke:
+    if (border_width > 0.0f) {
+        nvgStrokeWidth(vg, border_width);
+        nvgStrokeColor(vg, nvg_stroke_color);
+        nvgStroke(vg);
+    }
     if (fill_color != transparent) {
         nvgFillColor(vg, nvg_fill_color);
         //nvgFillPaint(vg, gradient);
@@ -226,9 +433,25 @@ void graphics2d::fill_rect(rectangle& rect, const color& fill_color)
 
 void graphics2d::draw_roundrect(rectangle& rect, const corner_radius& radius, const float border_width, const color& border_color, const color& fill_color)
 {
-    NVGcontext * vg = nvg_context;
-    NVGcolor nvg_stroke_color = nvgRGBA(border_color.r, border_color.g, border_color.b, border_color.a);
-    NVGcolor nvg_fill_color = nvgRGBA(fill_color.r, fill_color.g, fill_color.b, fill_color.a);
+    NVGcontext * vg = nvg();
+
+    // BATCHED QUADS:
+    // Rounded corners are a distance field in the quad batch's fragment shader,
+    // so there's no arc tessellation or stencil stroke for these.
+    float bounds[4], scale;
+    if(is_ready() && m_batching && batch_transform(rect, bounds, scale)) {
+        if(border_width <= 0.0f && fill_color == transparent) return;
+
+        corner_radius scaled_radius(radius.topleft() * scale, radius.topright() * scale, radius.bottomright() * scale, radius.bottomleft() * scale);
+        use_quads();
+        m_device->quads()->add(bounds[0], bounds[1], bounds[2], bounds[3], scaled_radius, border_width * scale, border_color, fill_color);
+        return;
+    }
+
+    use_paths();
+
+    NVGcolor nvg_stroke_color = paint_color(border_color, m_device->linear());
+    NVGcolor nvg_fill_color = paint_color(fill_color, m_device->linear());
 
     nvgBeginPath(vg);
     nvgRoundedRectVarying(
@@ -240,9 +463,11 @@ void graphics2d::draw_roundrect(rectangle& rect, const corner_radius& radius, co
         nvgFillColor(vg, nvg_fill_color);
         nvgFill(vg);
     }
-    nvgStrokeWidth(vg, border_width);
-    nvgStrokeColor(vg, nvg_stroke_color);
-    nvgStroke(vg);
+    if (border_width > 0.0f) {
+        nvgStrokeWidth(vg, border_width);
+        nvgStrokeColor(vg, nvg_stroke_color);
+        nvgStroke(vg);
+    }
 }
 
 void graphics2d::fill_roundrect(rectangle& rect, const corner_radius& radius, const color& fill_color)
@@ -250,6 +475,52 @@ void graphics2d::fill_roundrect(rectangle& rect, const corner_radius& radius, co
     draw_roundrect(rect, radius, 0.0f, graphics2d::transparent, fill_color);
 }
 
+texture_handle graphics2d::load_image(const std::string& path) const
+{
+    return m_device->textures()->load(path);
+}
+
+texture_handle graphics2d::load_image_async(const std::string& path) const
+{
+    return m_device->textures()->load_async(path);
+}
+
+texture_cache * graphics2d::get_texture_cache() const
+{
+    return m_device->textures();
+}
+
+render_target_pool * graphics2d::get_render_target_pool() const
+{
+    return m_device->targets();
+}
+
+void graphics2d::draw_image(const texture_handle& image, const float x, const float y, const float alpha)
+{
+    if(image) draw_image(image, rectangle((int) x, (int) y, image->width, image->height), alpha);
+}
+
+void graphics2d::draw_image(const texture_handle& image, const rectangle& dest, const float alpha)
+{
+    if(!is_ready() || !image || !image->ready || image->width <= 0 || image->height <= 0) return;
+
+    NVGcontext * vg = nvg();
+    use_paths();
+
+    // The pattern spans the whole atlas page, scaled and offset so that the
+    // image's region lands on the destination rectangle:
+    const float sx = (float) dest.w / image->width;
+    const float sy = (float) dest.h / image->height;
+    NVGpaint paint_img = nvgImagePattern(vg,
+        dest.x - image->x * sx, dest.y - image->y * sy,
+        image->page_width * sx, image->page_height * sy,
+        0.0f, image->image, alpha);
+    nvgBeginPath(vg);
+    nvgRect(vg, (float) dest.x, (float) dest.y, (float) dest.w, (float) dest.h);
+    nvgFillPaint(vg, paint_img);
+    nvgFill(vg);
+}
+
 void graphics2d::draw(const graphics2d& source, const float x, const float y)
 {
     // This destination need to be ready (begin called), 
@@ -258,9 +529,10 @@ void graphics2d::draw(const graphics2d& source, const float x, const float y)
     if(!is_ready() || source.m_fbo == 0 || source.is_ready()) return;
     else {
         NVGLUframebuffer * source_fbo = (NVGLUframebuffer *) source.m_fbo;
-        NVGcontext * vg = nvg_context;
+        NVGcontext * vg = nvg();
         const float& source_width = source.m_width;
         const float& source_height = source.m_height;
+        use_paths();
 
         NVGpaint paint_img = nvgImagePattern(vg, x, y, source_width, source_height, 0.0f, source_fbo->image, 1.0f);
         nvgBeginPath(vg);
@@ -4,37 +4,98 @@
 #include "rectangle.h"
 #include "corner_radius.h"
 #include "color.h"
+#include "render_device.h"
+
+struct NVGcontext;
 
 namespace spacetheory {
 
     class graphics2d {
     private:
+        render_device * m_device;
         void * m_fbo; // NanoVG Frame Buffer
         float m_width, m_height;
         bool m_ready;
         bool m_antialias;
+        bool m_batching;
+        bool m_clipped;
+        rectangle m_clip; // Untransformed pixels, until end() or reset_clip()
 
+        // Restored by end():
         struct glstate {
-            float viewport[4];
+            int viewport[4];
+            uint32_t framebuffer;
         } m_glstate;
 
-        static void create_nvg_context();
-        static void delete_nvg_context();
+        // Which renderer has queued work that hasn't reached the GPU yet, so
+        // that switching between them keeps the painter's order:
+        enum class pending_work { none, paths, quads } m_pending;
+
+        // Another graphics2d on the same device that was drawing when begin()
+        // was called, suspended until end(). Its own transform while it is:
+        graphics2d * m_suspended;
+        float m_suspended_transform[6];
+
+        // Profiler events between begin() and end():
+        uint64_t m_profile_frame;
+        uint32_t m_profile_cpu_event, m_profile_gpu_event;
+
+        texture_handle m_test_image;
+
+        inline NVGcontext * nvg() const { return (NVGcontext *) m_device->nvg_context(); }
+
+        void use_paths();
+        void use_quads();
+        void apply_clip();
+        void flush_paths();
+        void suspend();
+        void resume();
+        bool batch_transform(const rectangle& rect, float bounds[4], float& scale) const;
 
     public:
         static const color transparent, black, white, red, green, blue;
 
+        // The transform and clip, to carry them over an end() and begin():
+        struct drawing_state {
+            float transform[6];
+            bool clipped;
+            rectangle clip;
+        };
+
+        // Buffers for clear(), combined with |:
+        enum buffer : uint32_t {
+            color_buffer = 1 << 0,
+            depth_buffer = 1 << 1,
+            stencil_buffer = 1 << 2
+        };
+
+        // Without a device, render_device::current() is used:
         graphics2d(const bool antialias = false);
         graphics2d(const uint32_t width, const uint32_t height, const bool antialias = false);
+        graphics2d(render_device& device, const bool antialias = false);
+        graphics2d(render_device& device, const uint32_t width, const uint32_t height, const bool antialias = false);
         virtual ~graphics2d();
 
         inline const bool& is_ready() const { return m_ready; }
+        inline float width() const { return m_width; }
+        inline float height() const { return m_height; }
+        inline render_device& device() const { return *m_device; }
 
+        // A begin() while another graphics2d on the same device is drawing
+        // (rendering a layer while drawing the screen) flushes and suspends
+        // that one, its end() picks it back up where it was:
         void begin();
         void end();
         void cancel();
             
-        void clear(const color& c);
+        // Sets the buffers of the bound target to the given values with GL,
+        // no drawing, blending or transform involved. Only the clip area is
+        // touched when there's one. Depth is only there for a target that has
+        // a depth buffer, offscreen targets have stencil only:
+        void clear(const color& c, const uint32_t buffers = color_buffer, const float depth = 1.0f, const int stencil = 0);
+        // The color the way this target holds it, premultiplied and linear
+        // when the device is, for filling it with GL directly:
+        glm::vec4 render_color(const color& c) const;
 
         void scale_percent(const float percent);
         void scale_percent(const float x_percent, const float y_percent);
@@ -42,12 +103,40 @@ namespace spacetheory {
         void scale_factor(const float x_factor, const float y_factor);
         void reset_transform();
 
+        // Drawing only touches pixels inside the area, given in pixels of this
+        // target regardless of the transform. Paths are scissored by NanoVG,
+        // batched quads and clear() by GL:
+        void clip(const rectangle& area);
+        void reset_clip();
+
+        // begin() starts from no transform and no clip, these put them back:
+        drawing_state get_drawing_state() const;
+        void set_drawing_state(const drawing_state& state);
+
+        // Axis-aligned rectangles go through the quad batch unless batching is
+        // turned off, then NanoVG draws them as paths like anything else (for
+        // comparing the two):
+        inline void set_batching(const bool enabled) { m_batching = enabled; }
+        inline bool is_batching() const { return m_batching; }
+
         void draw_rect(rectangle& rect, const float border_width, const color& border_color, const color& fill_color = graphics2d::transparent);
         void fill_rect(rectangle& rect, const color& fill_color);
 
         void draw_roundrect(rectangle& rect, const corner_radius& radius, const float border_width, const color& border_color, const color& fill_color = graphics2d::transparent);
         void fill_roundrect(rectangle& rect, const corner_radius& radius, const color& fill_color);
 
+        // Images come from this graphics2d's device's cache, shared by every
+        // graphics2d using the device; small ones are packed into atlas pages:
+        texture_handle load_image(const std::string& path) const;
+        texture_handle load_image_async(const std::string& path) const; // Draws nothing until it's uploaded
+        texture_cache * get_texture_cache() const;
+        void draw_image(const texture_handle& image, const float x, const float y, const float alpha = 1.0f);
+        void draw_image(const texture_handle& image, const rectangle& dest, const float alpha = 1.0f);
+
+        // Offscreen graphics2d framebuffers come from their device's pool and
+        // go back to it when they're destroyed:
+        render_target_pool * get_render_target_pool() const;
+
         void draw(const graphics2d& source, const float x, const float y);
         void test();
     };
@@ -0,0 +1,260 @@
+#include "graphics2d_command_list.h"
+#include <cstring>
+
+using namespace spacetheory;
+
+const size_t spacetheory::graphics2d_command_list::chunk_size;
+
+// PAYLOADS:
+// Plain data only, copied in and out with memcpy. Every command is a header
+// followed by its payload, padded to keep the next header aligned.
+namespace {
+
+    struct command_header {
+        uint8_t type;
+        uint8_t reserved;
+        uint16_t size; // Payload bytes
+    };
+
+    struct clear_payload {
+        uint8_t color[4];
+    };
+
+    struct rect_payload {
+        int32_t rect[4];
+        float border_width;
+        uint8_t border_color[4];
+        uint8_t fill_color[4];
+    };
+
+    struct roundrect_payload {
+        int32_t rect[4];
+        float radius[4];
+        float border_width;
+        uint8_t border_color[4];
+        uint8_t fill_color[4];
+    };
+
+    struct image_payload {
+        uint32_t image; // Index into the list's images
+        uint32_t flags;
+        int32_t rect[4];
+        float alpha;
+    };
+
+    // The size in rect is ignored, the image's own is looked up on replay:
+    const uint32_t image_natural_size = 1;
+
+    struct scale_payload {
+        float x, y;
+    };
+
+    const size_t command_alignment = 4;
+
+    inline size_t aligned(const size_t size) { return (size + command_alignment - 1) & ~(command_alignment - 1); }
+
+    inline void copy_rect(int32_t out[4], const rectangle& rect) { out[0] = rect.x; out[1] = rect.y; out[2] = rect.w; out[3] = rect.h; }
+    inline void copy_color(uint8_t out[4], const color& c) { out[0] = c.r; out[1] = c.g; out[2] = c.b; out[3] = c.a; }
+    inline color to_color(const uint8_t c[4]) { return color(c[0], c[1], c[2], c[3]); }
+
+    inline uint64_t fnv1a(uint64_t hash, const void * data, const size_t size)
+    {
+        const uint8_t * bytes = (const uint8_t *) data;
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    const uint64_t empty_hash = 14695981039346656037ull;
+
+}
+
+graphics2d_command_list::graphics2d_command_list() : m_chunk(0), m_commands(0), m_bytes(0), m_hash(empty_hash)
+{
+}
+
+void graphics2d_command_list::reset()
+{
+    for (auto& c : m_chunks) c.used = 0;
+    m_chunk = 0;
+    m_commands = 0;
+    m_bytes = 0;
+    m_hash = empty_hash;
+    m_images.clear();
+}
+
+void graphics2d_command_list::write(const command_type type, const void * payload, const size_t size)
+{
+    const size_t total = sizeof(command_header) + aligned(size);
+
+    // NEXT CHUNK:
+    // Commands never straddle chunks, the rest of a full chunk stays unused.
+    while (m_chunk < m_chunks.size() && m_chunks[m_chunk].used + total > chunk_size) m_chunk++;
+    if (m_chunk == m_chunks.size()) m_chunks.push_back(chunk{ std::unique_ptr<uint8_t[]>(new uint8_t[chunk_size]), 0 });
+
+    chunk& c = m_chunks[m_chunk];
+    const command_header header = { (uint8_t) type, 0, (uint16_t) size };
+    std::memcpy(c.data.get() + c.used, &header, sizeof(header));
+    if (size) std::memcpy(c.data.get() + c.used + sizeof(header), payload, size);
+    c.used += total;
+
+    m_commands++;
+    m_bytes += total;
+    m_hash = fnv1a(fnv1a(m_hash, &header, sizeof(header)), payload, size);
+}
+
+void graphics2d_command_list::clear(const color& c)
+{
+    clear_payload p;
+    copy_color(p.color, c);
+    write(command_type::clear, &p, sizeof(p));
+}
+
+void graphics2d_command_list::scale_percent(const float percent)
+{
+    scale_factor(percent / 100.0f, percent / 100.0f);
+}
+
+void graphics2d_command_list::scale_percent(const float x_percent, const float y_percent)
+{
+    scale_factor(x_percent / 100.0f, y_percent / 100.0f);
+}
+
+void graphics2d_command_list::scale_factor(const float factor)
+{
+    scale_factor(factor, factor);
+}
+
+void graphics2d_command_list::scale_factor(const float x_factor, const float y_factor)
+{
+    const scale_payload p = { x_factor, y_factor };
+    write(command_type::scale, &p, sizeof(p));
+}
+
+void graphics2d_command_list::reset_transform()
+{
+    write(command_type::reset_transform, nullptr, 0);
+}
+
+void graphics2d_command_list::draw_rect(const rectangle& rect, const float border_width, const color& border_color, const color& fill_color)
+{
+    rect_payload p;
+    copy_rect(p.rect, rect);
+    p.border_width = border_width;
+    copy_color(p.border_color, border_color);
+    copy_color(p.fill_color, fill_color);
+    write(command_type::rect, &p, sizeof(p));
+}
+
+void graphics2d_command_list::fill_rect(const rectangle& rect, const color& fill_color)
+{
+    draw_rect(rect, 0.0f, graphics2d::transparent, fill_color);
+}
+
+void graphics2d_command_list::draw_roundrect(const rectangle& rect, const corner_radius& radius, const float border_width, const color& border_color, const color& fill_color)
+{
+    roundrect_payload p;
+    copy_rect(p.rect, rect);
+    p.radius[0] = radius.topleft();
+    p.radius[1] = radius.topright();
+    p.radius[2] = radius.bottomright();
+    p.radius[3] = radius.bottomleft();
+    p.border_width = border_width;
+    copy_color(p.border_color, border_color);
+    copy_color(p.fill_color, fill_color);
+    write(command_type::roundrect, &p, sizeof(p));
+}
+
+void graphics2d_command_list::fill_roundrect(const rectangle& rect, const corner_radius& radius, const color& fill_color)
+{
+    draw_roundrect(rect, radius, 0.0f, graphics2d::transparent, fill_color);
+}
+
+void graphics2d_command_list::draw_image(const texture_handle& image, const float x, const float y, const float alpha)
+{
+    // The size isn't known until the image has loaded, which may well be
+    // after recording, so it's left to replay:
+    write_image(image, rectangle((int) x, (int) y, 0, 0), alpha, true);
+}
+
+void graphics2d_command_list::draw_image(const texture_handle& image, const rectangle& dest, const float alpha)
+{
+    write_image(image, dest, alpha, false);
+}
+
+void graphics2d_command_list::write_image(const texture_handle& image, const rectangle& dest, const float alpha, const bool natural_size)
+{
+    if (!image) return;
+
+    image_payload p;
+    p.image = (uint32_t) m_images.size();
+    p.flags = natural_size ? image_natural_size : 0;
+    copy_rect(p.rect, dest);
+    p.alpha = alpha;
+    m_images.push_back(image);
+    write(command_type::image, &p, sizeof(p));
+
+    // The index says nothing about which image it is, the region does. It
+    // changes once a background load completes, which has to change the hash.
+    // Field by field, the struct's padding isn't part of it:
+    const texture_region region = texture_cache::snapshot(image);
+    const int32_t fields[] = { region.image, region.page_width, region.page_height,
+        region.x, region.y, region.width, region.height, region.ready ? 1 : 0 };
+    m_hash = fnv1a(m_hash, fields, sizeof(fields));
+}
+
+void graphics2d_command_list::replay(graphics2d& target) const
+{
+    for (size_t i = 0; i <= m_chunk && i < m_chunks.size(); ++i) {
+        const chunk& c = m_chunks[i];
+        size_t offset = 0;
+        while (offset < c.used) {
+            command_header header;
+            std::memcpy(&header, c.data.get() + offset, sizeof(header));
+            const uint8_t * payload = c.data.get() + offset + sizeof(header);
+            offset += sizeof(header) + aligned(header.size);
+
+            switch ((command_type) header.type) {
+            case command_type::clear: {
+                clear_payload p;
+                std::memcpy(&p, payload, sizeof(p));
+                target.clear(to_color(p.color));
+                break;
+            }
+            case command_type::rect: {
+                rect_payload p;
+                std::memcpy(&p, payload, sizeof(p));
+                rectangle rect(p.rect[0], p.rect[1], p.rect[2], p.rect[3]);
+                target.draw_rect(rect, p.border_width, to_color(p.border_color), to_color(p.fill_color));
+                break;
+            }
+            case command_type::roundrect: {
+                roundrect_payload p;
+                std::memcpy(&p, payload, sizeof(p));
+                rectangle rect(p.rect[0], p.rect[1], p.rect[2], p.rect[3]);
+                target.draw_roundrect(rect, corner_radius(p.radius[0], p.radius[1], p.radius[2], p.radius[3]),
+                    p.border_width, to_color(p.border_color), to_color(p.fill_color));
+                break;
+            }
+            case command_type::image: {
+                image_payload p;
+                std::memcpy(&p, payload, sizeof(p));
+                if (p.flags & image_natural_size) target.draw_image(m_images[p.image], (float) p.rect[0], (float) p.rect[1], p.alpha);
+                else target.draw_image(m_images[p.image], rectangle(p.rect[0], p.rect[1], p.rect[2], p.rect[3]), p.alpha);
+                break;
+            }
+            case command_type::scale: {
+                scale_payload p;
+                std::memcpy(&p, payload, sizeof(p));
+                target.scale_factor(p.x, p.y);
+                break;
+            }
+            case command_type::reset_transform:
+                target.reset_transform();
+                break;
+            }
+        }
+    }
+}
\ No newline at end of file
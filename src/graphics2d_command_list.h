@@ -0,0 +1,77 @@
+#pragma once
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include "graphics2d.h"
+
+namespace spacetheory {
+
+    // Records graphics2d drawing as a compact byte stream instead of issuing
+    // it, to be replayed later on the thread owning the OpenGL context. Nothing
+    // shared is touched while recording, so any thread can record its own
+    // list. Lists can be kept and replayed every frame (static UI, layers),
+    // and hash() tells whether a re-recorded list changed at all.
+    //
+    // Commands are written into chunks that are kept on reset(), so a list
+    // recorded every frame stops allocating after the first few frames.
+    class graphics2d_command_list {
+    private:
+        enum class command_type : uint8_t {
+            clear, rect, roundrect, image, scale, reset_transform
+        };
+
+        struct chunk {
+            std::unique_ptr<uint8_t[]> data;
+            size_t used;
+        };
+
+        static const size_t chunk_size = 16 * 1024;
+
+        std::vector<chunk> m_chunks;
+        size_t m_chunk;             // Chunk being written
+        size_t m_commands;
+        size_t m_bytes;
+        uint64_t m_hash;
+        std::vector<texture_handle> m_images; // Referenced by index from image commands
+
+        void write(const command_type type, const void * payload, const size_t size);
+        void write_image(const texture_handle& image, const rectangle& dest, const float alpha, const bool natural_size);
+
+    public:
+        graphics2d_command_list();
+        graphics2d_command_list(graphics2d_command_list&&) = default;
+        graphics2d_command_list& operator=(graphics2d_command_list&&) = default;
+        graphics2d_command_list(const graphics2d_command_list&) = delete;
+        graphics2d_command_list& operator=(const graphics2d_command_list&) = delete;
+
+        // Empties the list, keeping its memory:
+        void reset();
+
+        inline bool empty() const { return m_commands == 0; }
+        inline size_t size() const { return m_commands; }
+        inline size_t bytes() const { return m_bytes; }
+        inline uint64_t hash() const { return m_hash; }
+
+        // RECORDING, same meaning as the graphics2d functions of the same name:
+        void clear(const color& c);
+
+        void scale_percent(const float percent);
+        void scale_percent(const float x_percent, const float y_percent);
+        void scale_factor(const float factor);
+        void scale_factor(const float x_factor, const float y_factor);
+        void reset_transform();
+
+        void draw_rect(const rectangle& rect, const float border_width, const color& border_color, const color& fill_color = graphics2d::transparent);
+        void fill_rect(const rectangle& rect, const color& fill_color);
+
+        void draw_roundrect(const rectangle& rect, const corner_radius& radius, const float border_width, const color& border_color, const color& fill_color = graphics2d::transparent);
+        void fill_roundrect(const rectangle& rect, const corner_radius& radius, const color& fill_color);
+
+        void draw_image(const texture_handle& image, const float x, const float y, const float alpha = 1.0f);
+        void draw_image(const texture_handle& image, const rectangle& dest, const float alpha = 1.0f);
+
+        // PLAYBACK, between target.begin() and target.end():
+        void replay(graphics2d& target) const;
+    };
+
+}
\ No newline at end of file
@@ -8,6 +8,11 @@ namespace spacetheory {
         bool vsync = false;
         bool msaa = false; // multisample antialiasing
         int msaa_samples = 2;
+        // Blend and filter in linear space: the window and every render target
+        // store sRGB, colors are decoded when drawn (see render_device). Falls
+        // back to blending sRGB values, with a warning, when the context
+        // doesn't get an sRGB capable framebuffer:
+        bool srgb_framebuffer = false;
     };
 
 }
\ No newline at end of file
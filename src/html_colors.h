@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include <string_view>
 
 namespace spacetheory {
 
@@ -153,6 +154,195 @@ namespace spacetheory {
         constexpr uint32_t LightYellow = 0xFFFFE0FF;
         constexpr uint32_t Ivory = 0xFFFFF0FF;
         constexpr uint32_t White = 0xFFFFFFFF;
+
+        // NAME LOOKUP:
+        // The names above are matched without regard to case, so "darkslategray"
+        // from CSS finds DarkSlateGray. The table is a perfect hash built at
+        // compile time: a name's hash picks a bucket, the bucket's
+        // displacement is mixed into the hash to pick a slot, and displacements
+        // were chosen (biggest buckets first) so no two names share a slot. A
+        // lookup is one hash, two table reads and one comparison.
+
+        struct named_color {
+            std::string_view name;
+            uint32_t value;
+        };
+
+#define SPACETHEORY_HTML_COLOR(name) named_color{ #name, name }
+        inline constexpr named_color by_name[] = {
+            SPACETHEORY_HTML_COLOR(Transparent), SPACETHEORY_HTML_COLOR(Black), SPACETHEORY_HTML_COLOR(Navy),
+            SPACETHEORY_HTML_COLOR(DarkBlue), SPACETHEORY_HTML_COLOR(MediumBlue), SPACETHEORY_HTML_COLOR(Blue),
+            SPACETHEORY_HTML_COLOR(DarkGreen), SPACETHEORY_HTML_COLOR(Green), SPACETHEORY_HTML_COLOR(Teal),
+            SPACETHEORY_HTML_COLOR(DarkCyan), SPACETHEORY_HTML_COLOR(DeepSkyBlue),
+            SPACETHEORY_HTML_COLOR(DarkTurquoise), SPACETHEORY_HTML_COLOR(MediumSpringGreen),
+            SPACETHEORY_HTML_COLOR(Lime), SPACETHEORY_HTML_COLOR(SpringGreen), SPACETHEORY_HTML_COLOR(Aqua),
+            SPACETHEORY_HTML_COLOR(Cyan), SPACETHEORY_HTML_COLOR(MidnightBlue), SPACETHEORY_HTML_COLOR(DodgerBlue),
+            SPACETHEORY_HTML_COLOR(LightSeaGreen), SPACETHEORY_HTML_COLOR(ForestGreen),
+            SPACETHEORY_HTML_COLOR(SeaGreen), SPACETHEORY_HTML_COLOR(DarkSlateGray),
+            SPACETHEORY_HTML_COLOR(DarkSlateGrey), SPACETHEORY_HTML_COLOR(LimeGreen),
+            SPACETHEORY_HTML_COLOR(MediumSeaGreen), SPACETHEORY_HTML_COLOR(Turquoise),
+            SPACETHEORY_HTML_COLOR(RoyalBlue), SPACETHEORY_HTML_COLOR(SteelBlue), SPACETHEORY_HTML_COLOR(DarkSlateBlue),
+            SPACETHEORY_HTML_COLOR(MediumTurquoise), SPACETHEORY_HTML_COLOR(Indigo),
+            SPACETHEORY_HTML_COLOR(DarkOliveGreen), SPACETHEORY_HTML_COLOR(CadetBlue),
+            SPACETHEORY_HTML_COLOR(CornflowerBlue), SPACETHEORY_HTML_COLOR(RebeccaPurple),
+            SPACETHEORY_HTML_COLOR(MediumAquaMarine), SPACETHEORY_HTML_COLOR(DimGray), SPACETHEORY_HTML_COLOR(DimGrey),
+            SPACETHEORY_HTML_COLOR(SlateBlue), SPACETHEORY_HTML_COLOR(OliveDrab), SPACETHEORY_HTML_COLOR(SlateGray),
+            SPACETHEORY_HTML_COLOR(SlateGrey), SPACETHEORY_HTML_COLOR(LightSlateGray),
+            SPACETHEORY_HTML_COLOR(LightSlateGrey), SPACETHEORY_HTML_COLOR(MediumSlateBlue),
+            SPACETHEORY_HTML_COLOR(LawnGreen), SPACETHEORY_HTML_COLOR(Chartreuse), SPACETHEORY_HTML_COLOR(Aquamarine),
+            SPACETHEORY_HTML_COLOR(Maroon), SPACETHEORY_HTML_COLOR(Purple), SPACETHEORY_HTML_COLOR(Olive),
+            SPACETHEORY_HTML_COLOR(Gray), SPACETHEORY_HTML_COLOR(Grey), SPACETHEORY_HTML_COLOR(SkyBlue),
+            SPACETHEORY_HTML_COLOR(LightSkyBlue), SPACETHEORY_HTML_COLOR(BlueViolet), SPACETHEORY_HTML_COLOR(DarkRed),
+            SPACETHEORY_HTML_COLOR(DarkMagenta), SPACETHEORY_HTML_COLOR(SaddleBrown),
+            SPACETHEORY_HTML_COLOR(DarkSeaGreen), SPACETHEORY_HTML_COLOR(LightGreen),
+            SPACETHEORY_HTML_COLOR(MediumPurple), SPACETHEORY_HTML_COLOR(DarkViolet), SPACETHEORY_HTML_COLOR(PaleGreen),
+            SPACETHEORY_HTML_COLOR(DarkOrchid), SPACETHEORY_HTML_COLOR(YellowGreen), SPACETHEORY_HTML_COLOR(Sienna),
+            SPACETHEORY_HTML_COLOR(Brown), SPACETHEORY_HTML_COLOR(DarkGray), SPACETHEORY_HTML_COLOR(DarkGrey),
+            SPACETHEORY_HTML_COLOR(LightBlue), SPACETHEORY_HTML_COLOR(GreenYellow),
+            SPACETHEORY_HTML_COLOR(PaleTurquoise), SPACETHEORY_HTML_COLOR(LightSteelBlue),
+            SPACETHEORY_HTML_COLOR(PowderBlue), SPACETHEORY_HTML_COLOR(FireBrick),
+            SPACETHEORY_HTML_COLOR(DarkGoldenRod), SPACETHEORY_HTML_COLOR(MediumOrchid),
+            SPACETHEORY_HTML_COLOR(RosyBrown), SPACETHEORY_HTML_COLOR(DarkKhaki), SPACETHEORY_HTML_COLOR(Silver),
+            SPACETHEORY_HTML_COLOR(MediumVioletRed), SPACETHEORY_HTML_COLOR(IndianRed), SPACETHEORY_HTML_COLOR(Peru),
+            SPACETHEORY_HTML_COLOR(Chocolate), SPACETHEORY_HTML_COLOR(Tan), SPACETHEORY_HTML_COLOR(LightGray),
+            SPACETHEORY_HTML_COLOR(LightGrey), SPACETHEORY_HTML_COLOR(Thistle), SPACETHEORY_HTML_COLOR(Orchid),
+            SPACETHEORY_HTML_COLOR(GoldenRod), SPACETHEORY_HTML_COLOR(PaleVioletRed), SPACETHEORY_HTML_COLOR(Crimson),
+            SPACETHEORY_HTML_COLOR(Gainsboro), SPACETHEORY_HTML_COLOR(Plum), SPACETHEORY_HTML_COLOR(BurlyWood),
+            SPACETHEORY_HTML_COLOR(LightCyan), SPACETHEORY_HTML_COLOR(Lavender), SPACETHEORY_HTML_COLOR(DarkSalmon),
+            SPACETHEORY_HTML_COLOR(Violet), SPACETHEORY_HTML_COLOR(PaleGoldenRod), SPACETHEORY_HTML_COLOR(LightCoral),
+            SPACETHEORY_HTML_COLOR(Khaki), SPACETHEORY_HTML_COLOR(AliceBlue), SPACETHEORY_HTML_COLOR(HoneyDew),
+            SPACETHEORY_HTML_COLOR(Azure), SPACETHEORY_HTML_COLOR(SandyBrown), SPACETHEORY_HTML_COLOR(Wheat),
+            SPACETHEORY_HTML_COLOR(Beige), SPACETHEORY_HTML_COLOR(WhiteSmoke), SPACETHEORY_HTML_COLOR(MintCream),
+            SPACETHEORY_HTML_COLOR(GhostWhite), SPACETHEORY_HTML_COLOR(Salmon), SPACETHEORY_HTML_COLOR(AntiqueWhite),
+            SPACETHEORY_HTML_COLOR(Linen), SPACETHEORY_HTML_COLOR(LightGoldenRodYellow),
+            SPACETHEORY_HTML_COLOR(OldLace), SPACETHEORY_HTML_COLOR(Red), SPACETHEORY_HTML_COLOR(Fuchsia),
+            SPACETHEORY_HTML_COLOR(Magenta), SPACETHEORY_HTML_COLOR(DeepPink), SPACETHEORY_HTML_COLOR(OrangeRed),
+            SPACETHEORY_HTML_COLOR(Tomato), SPACETHEORY_HTML_COLOR(HotPink), SPACETHEORY_HTML_COLOR(Coral),
+            SPACETHEORY_HTML_COLOR(DarkOrange), SPACETHEORY_HTML_COLOR(LightSalmon), SPACETHEORY_HTML_COLOR(Orange),
+            SPACETHEORY_HTML_COLOR(LightPink), SPACETHEORY_HTML_COLOR(Pink), SPACETHEORY_HTML_COLOR(Gold),
+            SPACETHEORY_HTML_COLOR(PeachPuff), SPACETHEORY_HTML_COLOR(NavajoWhite), SPACETHEORY_HTML_COLOR(Moccasin),
+            SPACETHEORY_HTML_COLOR(Bisque), SPACETHEORY_HTML_COLOR(MistyRose), SPACETHEORY_HTML_COLOR(BlanchedAlmond),
+            SPACETHEORY_HTML_COLOR(PapayaWhip), SPACETHEORY_HTML_COLOR(LavenderBlush), SPACETHEORY_HTML_COLOR(SeaShell),
+            SPACETHEORY_HTML_COLOR(Cornsilk), SPACETHEORY_HTML_COLOR(LemonChiffon), SPACETHEORY_HTML_COLOR(FloralWhite),
+            SPACETHEORY_HTML_COLOR(Snow), SPACETHEORY_HTML_COLOR(Yellow), SPACETHEORY_HTML_COLOR(LightYellow),
+            SPACETHEORY_HTML_COLOR(Ivory), SPACETHEORY_HTML_COLOR(White)
+        };
+#undef SPACETHEORY_HTML_COLOR
+
+        inline constexpr size_t name_count = sizeof(by_name) / sizeof(by_name[0]);
+
+        namespace detail {
+            constexpr size_t bucket_count = 64;     // Power of two
+            constexpr size_t slot_count = 256;      // Power of two, over half empty so displacements are found quickly
+            static_assert(name_count < 255, "Slots hold an index + 1 in a byte");
+
+            constexpr char lower(const char c) { return (c >= 'A' && c <= 'Z') ? (char) (c + ('a' - 'A')) : c; }
+
+            constexpr bool equal(const std::string_view a, const std::string_view b)
+            {
+                if (a.size() != b.size()) return false;
+                for (size_t i = 0; i < a.size(); ++i) {
+                    if (lower(a[i]) != lower(b[i])) return false;
+                }
+                return true;
+            }
+
+            // FNV-1a over the lowercased name:
+            constexpr uint32_t hash(const std::string_view name)
+            {
+                uint32_t h = 2166136261u;
+                for (size_t i = 0; i < name.size(); ++i) {
+                    h ^= (uint8_t) lower(name[i]);
+                    h *= 16777619u;
+                }
+                return h;
+            }
+
+            constexpr uint32_t slot(uint32_t h, const uint32_t displacement)
+            {
+                h ^= displacement * 0x9E3779B9u;
+                h ^= h >> 16;
+                h *= 0x85EBCA6Bu;
+                h ^= h >> 13;
+                return h & (uint32_t) (slot_count - 1);
+            }
+
+            struct perfect_hash_table {
+                uint16_t displacements[bucket_count];
+                uint8_t slots[slot_count]; // Index into by_name + 1, 0 when empty
+                bool complete;
+            };
+
+            constexpr perfect_hash_table build_perfect_hash()
+            {
+                perfect_hash_table table{};
+                uint32_t hashes[name_count]{};
+                size_t bucket_sizes[bucket_count]{}, bucket_starts[bucket_count + 1]{}, members[name_count]{};
+                size_t largest = 0;
+
+                // BUCKETS:
+                // Counting sort of names into buckets, so trying a displacement
+                // only touches that bucket's names.
+                for (size_t i = 0; i < name_count; ++i) {
+                    hashes[i] = hash(by_name[i].name);
+                    bucket_sizes[hashes[i] & (bucket_count - 1)]++;
+                }
+                for (size_t b = 0; b < bucket_count; ++b) {
+                    bucket_starts[b + 1] = bucket_starts[b] + bucket_sizes[b];
+                    if (bucket_sizes[b] > largest) largest = bucket_sizes[b];
+                }
+                size_t filled[bucket_count]{};
+                for (size_t i = 0; i < name_count; ++i) {
+                    const size_t b = hashes[i] & (bucket_count - 1);
+                    members[bucket_starts[b] + filled[b]++] = i;
+                }
+
+                // DISPLACEMENTS, BIGGEST BUCKETS FIRST:
+                table.complete = true;
+                for (size_t size = largest; size > 0; --size) {
+                    for (size_t b = 0; b < bucket_count; ++b) {
+                        if (bucket_sizes[b] != size) continue;
+
+                        bool found = false;
+                        for (uint32_t d = 0; d < 0x10000 && !found; ++d) {
+                            size_t placed = 0;
+                            for (; placed < size; ++placed) {
+                                const uint32_t s = slot(hashes[members[bucket_starts[b] + placed]], d);
+                                if (table.slots[s] != 0) break;
+                                table.slots[s] = (uint8_t) (members[bucket_starts[b] + placed] + 1);
+                            }
+
+                            if (placed == size) {
+                                table.displacements[b] = (uint16_t) d;
+                                found = true;
+                            }
+                            else while (placed > 0) {
+                                --placed;
+                                table.slots[slot(hashes[members[bucket_starts[b] + placed]], d)] = 0;
+                            }
+                        }
+                        if (!found) table.complete = false;
+                    }
+                }
+                return table;
+            }
+        }
+
+        // About 184k constant evaluation steps, past MSVC's default of 100k:
+        // the projects raise it with /constexpr:steps1000000.
+        inline constexpr detail::perfect_hash_table perfect_hash = detail::build_perfect_hash();
+        static_assert(perfect_hash.complete, "No displacement found for a bucket, grow slot_count");
+
+        // Finds a color by name, case-insensitively:
+        constexpr bool lookup(const std::string_view name, uint32_t& value)
+        {
+            const uint32_t h = detail::hash(name);
+            const uint8_t index = perfect_hash.slots[detail::slot(h, perfect_hash.displacements[h & (detail::bucket_count - 1)])];
+            if (index == 0 || !detail::equal(by_name[index - 1].name, name)) return false;
+
+            value = by_name[index - 1].value;
+            return true;
+        }
     }
 
 }
\ No newline at end of file
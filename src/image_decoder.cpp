@@ -0,0 +1,105 @@
+#include "image_decoder.h"
+#include <stb_image.h> // Implemented by nanovg.c
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+using namespace spacetheory;
+
+image_decoder::image_decoder(unsigned threads) : m_busy(0), m_running(true)
+{
+    if (threads == 0) {
+        const unsigned cores = std::thread::hardware_concurrency();
+        threads = std::min(std::max(cores, 2u) - 1, 4u);
+    }
+
+    for (unsigned i = 0; i < threads; ++i) m_workers.push_back(std::thread(&image_decoder::worker_main, this));
+}
+
+image_decoder::~image_decoder()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+        m_requests.clear();
+    }
+    m_wake.notify_all();
+    for (auto& w : m_workers) w.join();
+}
+
+uint64_t image_decoder::hash_bytes(const uint8_t * data, const size_t size)
+{
+    // FNV-1a:
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+image_decoder::result image_decoder::decode_file(const std::string& path)
+{
+    result r;
+    r.path = path;
+
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file) return r;
+    const std::vector<uint8_t> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    r.hash = hash_bytes(contents.data(), contents.size());
+    r.file_size = contents.size();
+
+    // stb_image keeps its failure reason per process, not per thread, so the
+    // reason isn't passed along; the path is enough to go on.
+    int components = 0;
+    uint8_t * pixels = stbi_load_from_memory(contents.data(), (int) contents.size(), &r.width, &r.height, &components, 4);
+    if (!pixels) return r;
+
+    r.pixels = std::shared_ptr<uint8_t>(pixels, [](uint8_t * p) { stbi_image_free(p); });
+    r.ok = true;
+    return r;
+}
+
+void image_decoder::worker_main()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wake.wait(lock, [this] { return !m_running || !m_requests.empty(); });
+        if (!m_running) break;
+
+        const std::string path = std::move(m_requests.front());
+        m_requests.pop_front();
+        m_busy++;
+        lock.unlock();
+
+        result r = decode_file(path);
+
+        lock.lock();
+        m_busy--;
+        m_results.push_back(std::move(r));
+    }
+}
+
+void image_decoder::submit(const std::string& path)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests.push_back(path);
+    }
+    m_wake.notify_one();
+}
+
+bool image_decoder::poll(result& finished)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_results.empty()) return false;
+    finished = std::move(m_results.front());
+    m_results.pop_front();
+    return true;
+}
+
+size_t image_decoder::pending()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_requests.size() + m_busy + m_results.size();
+}
\ No newline at end of file
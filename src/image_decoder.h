@@ -0,0 +1,54 @@
+#pragma once
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace spacetheory {
+
+    // Reads and decodes image files on worker threads. Nothing here touches
+    // OpenGL; finished images are collected with poll() by whoever uploads
+    // them (texture_cache, on the render thread).
+    class image_decoder {
+    public:
+        struct result {
+            std::string path;
+            bool ok = false;
+            uint64_t hash = 0;              // FNV-1a of the file's contents
+            size_t file_size = 0;
+            int width = 0, height = 0;
+            std::shared_ptr<uint8_t> pixels; // RGBA8, freed with stbi_image_free
+        };
+
+    private:
+        std::vector<std::thread> m_workers;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::deque<std::string> m_requests;
+        std::deque<result> m_results;
+        size_t m_busy;
+        bool m_running;
+
+        void worker_main();
+
+    public:
+        // 0 threads picks one per core, leaving one for the main thread:
+        image_decoder(unsigned threads = 0);
+        image_decoder(const image_decoder&) = delete;
+        image_decoder& operator=(const image_decoder&) = delete;
+        ~image_decoder(); // Requests still queued are abandoned
+
+        static uint64_t hash_bytes(const uint8_t * data, const size_t size);
+        // Reads and decodes on the calling thread:
+        static result decode_file(const std::string& path);
+
+        void submit(const std::string& path);
+        bool poll(result& finished);
+        size_t pending(); // Queued, decoding or waiting to be polled
+    };
+
+}
\ No newline at end of file
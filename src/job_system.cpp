@@ -0,0 +1,275 @@
+#include "job_system.h"
+#include "logging.h"
+
+using namespace spacetheory;
+
+const int64_t spacetheory::job_system::deque::capacity;
+
+static thread_local int current_worker = -1;
+static thread_local const job_system * current_system = nullptr;
+static const int idle_spins = 64; // Steal attempts before a worker goes to sleep
+
+// ----------------------------------------------------------------------------
+// DEQUE
+// ----------------------------------------------------------------------------
+
+job_system::deque::deque() : m_top(0), m_bottom(0)
+{
+    for (auto& j : m_jobs) j.store(nullptr, std::memory_order_relaxed);
+}
+
+bool job_system::deque::push(job * j)
+{
+    const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    const int64_t top = m_top.load(std::memory_order_acquire);
+    if (bottom - top >= capacity) return false;
+
+    m_jobs[bottom & (capacity - 1)].store(j, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+}
+
+job_system::job * job_system::deque::pop()
+{
+    const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = m_top.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+        // Empty:
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    job * j = m_jobs[bottom & (capacity - 1)].load(std::memory_order_relaxed);
+    if (top == bottom) {
+        // Last job, a thief may be taking it at the same time:
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) j = nullptr;
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return j;
+}
+
+job_system::job * job_system::deque::steal()
+{
+    int64_t top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+    if (top >= bottom) return nullptr;
+
+    job * j = m_jobs[top & (capacity - 1)].load(std::memory_order_relaxed);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+    return j;
+}
+
+// ----------------------------------------------------------------------------
+// JOB SYSTEM
+// ----------------------------------------------------------------------------
+
+job_system::job_system(unsigned threads) : m_queued(0), m_sleeping(0), m_running(true)
+{
+    if (threads == 0) {
+        const unsigned cores = std::thread::hardware_concurrency();
+        threads = std::max(cores, 2u) - 1;
+    }
+
+    for (unsigned i = 0; i < threads; ++i) m_deques.push_back(std::make_unique<deque>());
+    for (unsigned i = 0; i < threads; ++i) m_workers.push_back(std::thread(&job_system::worker_main, this, i));
+}
+
+job_system::~job_system()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_running.store(false);
+    }
+    m_wake.notify_all();
+    for (auto& w : m_workers) w.join();
+
+    // DROP WHAT'S LEFT:
+    for (auto& d : m_deques) {
+        while (job * j = d->steal()) delete j;
+    }
+    for (auto j : m_shared) delete j;
+}
+
+int job_system::worker_index()
+{
+    return current_worker;
+}
+
+void job_system::worker_main(const unsigned index)
+{
+    current_worker = (int) index;
+    current_system = this;
+
+    int idle = 0;
+    while (m_running.load(std::memory_order_relaxed)) {
+        job * j = find_job((int) index);
+        if (j) {
+            execute(j);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < idle_spins) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // SLEEP:
+        // Submitters only take the lock when someone is sleeping, and the
+        // sleeper counts itself before checking for work, so a job submitted
+        // in between can't be missed.
+        std::unique_lock<std::mutex> lock(m_sleep_mutex);
+        m_sleeping.fetch_add(1);
+        m_wake.wait(lock, [this] { return m_queued.load() > 0 || !m_running.load(); });
+        m_sleeping.fetch_sub(1);
+        idle = 0;
+    }
+
+    current_worker = -1;
+    current_system = nullptr;
+}
+
+void job_system::submit(job * j)
+{
+    m_queued.fetch_add(1);
+
+    const int worker = current_system == this ? current_worker : -1;
+    if (worker < 0 || !m_deques[worker]->push(j)) {
+        std::lock_guard<std::mutex> lock(m_shared_mutex);
+        m_shared.push_back(j);
+    }
+
+    if (m_sleeping.load() > 0) {
+        { std::lock_guard<std::mutex> lock(m_sleep_mutex); }
+        m_wake.notify_one();
+    }
+}
+
+job_system::job * job_system::find_job(const int worker)
+{
+    job * j = nullptr;
+
+    // OWN DEQUE, NEWEST FIRST:
+    // What this worker just pushed is most likely still in its cache.
+    if (worker >= 0) j = m_deques[worker]->pop();
+
+    // SHARED QUEUE:
+    if (!j) {
+        std::lock_guard<std::mutex> lock(m_shared_mutex);
+        if (!m_shared.empty()) {
+            j = m_shared.front();
+            m_shared.pop_front();
+        }
+    }
+
+    // STEAL, OLDEST FIRST:
+    // Starting after this worker so thieves spread out over their victims.
+    if (!j) {
+        const size_t count = m_deques.size();
+        const size_t start = worker >= 0 ? (size_t) worker + 1 : 0;
+        for (size_t i = 0; i < count && !j; ++i) {
+            const size_t victim = (start + i) % count;
+            if ((int) victim != worker) j = m_deques[victim]->steal();
+        }
+    }
+
+    if (j) m_queued.fetch_sub(1);
+    return j;
+}
+
+void job_system::execute(job * j)
+{
+    // An exception reaching the worker's thread function would terminate the
+    // process, so it's handed to whoever waits on the counter instead:
+    job_counter * counter = j->counter;
+    try {
+        j->function();
+    }
+    catch (...) {
+        if (counter) {
+            std::lock_guard<std::mutex> lock(counter->m_mutex);
+            if (!counter->m_exception) counter->m_exception = std::current_exception();
+        }
+        else {
+            try {
+                throw;
+            }
+            catch (const std::exception& e) {
+                SPACETHEORY_LOG_ASYNC(log_level::error, "A job without a counter threw: %s", e.what());
+            }
+            catch (...) {
+                SPACETHEORY_LOG_ASYNC(log_level::error, "A job without a counter threw");
+            }
+        }
+    }
+    delete j;
+    finish(counter);
+}
+
+void job_system::finish(job_counter * counter)
+{
+    if (!counter) return;
+
+    // Anything but the last job just counts down:
+    uint32_t value = counter->m_value.load(std::memory_order_relaxed);
+    while (value > 1) {
+        if (counter->m_value.compare_exchange_weak(value, value - 1, std::memory_order_acq_rel, std::memory_order_relaxed)) return;
+    }
+
+    // LAST JOB:
+    // Reaches zero under the counter's lock, the same lock run_after checks
+    // the counter under, so a continuation is either released here or run by
+    // run_after right away, never both or neither. wait() passes through the
+    // lock too, so the counter can't be destroyed while it's still held here.
+    std::vector<void *> continuations;
+    {
+        std::lock_guard<std::mutex> lock(counter->m_mutex);
+        if (counter->m_value.fetch_sub(1, std::memory_order_acq_rel) != 1) return; // More were added meanwhile
+        continuations.swap(counter->m_continuations);
+    }
+    for (auto c : continuations) submit((job *) c);
+}
+
+void job_system::run(job_function function, job_counter * counter)
+{
+    if (counter) counter->m_value.fetch_add(1, std::memory_order_relaxed);
+    submit(new job{ std::move(function), counter });
+}
+
+void job_system::run_after(job_counter& dependency, job_function function, job_counter * counter)
+{
+    if (counter) counter->m_value.fetch_add(1, std::memory_order_relaxed);
+    job * j = new job{ std::move(function), counter };
+
+    {
+        std::lock_guard<std::mutex> lock(dependency.m_mutex);
+        if (!dependency.done()) {
+            dependency.m_continuations.push_back(j);
+            return;
+        }
+    }
+    submit(j);
+}
+
+void job_system::wait(job_counter& counter)
+{
+    // HELP WHILE WAITING:
+    const int worker = current_system == this ? current_worker : -1;
+    while (!counter.done()) {
+        job * j = find_job(worker);
+        if (j) execute(j);
+        else std::this_thread::yield();
+    }
+
+    std::exception_ptr exception;
+    {
+        std::lock_guard<std::mutex> lock(counter.m_mutex);
+        exception.swap(counter.m_exception);
+    }
+    if (exception) std::rethrow_exception(exception);
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#pragma once
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace spacetheory {
+
+    class job_system;
+
+    // Counts unfinished jobs. Jobs given a counter increment it when they're
+    // submitted and decrement it when they finish; jobs can also be queued to
+    // start once a counter reaches zero, which is how dependencies are built.
+    // Counters can be reused once they're back at zero, and destroyed once
+    // job_system::wait has returned for them.
+    //
+    // A job that throws still counts as finished (its continuations still
+    // start), the first exception is kept here and rethrown by wait.
+    class job_counter {
+        friend job_system;
+    private:
+        std::atomic<uint32_t> m_value;
+        std::mutex m_mutex; // Guards the continuations and the exception
+        std::vector<void *> m_continuations; // Jobs waiting for zero
+        std::exception_ptr m_exception; // First thrown by one of its jobs
+
+    public:
+        job_counter() : m_value(0) {}
+        job_counter(const job_counter&) = delete;
+        job_counter& operator=(const job_counter&) = delete;
+
+        inline bool done() const { return m_value.load(std::memory_order_acquire) == 0; }
+        inline uint32_t value() const { return m_value.load(std::memory_order_acquire); }
+    };
+
+    // One worker thread per core (minus the main thread), each with its own
+    // work-stealing deque: a worker pushes and pops jobs at the bottom of its
+    // own deque without contention, idle workers steal from the top of the
+    // others'. Threads that aren't workers submit through a shared queue.
+    // Waiting on a counter runs jobs instead of blocking, so waiting inside a
+    // job can't deadlock the pool.
+    class job_system {
+    public:
+        typedef std::function<void()> job_function;
+
+    private:
+        struct job {
+            job_function function;
+            job_counter * counter;
+        };
+
+        // Chase-Lev deque with a fixed capacity, a full deque spills into the
+        // shared queue:
+        class deque {
+        private:
+            static const int64_t capacity = 4096; // Power of two
+            std::atomic<int64_t> m_top, m_bottom;
+            std::atomic<job *> m_jobs[capacity];
+        public:
+            deque();
+            bool push(job * j); // Owner only
+            job * pop();        // Owner only
+            job * steal();      // Any thread
+        };
+
+        std::vector<std::thread> m_workers;
+        std::vector<std::unique_ptr<deque>> m_deques;
+
+        std::mutex m_shared_mutex;
+        std::deque<job *> m_shared; // From threads that aren't workers
+
+        std::atomic<int64_t> m_queued; // Jobs waiting anywhere, for sleeping workers
+        std::atomic<int> m_sleeping;
+        std::mutex m_sleep_mutex;
+        std::condition_variable m_wake;
+        std::atomic<bool> m_running;
+
+        void worker_main(const unsigned index);
+        void submit(job * j);
+        job * find_job(const int worker);
+        void execute(job * j);
+        void finish(job_counter * counter);
+
+    public:
+        // 0 threads picks one per core, leaving one for the main thread:
+        job_system(unsigned threads = 0);
+        job_system(const job_system&) = delete;
+        job_system& operator=(const job_system&) = delete;
+        ~job_system(); // Wait on your counters first, jobs still queued are dropped
+
+        inline unsigned thread_count() const { return (unsigned) m_workers.size(); }
+        // Index of the calling worker thread, -1 for any other thread:
+        static int worker_index();
+
+        void run(job_function function, job_counter * counter = nullptr);
+        // Starts once dependency reaches zero (right away if it already has):
+        void run_after(job_counter& dependency, job_function function, job_counter * counter = nullptr);
+        // Runs queued jobs until the counter reaches zero, then rethrows the
+        // first exception one of its jobs threw (if any) and forgets it. Jobs
+        // without a counter have nowhere to report to, what they throw is
+        // logged and dropped:
+        void wait(job_counter& counter);
+
+        // Calls function(first, last) over [begin, end) split into chunks of at
+        // least grain indices, and returns once every chunk is done. The
+        // calling thread takes part. If chunks throw, the first exception is
+        // rethrown, still only once every chunk is done.
+        template<typename function_type>
+        void parallel_for(const size_t begin, const size_t end, size_t grain, function_type function)
+        {
+            if (begin >= end) return;
+            const size_t count = end - begin;
+
+            // A few chunks per thread so stealing can even out uneven work:
+            const size_t target_chunks = (size_t) (thread_count() + 1) * 4;
+            grain = std::max<size_t>(std::max<size_t>(grain, 1), (count + target_chunks - 1) / target_chunks);
+            if (grain >= count || thread_count() == 0) {
+                function(begin, end);
+                return;
+            }
+
+            job_counter counter;
+            for (size_t first = begin + grain; first < end; first += grain) {
+                const size_t last = std::min(first + grain, end);
+                run([&function, first, last]() { function(first, last); }, &counter);
+            }
+            // The other chunks refer to function and the counter, so they have
+            // to finish even when this one throws:
+            std::exception_ptr exception;
+            try {
+                function(begin, begin + grain);
+            }
+            catch (...) {
+                exception = std::current_exception();
+            }
+            wait(counter);
+            if (exception) std::rethrow_exception(exception);
+        }
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "layer.h"
+#include "error.h"
+
+using namespace spacetheory;
+
+layer::layer(const uint32_t width, const uint32_t height, const bool antialias)
+    : m_width(width), m_height(height), m_antialias(antialias), m_rendered_hash(0), m_dirty(true)
+{
+}
+
+graphics2d_command_list& layer::record()
+{
+    m_commands.reset();
+    return m_commands;
+}
+
+bool layer::needs_render() const
+{
+    return m_dirty || !m_target || m_commands.hash() != m_rendered_hash;
+}
+
+void layer::resize(const uint32_t width, const uint32_t height)
+{
+    if(width == m_width && height == m_height) return;
+
+    m_width = width;
+    m_height = height;
+    m_target.reset();
+    m_dirty = true;
+}
+
+bool layer::render()
+{
+    render_device * device = render_device::current();
+    if(!device) throw spacetheory::error("No render device to render layer with");
+    return render(*device);
+}
+
+bool layer::render(render_device& device)
+{
+    if(m_target && &m_target->device() != &device) {
+        m_target.reset();
+        m_dirty = true;
+    }
+
+    if(!needs_render()) return false;
+    if(m_width == 0 || m_height == 0) return false;
+
+    if(!m_target) m_target.reset(new graphics2d(device, m_width, m_height, m_antialias));
+
+    m_target->begin();
+
+    // CLEAR TO TRANSPARENT:
+    // Stencil too, NanoVG's fills rely on it starting out cleared.
+    m_target->clear(graphics2d::transparent, graphics2d::color_buffer | graphics2d::stencil_buffer);
+
+    m_commands.replay(*m_target);
+    m_target->end();
+
+    m_rendered_hash = m_commands.hash();
+    m_dirty = false;
+    m_stats.renders++;
+    return true;
+}
+
+void layer::draw(graphics2d& target, const float x, const float y)
+{
+    if(!target.is_ready()) return;
+
+    // The offscreen begin() suspends target's frame and end() resumes it, its
+    // transform and clip included:
+    if(!render(target.device()) && m_target) m_stats.reuses++;
+
+    if(m_target) target.draw(*m_target, x, y);
+}
\ No newline at end of file
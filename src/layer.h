@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include <memory>
+#include "graphics2d.h"
+#include "graphics2d_command_list.h"
+
+namespace spacetheory {
+
+    // Retained drawing: the contents are recorded into a command list, rendered
+    // once into an offscreen graphics2d and composited from there as a single
+    // textured quad. The offscreen copy is only rendered again when the layer
+    // is invalidated or a new recording hashes differently, so re-recording
+    // the same contents every frame costs the recording and nothing on the GPU.
+    //
+    // Rendering and drawing need the OpenGL context, recording doesn't. The
+    // offscreen target is created on first render.
+    class layer {
+    public:
+        struct stats {
+            size_t renders = 0; // Times the contents went to the offscreen target
+            size_t reuses = 0;  // Times drawing got away with the previous render
+        };
+
+    private:
+        uint32_t m_width, m_height;
+        bool m_antialias;
+        std::unique_ptr<graphics2d> m_target;
+        graphics2d_command_list m_commands;
+        uint64_t m_rendered_hash;
+        bool m_dirty;
+        stats m_stats;
+
+    public:
+        layer(const uint32_t width, const uint32_t height, const bool antialias = false);
+        layer(const layer&) = delete;
+        layer& operator=(const layer&) = delete;
+
+        inline uint32_t width() const { return m_width; }
+        inline uint32_t height() const { return m_height; }
+        inline const stats& get_stats() const { return m_stats; }
+
+        // Empties the recording and returns it to record the new contents:
+        graphics2d_command_list& record();
+        inline const graphics2d_command_list& commands() const { return m_commands; }
+
+        // Forces the next render, for contents the hash can't see change (an
+        // image re-uploaded under the same handle, say):
+        inline void invalidate() { m_dirty = true; }
+        bool needs_render() const;
+
+        // Resizing drops the offscreen target, it's recreated on next render:
+        void resize(const uint32_t width, const uint32_t height);
+
+        // Renders the recording to the offscreen target if needed, returns true
+        // if it did. The target lives on the given device (the current one if
+        // none is), changing devices recreates it. Inside another graphics2d's
+        // frame that frame is suspended for the render and resumed after:
+        bool render();
+        bool render(render_device& device);
+
+        // Renders if needed and composites onto target, which has to be between
+        // its begin() and end(). The target keeps its transform and clip:
+        void draw(graphics2d& target, const float x, const float y);
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,3 @@
+#include "logging.h"
+
+std::atomic<spacetheory::log_level> spacetheory::logging::runtime_level(spacetheory::logging::compiled_level);
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+#include <logger.h>
+#include "async_log.h"
+
+// LOG LEVEL THRESHOLD:
+// Messages above SPACETHEORY_LOG_MAX_LEVEL (a log_level value) are compiled
+// out: the condition is a constant, so the stream expression or format call
+// behind it is dead code the optimizer removes, arguments and all. Release
+// builds keep everything up to info unless a project overrides it.
+#ifndef SPACETHEORY_LOG_MAX_LEVEL
+#ifdef _DEBUG
+#define SPACETHEORY_LOG_MAX_LEVEL 6 // debug2
+#else
+#define SPACETHEORY_LOG_MAX_LEVEL 4 // info
+#endif
+#endif
+
+// Streams into xeekworx::log, nothing after the macro is evaluated unless the
+// level is compiled in and enabled at runtime:
+//     SPACETHEORY_LOG(log_level::debug2) << "Value: " << value << std::endl;
+#define SPACETHEORY_LOG(level) \
+    if (!spacetheory::logging::enabled(level)) {} \
+    else xeekworx::log << LOGSTAMP << spacetheory::logging::to_logtype(level)
+
+// For guarding work that only exists to be logged:
+#define SPACETHEORY_LOG_ENABLED(level) spacetheory::logging::enabled(level)
+
+// printf-style into the asynchronous log, for per-frame and worker thread code:
+//     SPACETHEORY_LOG_ASYNC(log_level::debug, "Frame %llu took %.2f ms", n, ms);
+#define SPACETHEORY_LOG_ASYNC(level, ...) \
+    do { \
+        if (spacetheory::logging::compiled(level)) { \
+            spacetheory::async_log * async_log_ = spacetheory::async_log::current(); \
+            if (async_log_ && async_log_->enabled(level)) async_log_->write(level, __VA_ARGS__); \
+        } \
+    } while (0)
+
+namespace spacetheory {
+
+    namespace logging {
+
+        constexpr log_level compiled_level = static_cast<log_level>(SPACETHEORY_LOG_MAX_LEVEL);
+
+        // Runtime threshold for SPACETHEORY_LOG, starts at compiled_level:
+        extern std::atomic<log_level> runtime_level;
+
+        inline constexpr bool compiled(const log_level level) { return level <= compiled_level; }
+
+        inline bool enabled(const log_level level)
+        {
+            return compiled(level) && level <= runtime_level.load(std::memory_order_relaxed);
+        }
+
+        inline void set_level(const log_level level) { runtime_level.store(level, std::memory_order_relaxed); }
+        inline log_level get_level() { return runtime_level.load(std::memory_order_relaxed); }
+
+        inline xeekworx::logtype to_logtype(const log_level level)
+        {
+            switch (level) {
+            case log_level::fatal: return xeekworx::FATAL;
+            case log_level::error: return xeekworx::ERR;
+            case log_level::warning: return xeekworx::WARNING;
+            case log_level::notice: return xeekworx::NOTICE;
+            case log_level::info: return xeekworx::INFO;
+            case log_level::debug: return xeekworx::DEBUG;
+            default: return xeekworx::DEBUG2;
+            }
+        }
+
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+
+namespace spacetheory {
+
+    struct loop_setup {
+        double update_rate = 60.0; // fixed simulation steps per second
+        double frame_rate_cap = 0.0; // rendered frames per second, 0 for uncapped
+        unsigned max_updates_per_frame = 8; // steps run before the backlog is dropped
+        double max_frame_time = 0.25; // seconds, longer frames (breakpoints, hitches) are clamped
+        // Render and present on their own thread, see application::on_prepare_frame.
+        // The OpenGL context moves there: graphics2d, the render device and its
+        // caches are the render thread's, except texture_cache loads, which are
+        // queued from other threads and uploaded by the next pump():
+        bool threaded_rendering = false;
+        double upload_budget_ms = 2.0; // per frame, for textures loaded in the background
+        unsigned long long frame_limit = 0; // quit after this many frames and log frame times, 0 for no limit
+    };
+
+}
\ No newline at end of file
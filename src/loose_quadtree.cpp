@@ -0,0 +1,201 @@
+#include "loose_quadtree.h"
+#include <algorithm>
+
+using namespace spacetheory;
+
+loose_quadtree::loose_quadtree(const rectangle& area, const int max_depth)
+    : m_area(area), m_depth(std::min(std::max(max_depth, 0), 10)), m_count(0)
+{
+    size_t nodes = 0;
+    for (int level = 0; level <= m_depth; ++level) {
+        m_level_offsets.push_back(nodes);
+        nodes += (size_t) 1 << (level * 2);
+    }
+    m_nodes.resize(nodes);
+    m_counts.resize(nodes, 0);
+}
+
+rectangle loose_quadtree::loose_bounds(const int level, const int x, const int y) const
+{
+    // The node's quarter grown by half its size on every side:
+    const int cells = 1 << level;
+    const int x0 = m_area.x + (int) ((int64_t) m_area.w * x / cells);
+    const int y0 = m_area.y + (int) ((int64_t) m_area.h * y / cells);
+    const int x1 = m_area.x + (int) ((int64_t) m_area.w * (x + 1) / cells);
+    const int y1 = m_area.y + (int) ((int64_t) m_area.h * (y + 1) / cells);
+    const int half_w = (x1 - x0 + 1) / 2, half_h = (y1 - y0 + 1) / 2;
+    return rectangle(x0 - half_w, y0 - half_h, (x1 - x0) + half_w * 2, (y1 - y0) + half_h * 2);
+}
+
+uint32_t loose_quadtree::place(const rectangle& bounds) const
+{
+    // DEEPEST LEVEL IT FITS BY SIZE:
+    // A node's loose bounds hold anything up to the size of its own quarter
+    // whose center lies in that quarter.
+    const int w = std::abs(bounds.w), h = std::abs(bounds.h);
+    const int center_x = bounds.x + bounds.w / 2, center_y = bounds.y + bounds.h / 2;
+    if (!m_area.contains(point(center_x, center_y))) return 0;
+
+    int level = 0;
+    while (level < m_depth && w * 2 <= (m_area.w >> level) && h * 2 <= (m_area.h >> level)) level++;
+
+    // Integer cell sizes round, so it's checked and moved up a level if needed:
+    for (; level > 0; --level) {
+        const int cells = 1 << level;
+        const int x = (int) ((int64_t) (center_x - m_area.x) * cells / m_area.w);
+        const int y = (int) ((int64_t) (center_y - m_area.y) * cells / m_area.h);
+        const rectangle loose = loose_bounds(level, x, y);
+        if (bounds.x >= loose.x && bounds.y >= loose.y && bounds.right() <= loose.right() && bounds.bottom() <= loose.bottom()) {
+            return (uint32_t) (m_level_offsets[level] + (size_t) y * cells + x);
+        }
+    }
+    return 0;
+}
+
+void loose_quadtree::link(const uint32_t id, slot& s)
+{
+    s.node = place(s.bounds);
+    s.index = (uint32_t) m_nodes[s.node].size();
+    m_nodes[s.node].push_back(id);
+
+    // COUNT IT IN EVERY ANCESTOR:
+    // So queries can skip empty branches.
+    uint32_t node = s.node;
+    int level = m_depth;
+    while (level > 0 && node < m_level_offsets[level]) level--;
+    size_t index = node - m_level_offsets[level];
+    int x = (int) (index % ((size_t) 1 << level)), y = (int) (index / ((size_t) 1 << level));
+    for (;;) {
+        m_counts[m_level_offsets[level] + (size_t) y * ((size_t) 1 << level) + x]++;
+        if (level == 0) break;
+        level--;
+        x >>= 1;
+        y >>= 1;
+    }
+}
+
+void loose_quadtree::unlink(slot& s)
+{
+    // Swap the last id of the node into this one's place:
+    std::vector<uint32_t>& ids = m_nodes[s.node];
+    const uint32_t moved = ids.back();
+    ids[s.index] = moved;
+    m_slots[moved].index = s.index;
+    ids.pop_back();
+
+    int level = m_depth;
+    while (level > 0 && s.node < m_level_offsets[level]) level--;
+    size_t index = s.node - m_level_offsets[level];
+    int x = (int) (index % ((size_t) 1 << level)), y = (int) (index / ((size_t) 1 << level));
+    for (;;) {
+        m_counts[m_level_offsets[level] + (size_t) y * ((size_t) 1 << level) + x]--;
+        if (level == 0) break;
+        level--;
+        x >>= 1;
+        y >>= 1;
+    }
+}
+
+bool loose_quadtree::contains(const uint32_t id) const
+{
+    return id < m_slots.size() && m_slots[id].used;
+}
+
+void loose_quadtree::clear()
+{
+    for (auto& n : m_nodes) n.clear();
+    std::fill(m_counts.begin(), m_counts.end(), 0);
+    m_slots.clear();
+    m_count = 0;
+}
+
+void loose_quadtree::insert(const uint32_t id, const rectangle& bounds)
+{
+    if (contains(id)) {
+        move(id, bounds);
+        return;
+    }
+
+    if (id >= m_slots.size()) m_slots.resize((size_t) id + 1, slot{ rectangle(), 0, 0, false });
+
+    slot& s = m_slots[id];
+    s.bounds = bounds;
+    s.used = true;
+    link(id, s);
+    m_count++;
+}
+
+void loose_quadtree::move(const uint32_t id, const rectangle& bounds)
+{
+    if (!contains(id)) return;
+
+    slot& s = m_slots[id];
+    s.bounds = bounds;
+    if (place(bounds) == s.node) return;
+
+    unlink(s);
+    link(id, s);
+}
+
+void loose_quadtree::remove(const uint32_t id)
+{
+    if (!contains(id)) return;
+
+    slot& s = m_slots[id];
+    unlink(s);
+    s.used = false;
+    m_count--;
+}
+
+size_t loose_quadtree::query(const rectangle& area, std::vector<uint32_t>& hits) const
+{
+    const size_t before = hits.size();
+
+    // Depth first, children are only visited while their branch holds anything
+    // and their loose bounds overlap the area. The root is always visited:
+    // whatever doesn't fit anywhere else is in it.
+    struct visit { int level, x, y; };
+    visit stack[4 * 11];
+    int top = 0;
+    stack[top++] = visit{ 0, 0, 0 };
+    while (top > 0) {
+        const visit v = stack[--top];
+        const size_t node = m_level_offsets[v.level] + (size_t) v.y * ((size_t) 1 << v.level) + v.x;
+        if (m_counts[node] == 0) continue;
+        if (v.level > 0 && !rectangle::has_intersection(area, loose_bounds(v.level, v.x, v.y))) continue;
+
+        for (auto id : m_nodes[node]) {
+            if (rectangle::has_intersection(area, m_slots[id].bounds)) hits.push_back(id);
+        }
+
+        if (v.level < m_depth) {
+            for (int child = 0; child < 4; ++child) stack[top++] = visit{ v.level + 1, v.x * 2 + (child & 1), v.y * 2 + (child >> 1) };
+        }
+    }
+    return hits.size() - before;
+}
+
+size_t loose_quadtree::query(const point& pt, std::vector<uint32_t>& hits) const
+{
+    const size_t before = hits.size();
+
+    struct visit { int level, x, y; };
+    visit stack[4 * 11];
+    int top = 0;
+    stack[top++] = visit{ 0, 0, 0 };
+    while (top > 0) {
+        const visit v = stack[--top];
+        const size_t node = m_level_offsets[v.level] + (size_t) v.y * ((size_t) 1 << v.level) + v.x;
+        if (m_counts[node] == 0) continue;
+        if (v.level > 0 && !loose_bounds(v.level, v.x, v.y).contains(pt)) continue;
+
+        for (auto id : m_nodes[node]) {
+            if (m_slots[id].bounds.contains(pt)) hits.push_back(id);
+        }
+
+        if (v.level < m_depth) {
+            for (int child = 0; child < 4; ++child) stack[top++] = visit{ v.level + 1, v.x * 2 + (child & 1), v.y * 2 + (child >> 1) };
+        }
+    }
+    return hits.size() - before;
+}
\ No newline at end of file
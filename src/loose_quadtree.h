@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "rectangle.h"
+
+namespace spacetheory {
+
+    // Spatial index for entries of mixed sizes. Each node's bounds are loose,
+    // twice the size of its quarter of the area and centered on it, so an
+    // entry goes into exactly one node: the deepest one it fits by size, found
+    // from its center without any searching. Moving an entry is removing it
+    // and putting it back, both constant time. Entries outside the area end up
+    // in the root, which every query checks.
+    //
+    // Levels are complete grids stored flat, so the depth is limited (each
+    // level has four times the nodes of the one above). Entries are identified
+    // by the caller's ids like uniform_grid, and queries follow the same rules.
+    class loose_quadtree {
+    private:
+        struct slot {
+            rectangle bounds;
+            uint32_t node;      // Index into m_nodes
+            uint32_t index;     // Position in that node's list
+            bool used;
+        };
+
+        rectangle m_area;
+        int m_depth;
+        std::vector<size_t> m_level_offsets;        // First node of each level
+        std::vector<std::vector<uint32_t>> m_nodes; // Ids held by each node
+        std::vector<uint32_t> m_counts;             // Ids held by each node and below it
+        std::vector<slot> m_slots;                  // By id
+        size_t m_count;
+
+        uint32_t place(const rectangle& bounds) const;
+        void link(const uint32_t id, slot& s);
+        void unlink(slot& s);
+        rectangle loose_bounds(const int level, const int x, const int y) const;
+
+    public:
+        // max_depth 0 is only the root, 6 gives cells 1/64th of the area. Best
+        // when the deepest cells are a few times the typical entry, 6 is for
+        // large worlds (tens of thousands of entries); small areas want fewer
+        // levels. "demo --bench spatial_index" sweeps it:
+        loose_quadtree(const rectangle& area, const int max_depth = 6);
+
+        inline size_t size() const { return m_count; }
+        inline const rectangle& area() const { return m_area; }
+        bool contains(const uint32_t id) const;
+        void clear();
+
+        void insert(const uint32_t id, const rectangle& bounds); // Moves it if it's already there
+        void move(const uint32_t id, const rectangle& bounds);
+        void remove(const uint32_t id);
+
+        // Append the ids found and return how many, in no particular order:
+        size_t query(const rectangle& area, std::vector<uint32_t>& hits) const;
+        size_t query(const point& pt, std::vector<uint32_t>& hits) const;
+    };
+
+}
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <sstream>
+#include <type_traits>
 
 namespace spacetheory {
 
@@ -8,8 +9,6 @@ namespace spacetheory {
             int x, y;
 
             point(const int x = 0, const int y = 0) { this->x = x; this->y = y; }
-            point(const point& pt) { this->x = pt.x; this->y = pt.y; }
-            virtual ~point() {}
 
             void clear() { x = y = 0; }
 
@@ -66,4 +65,9 @@ namespace spacetheory {
             bool operator!=(const point& pt) { return (x != pt.x || y != pt.y); }
         };
 
+        // Plain values, so arrays of them can be copied in bulk and kept in
+        // half the memory a vtable pointer would take:
+        static_assert(std::is_trivially_copyable<point>::value, "point has to stay trivially copyable");
+        static_assert(sizeof(point) == sizeof(int) * 2, "point has to stay tightly packed");
+
 }
\ No newline at end of file
@@ -0,0 +1,301 @@
+#include "point_batch.h"
+#include "cpu_features.h"
+#include <climits>
+#include <algorithm>
+#if SPACETHEORY_SIMD_X86
+#include <immintrin.h>
+#endif
+
+using namespace spacetheory;
+
+// ----------------------------------------------------------------------------
+// KERNELS
+// ----------------------------------------------------------------------------
+// Same layout as rect_batch's: each processes [begin, count) and returns where
+// it stopped, the scalar ones finish what's left.
+
+namespace {
+
+    struct point_columns {
+        int * x, * y;
+        size_t count;
+    };
+
+    struct extent {
+        int min_x = INT_MAX, min_y = INT_MAX, max_x = INT_MIN, max_y = INT_MIN;
+        bool found = false;
+    };
+
+    // SCALAR:
+
+    void offset_scalar(point_columns p, size_t i, const int dx, const int dy)
+    {
+        for (; i < p.count; ++i) {
+            p.x[i] += dx;
+            p.y[i] += dy;
+        }
+    }
+
+    void extent_scalar(const point_columns& p, size_t i, const rectangle * clip, extent& e)
+    {
+        for (; i < p.count; ++i) {
+            if (clip && !clip->contains(point(p.x[i], p.y[i]))) continue;
+            e.min_x = std::min(e.min_x, p.x[i]);
+            e.min_y = std::min(e.min_y, p.y[i]);
+            e.max_x = std::max(e.max_x, p.x[i]);
+            e.max_y = std::max(e.max_y, p.y[i]);
+            e.found = true;
+        }
+    }
+
+    void query_scalar(const point_columns& p, size_t i, const rectangle& area, std::vector<uint32_t>& hits)
+    {
+        for (; i < p.count; ++i) {
+            if (area.contains(point(p.x[i], p.y[i]))) hits.push_back((uint32_t) i);
+        }
+    }
+
+#if SPACETHEORY_SIMD_X86
+    // SSE2:
+
+    inline __m128i load4(const int * p) { return _mm_loadu_si128((const __m128i *) p); }
+    inline void store4(int * p, const __m128i v) { _mm_storeu_si128((__m128i *) p, v); }
+    inline __m128i select4(const __m128i mask, const __m128i a, const __m128i b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+    inline __m128i max4(const __m128i a, const __m128i b) { return select4(_mm_cmpgt_epi32(a, b), a, b); }
+    inline __m128i min4(const __m128i a, const __m128i b) { return select4(_mm_cmpgt_epi32(a, b), b, a); }
+
+    inline void push_hits(unsigned mask, const size_t base, std::vector<uint32_t>& hits)
+    {
+        while (mask) {
+            hits.push_back((uint32_t) (base + lowest_bit(mask)));
+            mask &= mask - 1;
+        }
+    }
+
+    template<size_t lanes>
+    inline void reduce(const int (&values)[4][lanes], const bool found, extent& e)
+    {
+        if (!found) return;
+        for (size_t l = 0; l < lanes; ++l) {
+            e.min_x = std::min(e.min_x, values[0][l]);
+            e.min_y = std::min(e.min_y, values[1][l]);
+            e.max_x = std::max(e.max_x, values[2][l]);
+            e.max_y = std::max(e.max_y, values[3][l]);
+        }
+        e.found = true;
+    }
+
+    size_t offset_sse2(point_columns p, const int dx, const int dy)
+    {
+        const __m128i vdx = _mm_set1_epi32(dx), vdy = _mm_set1_epi32(dy);
+        size_t i = 0;
+        for (; i + 4 <= p.count; i += 4) {
+            store4(p.x + i, _mm_add_epi32(load4(p.x + i), vdx));
+            store4(p.y + i, _mm_add_epi32(load4(p.y + i), vdy));
+        }
+        return i;
+    }
+
+    size_t extent_sse2(const point_columns& p, const rectangle * clip, extent& e)
+    {
+        if (p.count < 4) return 0;
+
+        const __m128i highest = _mm_set1_epi32(INT_MAX), lowest = _mm_set1_epi32(INT_MIN);
+        __m128i min_x = highest, min_y = highest, max_x = lowest, max_y = lowest;
+        __m128i found = _mm_setzero_si128();
+        const __m128i cx = _mm_set1_epi32(clip ? clip->x : 0), cy = _mm_set1_epi32(clip ? clip->y : 0);
+        const __m128i cr = _mm_set1_epi32(clip ? clip->right() : 0), cb = _mm_set1_epi32(clip ? clip->bottom() : 0);
+        size_t i = 0;
+        for (; i + 4 <= p.count; i += 4) {
+            const __m128i x = load4(p.x + i), y = load4(p.y + i);
+            __m128i inside = _mm_cmpeq_epi32(x, x);
+            if (clip) {
+                inside = _mm_and_si128(
+                    _mm_andnot_si128(_mm_cmpgt_epi32(cx, x), _mm_cmpgt_epi32(cr, x)),
+                    _mm_andnot_si128(_mm_cmpgt_epi32(cy, y), _mm_cmpgt_epi32(cb, y)));
+            }
+            min_x = min4(min_x, select4(inside, x, highest));
+            min_y = min4(min_y, select4(inside, y, highest));
+            max_x = max4(max_x, select4(inside, x, lowest));
+            max_y = max4(max_y, select4(inside, y, lowest));
+            found = _mm_or_si128(found, inside);
+        }
+
+        alignas(16) int values[4][4];
+        _mm_store_si128((__m128i *) values[0], min_x);
+        _mm_store_si128((__m128i *) values[1], min_y);
+        _mm_store_si128((__m128i *) values[2], max_x);
+        _mm_store_si128((__m128i *) values[3], max_y);
+        reduce(values, _mm_movemask_epi8(found) != 0, e);
+        return i;
+    }
+
+    size_t query_sse2(const point_columns& p, const rectangle& area, std::vector<uint32_t>& hits)
+    {
+        const __m128i ax = _mm_set1_epi32(area.x), ay = _mm_set1_epi32(area.y);
+        const __m128i ar = _mm_set1_epi32(area.right()), ab = _mm_set1_epi32(area.bottom());
+        size_t i = 0;
+        for (; i + 4 <= p.count; i += 4) {
+            const __m128i x = load4(p.x + i), y = load4(p.y + i);
+            const __m128i inside = _mm_and_si128(
+                _mm_andnot_si128(_mm_cmpgt_epi32(ax, x), _mm_cmpgt_epi32(ar, x)),
+                _mm_andnot_si128(_mm_cmpgt_epi32(ay, y), _mm_cmpgt_epi32(ab, y)));
+            push_hits((unsigned) _mm_movemask_ps(_mm_castsi128_ps(inside)), i, hits);
+        }
+        return i;
+    }
+
+    // AVX2:
+
+    SPACETHEORY_TARGET_AVX2 inline __m256i load8(const int * p) { return _mm256_loadu_si256((const __m256i *) p); }
+    SPACETHEORY_TARGET_AVX2 inline void store8(int * p, const __m256i v) { _mm256_storeu_si256((__m256i *) p, v); }
+
+    SPACETHEORY_TARGET_AVX2 size_t offset_avx2(point_columns p, const int dx, const int dy)
+    {
+        const __m256i vdx = _mm256_set1_epi32(dx), vdy = _mm256_set1_epi32(dy);
+        size_t i = 0;
+        for (; i + 8 <= p.count; i += 8) {
+            store8(p.x + i, _mm256_add_epi32(load8(p.x + i), vdx));
+            store8(p.y + i, _mm256_add_epi32(load8(p.y + i), vdy));
+        }
+        return i;
+    }
+
+    SPACETHEORY_TARGET_AVX2 size_t extent_avx2(const point_columns& p, const rectangle * clip, extent& e)
+    {
+        if (p.count < 8) return 0;
+
+        const __m256i highest = _mm256_set1_epi32(INT_MAX), lowest = _mm256_set1_epi32(INT_MIN);
+        __m256i min_x = highest, min_y = highest, max_x = lowest, max_y = lowest;
+        __m256i found = _mm256_setzero_si256();
+        const __m256i cx = _mm256_set1_epi32(clip ? clip->x : 0), cy = _mm256_set1_epi32(clip ? clip->y : 0);
+        const __m256i cr = _mm256_set1_epi32(clip ? clip->right() : 0), cb = _mm256_set1_epi32(clip ? clip->bottom() : 0);
+        size_t i = 0;
+        for (; i + 8 <= p.count; i += 8) {
+            const __m256i x = load8(p.x + i), y = load8(p.y + i);
+            __m256i inside = _mm256_cmpeq_epi32(x, x);
+            if (clip) {
+                inside = _mm256_and_si256(
+                    _mm256_andnot_si256(_mm256_cmpgt_epi32(cx, x), _mm256_cmpgt_epi32(cr, x)),
+                    _mm256_andnot_si256(_mm256_cmpgt_epi32(cy, y), _mm256_cmpgt_epi32(cb, y)));
+            }
+            min_x = _mm256_min_epi32(min_x, _mm256_blendv_epi8(highest, x, inside));
+            min_y = _mm256_min_epi32(min_y, _mm256_blendv_epi8(highest, y, inside));
+            max_x = _mm256_max_epi32(max_x, _mm256_blendv_epi8(lowest, x, inside));
+            max_y = _mm256_max_epi32(max_y, _mm256_blendv_epi8(lowest, y, inside));
+            found = _mm256_or_si256(found, inside);
+        }
+
+        alignas(32) int values[4][8];
+        _mm256_store_si256((__m256i *) values[0], min_x);
+        _mm256_store_si256((__m256i *) values[1], min_y);
+        _mm256_store_si256((__m256i *) values[2], max_x);
+        _mm256_store_si256((__m256i *) values[3], max_y);
+        reduce(values, _mm256_movemask_epi8(found) != 0, e);
+        return i;
+    }
+
+    SPACETHEORY_TARGET_AVX2 size_t query_avx2(const point_columns& p, const rectangle& area, std::vector<uint32_t>& hits)
+    {
+        const __m256i ax = _mm256_set1_epi32(area.x), ay = _mm256_set1_epi32(area.y);
+        const __m256i ar = _mm256_set1_epi32(area.right()), ab = _mm256_set1_epi32(area.bottom());
+        size_t i = 0;
+        for (; i + 8 <= p.count; i += 8) {
+            const __m256i x = load8(p.x + i), y = load8(p.y + i);
+            const __m256i inside = _mm256_and_si256(
+                _mm256_andnot_si256(_mm256_cmpgt_epi32(ax, x), _mm256_cmpgt_epi32(ar, x)),
+                _mm256_andnot_si256(_mm256_cmpgt_epi32(ay, y), _mm256_cmpgt_epi32(ab, y)));
+            push_hits((unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(inside)), i, hits);
+        }
+        return i;
+    }
+#endif
+
+}
+
+// ----------------------------------------------------------------------------
+// POINT BATCH
+// ----------------------------------------------------------------------------
+
+void point_batch::reserve(const size_t count)
+{
+    m_x.reserve(count);
+    m_y.reserve(count);
+}
+
+void point_batch::clear()
+{
+    m_x.clear();
+    m_y.clear();
+}
+
+size_t point_batch::add(const point& pt)
+{
+    m_x.push_back(pt.x);
+    m_y.push_back(pt.y);
+    return m_x.size() - 1;
+}
+
+void point_batch::add(const point * points, const size_t count)
+{
+    reserve(size() + count);
+    for (size_t i = 0; i < count; ++i) add(points[i]);
+}
+
+void point_batch::set(const size_t index, const point& pt)
+{
+    m_x[index] = pt.x;
+    m_y[index] = pt.y;
+}
+
+point point_batch::get(const size_t index) const
+{
+    return point(m_x[index], m_y[index]);
+}
+
+void point_batch::remove(const size_t index)
+{
+    const size_t last = size() - 1;
+    if (index != last) set(index, get(last));
+    m_x.pop_back();
+    m_y.pop_back();
+}
+
+void point_batch::offset(const int x, const int y)
+{
+    const point_columns p = { m_x.data(), m_y.data(), size() };
+    size_t done = 0;
+#if SPACETHEORY_SIMD_X86
+    done = cpu_features::get().avx2 ? offset_avx2(p, x, y) : offset_sse2(p, x, y);
+#endif
+    offset_scalar(p, done, x, y);
+}
+
+bool point_batch::bounds(rectangle& result, const rectangle * clip) const
+{
+    if (empty() || (clip && clip->empty())) return false;
+
+    const point_columns p = { (int *) m_x.data(), (int *) m_y.data(), size() };
+    extent e;
+    size_t done = 0;
+#if SPACETHEORY_SIMD_X86
+    done = cpu_features::get().avx2 ? extent_avx2(p, clip, e) : extent_sse2(p, clip, e);
+#endif
+    extent_scalar(p, done, clip, e);
+    if (!e.found) return false;
+
+    result.set(e.min_x, e.min_y, (e.max_x - e.min_x) + 1, (e.max_y - e.min_y) + 1);
+    return true;
+}
+
+size_t point_batch::query(const rectangle& area, std::vector<uint32_t>& hits) const
+{
+    const point_columns p = { (int *) m_x.data(), (int *) m_y.data(), size() };
+    const size_t before = hits.size();
+    size_t done = 0;
+#if SPACETHEORY_SIMD_X86
+    done = cpu_features::get().avx2 ? query_avx2(p, area, hits) : query_sse2(p, area, hits);
+#endif
+    query_scalar(p, done, area, hits);
+    return hits.size() - before;
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "rectangle.h"
+
+namespace spacetheory {
+
+    // Many points stored as a structure of arrays, the point counterpart of
+    // rect_batch: bulk operations run on SSE2 or AVX2 where available and give
+    // the same results as doing them one point at a time.
+    class point_batch {
+    private:
+        std::vector<int> m_x, m_y;
+
+    public:
+        inline size_t size() const { return m_x.size(); }
+        inline bool empty() const { return m_x.empty(); }
+        void reserve(const size_t count);
+        void clear();
+
+        size_t add(const point& pt); // Returns its index
+        void add(const point * points, const size_t count);
+        void set(const size_t index, const point& pt);
+        point get(const size_t index) const;
+        // Moves the last point into its place:
+        void remove(const size_t index);
+
+        inline const int * x() const { return m_x.data(); }
+        inline const int * y() const { return m_y.data(); }
+
+        // point::offset on every point:
+        void offset(const int x, const int y);
+
+        // Smallest rectangle enclosing every point, or every point inside clip,
+        // like rectangle::enclose_points (so 1 wide for a single point). False
+        // if no point counts:
+        bool bounds(rectangle& result, const rectangle * clip = nullptr) const;
+
+        // Appends the indices of the points the area contains, returns how many:
+        size_t query(const rectangle& area, std::vector<uint32_t>& hits) const;
+    };
+
+}
\ No newline at end of file
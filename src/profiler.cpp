@@ -0,0 +1,343 @@
+#include "profiler.h"
+#include <SDL.h>
+#include <glad\glad.h>
+#include <rapidjson\writer.h>
+#include <rapidjson\stringbuffer.h>
+#include <fstream>
+#include <algorithm>
+#include "tools.h"
+
+using namespace spacetheory;
+
+spacetheory::profiler * spacetheory::profiler::s_current = nullptr;
+const size_t spacetheory::profiler::max_frames;
+const size_t spacetheory::profiler::max_events;
+const size_t spacetheory::profiler::max_gpu_events;
+const size_t spacetheory::profiler::gpu_latency;
+const uint32_t spacetheory::profiler::invalid_event;
+
+static thread_local uint16_t cpu_depth = 0;
+static const uint32_t frame_lane = 0xFFFFFFFF; // thread_id used for whole-frame events in snapshots
+static const uint64_t gpu_calibrate_interval = 600; // frames
+
+profiler::profiler()
+    : m_frames(max_frames), m_frame_number(0), m_dropped_events(0), m_epoch(0),
+    m_gpu_enabled(false), m_gpu_frame(0), m_gpu_depth(0), m_gpu_offset_ns(0), m_gpu_calibrated_frame(0)
+{
+    for (auto& f : m_frames) {
+        f.number.store(0, std::memory_order_relaxed);
+        f.start_ns = 0;
+        f.end_ns.store(0, std::memory_order_relaxed);
+        f.event_count.store(0, std::memory_order_relaxed);
+    }
+
+    m_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(tools::clock::now().time_since_epoch()).count();
+    if (!s_current) s_current = this;
+}
+
+profiler::~profiler()
+{
+    if (s_current == this) s_current = nullptr;
+}
+
+uint32_t profiler::thread_id()
+{
+    // Small sequential ids read better in a trace than hashed std::thread::ids,
+    // 0 is reserved for the gpu lane:
+    static std::atomic<uint32_t> next_id(1);
+    static thread_local uint32_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+uint64_t profiler::now_ns() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(tools::clock::now().time_since_epoch()).count() - m_epoch;
+}
+
+uint32_t profiler::reserve_event(frame& f, const char * name, uint64_t start_ns, uint32_t thread_id, uint16_t depth)
+{
+    const uint32_t index = f.event_count.fetch_add(1, std::memory_order_relaxed);
+    if (index >= max_events) {
+        m_dropped_events.fetch_add(1, std::memory_order_relaxed);
+        return invalid_event;
+    }
+
+    // The slot is only published by storing its name last, a reader seeing
+    // event_count go past it could otherwise copy half written fields:
+    event& e = f.events[index];
+    e.name.store(nullptr, std::memory_order_relaxed);
+    e.end_ns.store(0, std::memory_order_relaxed);
+    e.start_ns = start_ns;
+    e.thread_id = thread_id;
+    e.depth = depth;
+    e.name.store(name, std::memory_order_release);
+    return index;
+}
+
+void profiler::begin_frame()
+{
+    const uint64_t n = m_frame_number.load(std::memory_order_relaxed) + 1;
+
+    // RECYCLE THE OLDEST FRAME:
+    // The number is cleared first so a reader copying it notices the change.
+    frame& f = m_frames[n % max_frames];
+    f.number.store(0, std::memory_order_release);
+    f.event_count.store(0, std::memory_order_relaxed);
+    f.end_ns.store(0, std::memory_order_relaxed);
+    f.start_ns = now_ns();
+    f.number.store(n, std::memory_order_release);
+    m_frame_number.store(n, std::memory_order_release);
+}
+
+void profiler::begin_gpu_frame()
+{
+    if (!m_gpu_enabled) return;
+
+    // GPU QUERIES:
+    // The slot this frame will use was last used gpu_latency + 1 frames ago,
+    // so its results are read back just before it's reused. With a render
+    // thread the frame is whichever one the main thread is on by now.
+    const uint64_t n = frame_number();
+    if (n == m_gpu_frame) return;
+    m_gpu_frame = n;
+
+    const size_t slot_index = n % (gpu_latency + 1);
+    gpu_slot& slot = m_gpu_slots[slot_index];
+    collect_gpu(slot, slot_index);
+    slot.frame = n;
+    slot.count = 0;
+    m_gpu_depth = 0;
+
+    if (n - m_gpu_calibrated_frame >= gpu_calibrate_interval) calibrate_gpu();
+}
+
+void profiler::end_frame()
+{
+    current_frame().end_ns.store(now_ns(), std::memory_order_release);
+}
+
+uint32_t profiler::begin_event(const char * name, uint64_t& frame_number)
+{
+    // The frame number is read once, with a render thread the main thread can
+    // start the next frame at any time and end_event has to find this one:
+    frame_number = m_frame_number.load(std::memory_order_acquire);
+    const uint32_t index = reserve_event(m_frames[frame_number % max_frames], name, now_ns(), thread_id(), cpu_depth);
+    cpu_depth++;
+    return index;
+}
+
+void profiler::end_event(const uint64_t frame_number, const uint32_t event)
+{
+    cpu_depth--;
+    if (event == invalid_event) return;
+
+    frame& f = m_frames[frame_number % max_frames];
+    if (f.number.load(std::memory_order_acquire) == frame_number) {
+        f.events[event].end_ns.store(now_ns(), std::memory_order_release);
+    }
+}
+
+profiler::scope::scope(const char * name) : m_frame(0), m_event(invalid_event)
+{
+    profiler * p = profiler::current();
+    if (p) m_event = p->begin_event(name, m_frame);
+}
+
+profiler::scope::~scope()
+{
+    profiler * p = profiler::current();
+    if (p) p->end_event(m_frame, m_event);
+}
+
+void profiler::init_gpu()
+{
+    // Timestamp queries are core in GL 3.3, otherwise ARB_timer_query:
+    if (!GLAD_GL_ARB_timer_query && (GLVersion.major < 3 || (GLVersion.major == 3 && GLVersion.minor < 3))) {
+        m_gpu_enabled = false;
+        return;
+    }
+
+    m_gpu_query_objects.resize((gpu_latency + 1) * max_gpu_events * 2);
+    glGenQueries((GLsizei) m_gpu_query_objects.size(), m_gpu_query_objects.data());
+    for (auto& slot : m_gpu_slots) {
+        slot.frame = 0;
+        slot.count = 0;
+    }
+
+    calibrate_gpu();
+    m_gpu_enabled = true;
+}
+
+void profiler::shutdown_gpu()
+{
+    if (!m_gpu_query_objects.empty()) {
+        glDeleteQueries((GLsizei) m_gpu_query_objects.size(), m_gpu_query_objects.data());
+        m_gpu_query_objects.clear();
+    }
+    m_gpu_enabled = false;
+}
+
+void profiler::calibrate_gpu()
+{
+    // GPU timestamps have their own epoch. Reading the current one is a glGet,
+    // so the offset is only refreshed every so often to follow clock drift.
+    GLint64 gpu_now = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+    m_gpu_offset_ns = (int64_t) now_ns() - (int64_t) gpu_now;
+    m_gpu_calibrated_frame = frame_number();
+}
+
+uint32_t profiler::begin_gpu_event(const char * name)
+{
+    if (!m_gpu_enabled) return invalid_event;
+
+    const size_t slot_index = m_gpu_frame % (gpu_latency + 1);
+    gpu_slot& slot = m_gpu_slots[slot_index];
+    if (slot.frame != m_gpu_frame || slot.count >= max_gpu_events) {
+        m_dropped_events.fetch_add(1, std::memory_order_relaxed);
+        return invalid_event;
+    }
+
+    const size_t index = slot.count++;
+    slot.queries[index].name = name;
+    slot.queries[index].depth = m_gpu_depth++;
+    slot.queries[index].ended = false;
+    glQueryCounter(m_gpu_query_objects[(slot_index * max_gpu_events + index) * 2], GL_TIMESTAMP);
+
+    return (uint32_t) (slot_index * max_gpu_events + index);
+}
+
+void profiler::end_gpu_event(const uint32_t event)
+{
+    if (!m_gpu_enabled || event == invalid_event) return;
+
+    gpu_query& q = m_gpu_slots[event / max_gpu_events].queries[event % max_gpu_events];
+    q.ended = true;
+    if (m_gpu_depth) m_gpu_depth--;
+    glQueryCounter(m_gpu_query_objects[event * 2 + 1], GL_TIMESTAMP);
+}
+
+void profiler::collect_gpu(gpu_slot& slot, const size_t slot_index)
+{
+    if (slot.frame == 0) return;
+
+    frame& f = m_frames[slot.frame % max_frames];
+    const bool frame_in_ring = f.number.load(std::memory_order_acquire) == slot.frame;
+
+    for (size_t i = 0; i < slot.count; ++i) {
+        const gpu_query& q = slot.queries[i];
+        const GLuint begin_query = m_gpu_query_objects[(slot_index * max_gpu_events + i) * 2];
+        const GLuint end_query = m_gpu_query_objects[(slot_index * max_gpu_events + i) * 2 + 1];
+
+        // Never wait on a result; if the gpu is that far behind the event is
+        // counted as dropped instead:
+        GLint available = GL_FALSE;
+        if (q.ended) glGetQueryObjectiv(end_query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available || !frame_in_ring) {
+            m_dropped_events.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        GLuint64 gpu_begin = 0, gpu_end = 0;
+        glGetQueryObjectui64v(begin_query, GL_QUERY_RESULT, &gpu_begin);
+        glGetQueryObjectui64v(end_query, GL_QUERY_RESULT, &gpu_end);
+
+        const uint64_t begin_ns = (uint64_t) std::max<int64_t>((int64_t) gpu_begin + m_gpu_offset_ns, 0);
+        const uint64_t end_ns = (uint64_t) std::max<int64_t>((int64_t) gpu_end + m_gpu_offset_ns, (int64_t) begin_ns + 1);
+        const uint32_t index = reserve_event(f, q.name, begin_ns, 0, q.depth);
+        if (index != invalid_event) f.events[index].end_ns.store(end_ns, std::memory_order_release);
+    }
+}
+
+std::vector<profiler::event_record> profiler::snapshot() const
+{
+    std::vector<event_record> result;
+    std::vector<event_record> frame_records;
+    const uint64_t current = frame_number();
+    const uint64_t oldest = current > max_frames ? current - max_frames + 1 : 1;
+
+    for (uint64_t n = oldest; n <= current; ++n) {
+        const frame& f = m_frames[n % max_frames];
+        if (f.number.load(std::memory_order_acquire) != n) continue;
+
+        frame_records.clear();
+        const uint64_t frame_end = f.end_ns.load(std::memory_order_acquire);
+        if (frame_end) frame_records.push_back({ "frame", n, f.start_ns, frame_end, frame_lane, 0 });
+
+        const uint32_t count = std::min<uint32_t>(f.event_count.load(std::memory_order_acquire), max_events);
+        for (uint32_t i = 0; i < count; ++i) {
+            const event& e = f.events[i];
+            const char * name = e.name.load(std::memory_order_acquire);
+            if (!name) continue; // Reserved but not written yet
+            const uint64_t end_ns = e.end_ns.load(std::memory_order_acquire);
+            if (end_ns == 0) continue; // Still open
+            frame_records.push_back({ name, n, e.start_ns, end_ns, e.thread_id, e.depth });
+        }
+
+        // Only keep the copy if the frame wasn't recycled while it was read:
+        if (f.number.load(std::memory_order_acquire) == n) {
+            result.insert(result.end(), frame_records.begin(), frame_records.end());
+        }
+    }
+
+    return result;
+}
+
+bool profiler::export_chrome_trace(const std::string& file) const
+{
+    const std::vector<event_record> events = snapshot();
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+    writer.StartObject();
+    writer.Key("displayTimeUnit");
+    writer.String("ms");
+    writer.Key("traceEvents");
+    writer.StartArray();
+
+    // LANE NAMES:
+    std::vector<uint32_t> threads;
+    for (const auto& e : events) {
+        if (std::find(threads.begin(), threads.end(), e.thread_id) == threads.end()) threads.push_back(e.thread_id);
+    }
+    for (const auto& t : threads) {
+        const std::string name = t == 0 ? "GPU" : t == frame_lane ? "Frames" : "Thread " + std::to_string(t);
+        writer.StartObject();
+        writer.Key("name"); writer.String("thread_name");
+        writer.Key("ph"); writer.String("M");
+        writer.Key("pid"); writer.Uint(1);
+        writer.Key("tid"); writer.Uint(t);
+        writer.Key("args");
+        writer.StartObject();
+        writer.Key("name"); writer.String(name.c_str());
+        writer.EndObject();
+        writer.EndObject();
+    }
+
+    // COMPLETE EVENTS:
+    // Timestamps are in microseconds.
+    for (const auto& e : events) {
+        writer.StartObject();
+        writer.Key("name"); writer.String(e.name);
+        writer.Key("cat"); writer.String(e.thread_id == 0 ? "gpu" : "cpu");
+        writer.Key("ph"); writer.String("X");
+        writer.Key("ts"); writer.Double(e.start_ns / 1000.0);
+        writer.Key("dur"); writer.Double((e.end_ns - e.start_ns) / 1000.0);
+        writer.Key("pid"); writer.Uint(1);
+        writer.Key("tid"); writer.Uint(e.thread_id);
+        writer.Key("args");
+        writer.StartObject();
+        writer.Key("frame"); writer.Uint64(e.frame);
+        writer.EndObject();
+        writer.EndObject();
+    }
+
+    writer.EndArray();
+    writer.EndObject();
+
+    std::ofstream out(file, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    out.write(buffer.GetString(), buffer.GetSize());
+    return out.good();
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#define SPACETHEORY_PROFILE_CONCAT2(a, b) a##b
+#define SPACETHEORY_PROFILE_CONCAT(a, b) SPACETHEORY_PROFILE_CONCAT2(a, b)
+
+// Times the rest of the enclosing block, name must be a string literal:
+#define SPACETHEORY_PROFILE_SCOPE(name) spacetheory::profiler::scope SPACETHEORY_PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+
+namespace spacetheory {
+
+    class application;
+
+    class profiler
+    {
+        friend spacetheory::application;
+    public:
+        static const size_t max_frames = 64;        // frames of history kept in the ring
+        static const size_t max_events = 512;       // cpu + gpu events per frame
+        static const size_t max_gpu_events = 32;    // gpu events per frame
+        static const size_t gpu_latency = 3;        // frames before gpu results are read back
+        static const uint32_t invalid_event = 0xFFFFFFFF;
+
+        struct event {
+            std::atomic<const char *> name; // null until the other fields are written
+            uint64_t start_ns;
+            std::atomic<uint64_t> end_ns; // 0 until the event is complete
+            uint32_t thread_id; // 0 is the gpu
+            uint16_t depth;
+        };
+
+        struct frame {
+            std::atomic<uint64_t> number;
+            uint64_t start_ns;
+            std::atomic<uint64_t> end_ns;
+            std::atomic<uint32_t> event_count;
+            event events[max_events];
+        };
+
+        // Copy of a completed event, returned by snapshot():
+        struct event_record {
+            const char * name;
+            uint64_t frame;
+            uint64_t start_ns, end_ns;
+            uint32_t thread_id;
+            uint16_t depth;
+        };
+
+        class scope {
+            // Times its own lifetime as a cpu event of the current frame.
+        private:
+            uint64_t m_frame;
+            uint32_t m_event;
+        public:
+            explicit scope(const char * name);
+            ~scope();
+            scope(const scope&) = delete;
+            scope& operator=(const scope&) = delete;
+        };
+
+    private:
+        static profiler * s_current;
+
+        // The ring is written without locks: event slots are reserved with an
+        // atomic counter, and readers validate a frame's number before and after
+        // copying it so a frame recycled mid-copy is discarded.
+        std::vector<frame> m_frames;
+        std::atomic<uint64_t> m_frame_number;
+        std::atomic<uint64_t> m_dropped_events;
+        uint64_t m_epoch;
+
+        struct gpu_query {
+            const char * name;
+            uint16_t depth;
+            bool ended;
+        };
+        struct gpu_slot {
+            uint64_t frame = 0;
+            size_t count = 0;
+            gpu_query queries[max_gpu_events];
+        };
+        bool m_gpu_enabled;
+        std::vector<uint32_t> m_gpu_query_objects; // begin/end timestamp pairs per slot
+        gpu_slot m_gpu_slots[gpu_latency + 1];
+        uint64_t m_gpu_frame; // Frame the gpu events are going to
+        uint16_t m_gpu_depth;
+        int64_t m_gpu_offset_ns; // gpu timestamp to profiler time
+        uint64_t m_gpu_calibrated_frame;
+
+        frame& current_frame() { return m_frames[m_frame_number.load(std::memory_order_relaxed) % max_frames]; }
+        uint32_t reserve_event(frame& f, const char * name, uint64_t start_ns, uint32_t thread_id, uint16_t depth);
+
+        void init_gpu(); // called by the application once the gl context exists
+        void shutdown_gpu();
+        void calibrate_gpu();
+        void collect_gpu(gpu_slot& slot, const size_t slot_index);
+
+        void begin_frame();
+        void end_frame();
+        void begin_gpu_frame(); // On the thread owning the gl context, after begin_frame
+
+    public:
+        profiler();
+        ~profiler();
+        profiler(const profiler&) = delete;
+        profiler& operator=(const profiler&) = delete;
+
+        static profiler * current() { return s_current; }
+        static uint32_t thread_id();
+
+        uint64_t now_ns() const;
+        uint64_t frame_number() const { return m_frame_number.load(std::memory_order_acquire); }
+        uint64_t dropped_events() const { return m_dropped_events.load(std::memory_order_relaxed); }
+
+        // Reserves the event in the current frame and returns that frame's
+        // number too, which is what end_event needs to be given back:
+        uint32_t begin_event(const char * name, uint64_t& frame_number);
+        void end_event(const uint64_t frame_number, const uint32_t event);
+
+        // GL timestamp queries, only call these from the thread owning the gl
+        // context. Results show up in the frame they were issued in (with a
+        // render thread, the main thread's frame at the time), but only after
+        // gpu_latency frames so reading them never stalls the pipeline.
+        uint32_t begin_gpu_event(const char * name);
+        void end_gpu_event(const uint32_t event);
+
+        // Completed events of the frames still in the ring, oldest first:
+        std::vector<event_record> snapshot() const;
+        // Chrome's about:tracing / Perfetto JSON format:
+        bool export_chrome_trace(const std::string& file) const;
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,385 @@
+#include "quad_batch.h"
+#include <glad\glad.h>
+#include "gl_state_cache.h"
+#include "error.h"
+#include <string>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+using namespace spacetheory;
+
+static const char * quad_vertex_shader = R"glsl(
+#version 330 core
+layout(location = 0) in vec4 a_rect;
+layout(location = 1) in vec4 a_radius;
+layout(location = 2) in vec4 a_fill;
+layout(location = 3) in vec4 a_border;
+layout(location = 4) in vec2 a_params;
+
+uniform vec2 u_view_size;
+uniform bool u_linear;
+
+// Colors are given sRGB encoded, targets that blend in linear space get them
+// decoded:
+vec3 decode_srgb(vec3 c)
+{
+    return mix(c / 12.92, pow((c + 0.055) / 1.055, vec3(2.4)), step(vec3(0.04045), c));
+}
+
+out vec2 v_local;
+flat out vec2 v_half_size;
+flat out vec4 v_radius;
+flat out vec4 v_fill;
+flat out vec4 v_border;
+flat out vec2 v_params;
+
+void main()
+{
+    // Triangle strip corners generated from the vertex id, no vertex buffer:
+    vec2 corner = vec2(float(gl_VertexID & 1), float((gl_VertexID >> 1) & 1));
+
+    // Grow the quad so the outer half of the border and the antialiased
+    // fringe are not clipped:
+    float grow = a_params.x * 0.5 + 1.0;
+    vec2 half_size = a_rect.zw * 0.5;
+    vec2 center = a_rect.xy + half_size;
+    vec2 local = (corner * 2.0 - 1.0) * (half_size + grow);
+    vec2 pos = center + local;
+
+    v_local = local;
+    v_half_size = half_size;
+    v_radius = a_radius;
+    vec3 fill = u_linear ? decode_srgb(a_fill.rgb) : a_fill.rgb;
+    vec3 border = u_linear ? decode_srgb(a_border.rgb) : a_border.rgb;
+    v_fill = vec4(fill * a_fill.a, a_fill.a);
+    v_border = vec4(border * a_border.a, a_border.a);
+    v_params = a_params;
+
+    gl_Position = vec4(pos.x / u_view_size.x * 2.0 - 1.0, 1.0 - pos.y / u_view_size.y * 2.0, 0.0, 1.0);
+}
+)glsl";
+
+static const char * quad_fragment_shader = R"glsl(
+#version 330 core
+in vec2 v_local;
+flat in vec2 v_half_size;
+flat in vec4 v_radius;
+flat in vec4 v_fill;
+flat in vec4 v_border;
+flat in vec2 v_params;
+
+out vec4 out_color;
+
+void main()
+{
+    // Pick the radius of the corner this fragment is nearest to (y is down):
+    float r = (v_local.x < 0.0)
+        ? ((v_local.y < 0.0) ? v_radius.x : v_radius.w)
+        : ((v_local.y < 0.0) ? v_radius.y : v_radius.z);
+
+    // Signed distance to the edge, negative inside. Square corners use the
+    // max() metric so the outside of a border keeps NanoVG's miter joins:
+    vec2 q = abs(v_local) - v_half_size + r;
+    float d = (r > 0.0)
+        ? min(max(q.x, q.y), 0.0) + length(max(q, 0.0)) - r
+        : max(q.x, q.y);
+
+    // The border is centered on the edge:
+    float border_width = v_params.x;
+    float fill_coverage = clamp(0.5 - d, 0.0, 1.0);
+    float border_coverage = clamp(border_width * 0.5 - abs(d) + 0.5, 0.0, 1.0);
+    if (border_width <= 0.0) border_coverage = 0.0;
+
+    // Premultiplied alpha:
+    vec4 border = v_border * border_coverage;
+    vec4 fill = v_fill * fill_coverage;
+    if (v_params.y > 0.5) out_color = border + fill * (1.0 - border.a);
+    else out_color = fill + border * (1.0 - fill.a);
+}
+)glsl";
+
+quad_batch::quad_batch(const size_t capacity, const bool linear)
+    : m_capacity(capacity), m_linear(linear), m_view_width(1.0f), m_view_height(1.0f), m_scissor(false), m_scissor_rect(),
+    m_program(0), m_vao(0), m_vbo(0), m_view_size_location(-1), m_linear_location(-1),
+    m_mapped(nullptr), m_fences(), m_section(0), m_section_used(0)
+{
+    m_instances.reserve(m_capacity);
+
+    // COMPILE AND LINK THE SHADER PROGRAM:
+    GLuint vs = compile_shader(GL_VERTEX_SHADER, quad_vertex_shader);
+    GLuint fs = compile_shader(GL_FRAGMENT_SHADER, quad_fragment_shader);
+    m_program = glCreateProgram();
+    glAttachShader(m_program, vs);
+    glAttachShader(m_program, fs);
+    glLinkProgram(m_program);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(m_program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        char log[512] = {};
+        glGetProgramInfoLog(m_program, sizeof(log), NULL, log);
+        glDeleteProgram(m_program);
+        throw spacetheory::error("Failed to link quad batch shader: " + std::string(log));
+    }
+    m_view_size_location = glGetUniformLocation(m_program, "u_view_size");
+    m_linear_location = glGetUniformLocation(m_program, "u_linear");
+
+    // INSTANCE BUFFER:
+    // One attribute set per quad, advanced once per instance.
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_vbo);
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    if (GLAD_GL_ARB_buffer_storage) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const GLsizeiptr bytes = ring_sections * m_capacity * sizeof(instance);
+        glBufferStorage(GL_ARRAY_BUFFER, bytes, NULL, flags);
+        m_mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags);
+    }
+    if (!m_mapped) {
+        glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(instance), NULL, GL_STREAM_DRAW);
+    }
+
+    for (GLuint i = 0; i < 5; ++i) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisorARB(i, 1);
+    }
+    bind_instances(0);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+quad_batch::~quad_batch()
+{
+    for (size_t i = 0; i < ring_sections; ++i) {
+        if (m_fences[i]) glDeleteSync((GLsync) m_fences[i]);
+    }
+    if (m_mapped) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    if (m_vbo) glDeleteBuffers(1, &m_vbo);
+    if (m_vao) glDeleteVertexArrays(1, &m_vao);
+    if (m_program) {
+        // Left in use by the last flush:
+        gl_state_cache::active().use_program(0);
+        glDeleteProgram(m_program);
+    }
+}
+
+uint32_t quad_batch::compile_shader(uint32_t type, const char * source)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (compiled != GL_TRUE) {
+        char log[512] = {};
+        glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+        glDeleteShader(shader);
+        throw spacetheory::error("Failed to compile quad batch shader: " + std::string(log));
+    }
+
+    return shader;
+}
+
+void quad_batch::bind_instances(const size_t first)
+{
+    // Attribute pointers are offset to the first instance instead of using a
+    // base instance, which needs GL 4.2:
+    const GLsizei stride = sizeof(instance);
+    const size_t base = first * sizeof(instance);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, (const void *)(base + offsetof(instance, rect)));
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (const void *)(base + offsetof(instance, radius)));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (const void *)(base + offsetof(instance, fill)));
+    glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (const void *)(base + offsetof(instance, border)));
+    glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, stride, (const void *)(base + offsetof(instance, border_width)));
+}
+
+void quad_batch::next_section()
+{
+    // Fence the draws reading the section being left, then wait for the GPU to
+    // finish with the next one before it gets overwritten. With three sections
+    // this wait is almost never more than a formality.
+    m_fences[m_section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_section = (m_section + 1) % ring_sections;
+    m_section_used = 0;
+
+    GLsync fence = (GLsync) m_fences[m_section];
+    if (fence) {
+        const GLenum waited = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, fence_timeout_ns);
+        glDeleteSync(fence);
+        m_fences[m_section] = nullptr;
+        if (waited == GL_TIMEOUT_EXPIRED || waited == GL_WAIT_FAILED) stream_instances();
+    }
+}
+
+void quad_batch::stream_instances()
+{
+    // A GPU that's this far behind (or a fence that failed) would stall every
+    // section from now on, so the ring is given up for an ordinary buffer that
+    // is orphaned every flush. Draws still reading the old buffer keep it
+    // alive until they're done. Expects the buffer to be bound, as in flush().
+    for (size_t i = 0; i < ring_sections; ++i) {
+        if (m_fences[i]) glDeleteSync((GLsync) m_fences[i]);
+        m_fences[i] = nullptr;
+    }
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    glDeleteBuffers(1, &m_vbo);
+    m_mapped = nullptr;
+    m_section = m_section_used = 0;
+
+    glGenBuffers(1, &m_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(instance), NULL, GL_STREAM_DRAW);
+}
+
+void quad_batch::begin(const float view_width, const float view_height)
+{
+    m_instances.clear();
+    m_view_width = view_width;
+    m_view_height = view_height;
+    m_scissor = false;
+}
+
+void quad_batch::set_scissor(const float x, const float y, const float w, const float h)
+{
+    flush();
+    m_scissor = true;
+    m_scissor_rect[0] = x;
+    m_scissor_rect[1] = y;
+    m_scissor_rect[2] = w;
+    m_scissor_rect[3] = h;
+}
+
+void quad_batch::reset_scissor()
+{
+    flush();
+    m_scissor = false;
+}
+
+void quad_batch::add(const float x, const float y, const float w, const float h, const float border_width, const color& border_color, const color& fill_color)
+{
+    instance i;
+    i.rect[0] = x;
+    i.rect[1] = y;
+    i.rect[2] = w;
+    i.rect[3] = h;
+    i.radius[0] = i.radius[1] = i.radius[2] = i.radius[3] = 0.0f;
+    i.fill[0] = fill_color.r;
+    i.fill[1] = fill_color.g;
+    i.fill[2] = fill_color.b;
+    i.fill[3] = fill_color.a;
+    i.border[0] = border_color.r;
+    i.border[1] = border_color.g;
+    i.border[2] = border_color.b;
+    i.border[3] = border_color.a;
+    i.border_width = border_width;
+    i.border_over_fill = 0.0f;
+    push(i);
+}
+
+void quad_batch::add(const float x, const float y, const float w, const float h, const corner_radius& radius, const float border_width, const color& border_color, const color& fill_color)
+{
+    // Radii are clamped to half the shortest side, as nvgRoundedRectVarying does:
+    const float max_radius = std::min(w, h) * 0.5f;
+
+    instance i;
+    i.rect[0] = x;
+    i.rect[1] = y;
+    i.rect[2] = w;
+    i.rect[3] = h;
+    i.radius[0] = std::min(std::max(radius.topleft(), 0.0f), max_radius);
+    i.radius[1] = std::min(std::max(radius.topright(), 0.0f), max_radius);
+    i.radius[2] = std::min(std::max(radius.bottomright(), 0.0f), max_radius);
+    i.radius[3] = std::min(std::max(radius.bottomleft(), 0.0f), max_radius);
+    i.fill[0] = fill_color.r;
+    i.fill[1] = fill_color.g;
+    i.fill[2] = fill_color.b;
+    i.fill[3] = fill_color.a;
+    i.border[0] = border_color.r;
+    i.border[1] = border_color.g;
+    i.border[2] = border_color.b;
+    i.border[3] = border_color.a;
+    i.border_width = border_width;
+    i.border_over_fill = 1.0f;
+    push(i);
+}
+
+void quad_batch::push(const instance& i)
+{
+    if (m_instances.size() >= m_capacity) flush();
+
+    m_instances.push_back(i);
+    m_stats.quads++;
+}
+
+void quad_batch::flush()
+{
+    if (m_instances.empty()) return;
+
+    const size_t count = m_instances.size();
+    size_t first = 0;
+
+    // UPLOAD INSTANCES:
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    if (m_mapped && m_section_used + count > m_capacity) next_section(); // May give the ring up
+    if (m_mapped) {
+        // Written straight into the mapped ring, no driver copy:
+        first = m_section * m_capacity + m_section_used;
+        std::memcpy((instance *) m_mapped + first, m_instances.data(), count * sizeof(instance));
+        m_section_used += count;
+    }
+    else {
+        // Orphan the buffer first so the driver can hand back fresh storage
+        // instead of waiting on draws still reading the previous contents.
+        glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(instance), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(instance), m_instances.data());
+    }
+    bind_instances(first);
+
+    // STATE:
+    // The fragment shader outputs premultiplied alpha, the same as NanoVG.
+    // Through the state cache, so a batch following another skips it all:
+    gl_state_cache& gl = gl_state_cache::active();
+    gl.enable_depth_test(false);
+    gl.enable_cull_face(false);
+    gl.enable_blend(true);
+    gl.blend_func(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    gl.use_program(m_program);
+    glUniform2f(m_view_size_location, m_view_width, m_view_height);
+    glUniform1i(m_linear_location, m_linear ? 1 : 0);
+
+    // SCISSOR:
+    // GL's origin is the bottom-left, NanoVG disables the test again when it
+    // renders so it's only left on for this draw.
+    if (m_scissor) {
+        gl.enable_scissor(true);
+        gl.scissor(
+            (int) m_scissor_rect[0],
+            (int) (m_view_height - m_scissor_rect[1] - m_scissor_rect[3]),
+            (int) m_scissor_rect[2],
+            (int) m_scissor_rect[3]
+        );
+    }
+
+    // DRAW ALL QUADS AT ONCE:
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei) count);
+    m_stats.draw_calls++;
+
+    if (m_scissor) gl.enable_scissor(false);
+
+    // The program stays in use for the next batch, the cache knows it is:
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_instances.clear();
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "color.h"
+#include "corner_radius.h"
+
+namespace spacetheory {
+
+    // Batches axis-aligned solid, bordered and rounded rectangles into a single
+    // instance buffer so that thousands of them cost one instanced draw call
+    // instead of a NanoVG path, tessellation and draw call each. Edges, rounded
+    // corners and borders come from a distance field evaluated per fragment,
+    // which also gives the antialiasing without any tessellation. When ARB_buffer_storage is
+    // available the buffer is persistently mapped and written as a ring of
+    // fenced sections, otherwise (or once the GPU falls so far behind that a
+    // section's fence times out) it's orphaned and streamed every flush.
+    class quad_batch {
+    public:
+        struct stats {
+            size_t quads = 0;       // Quads submitted since the last reset
+            size_t draw_calls = 0;  // Instanced draws issued since the last reset
+        };
+
+    private:
+        struct instance {
+            float rect[4];          // x, y, w, h in pixels
+            float radius[4];        // topleft, topright, bottomright, bottomleft
+            uint8_t fill[4];        // r, g, b, a
+            uint8_t border[4];      // r, g, b, a
+            float border_width;
+            float border_over_fill; // 1 paints the border over the fill, 0 under
+        };
+
+        std::vector<instance> m_instances;
+        size_t m_capacity;
+        bool m_linear;              // Decode sRGB colors, for targets blending in linear space
+        float m_view_width, m_view_height;
+        bool m_scissor;
+        float m_scissor_rect[4];    // x, y, w, h in pixels, top-left origin like the quads
+        stats m_stats;
+
+        uint32_t m_program;
+        uint32_t m_vao;
+        uint32_t m_vbo;
+        int32_t m_view_size_location;
+        int32_t m_linear_location;
+
+        static const size_t ring_sections = 3;
+        static const uint64_t fence_timeout_ns = 100000000; // Before giving the ring up for orphaning
+        void * m_mapped;                    // Persistently mapped buffer or nullptr
+        void * m_fences[ring_sections];     // GLsync per ring section
+        size_t m_section, m_section_used;
+
+        static uint32_t compile_shader(uint32_t type, const char * source);
+        void bind_instances(const size_t first);
+        void next_section();
+        void stream_instances();
+        void push(const instance& i);
+
+    public:
+        quad_batch(const size_t capacity = 16384, const bool linear = false);
+        quad_batch(const quad_batch&) = delete;
+        quad_batch& operator=(const quad_batch&) = delete;
+        ~quad_batch();
+
+        void begin(const float view_width, const float view_height);
+        // Square corners, the fill is painted over the inner half of the border
+        // like graphics2d::draw_rect does with NanoVG:
+        void add(const float x, const float y, const float w, const float h, const float border_width, const color& border_color, const color& fill_color);
+        // Rounded corners, the border is painted over the fill like
+        // graphics2d::draw_roundrect does with NanoVG:
+        void add(const float x, const float y, const float w, const float h, const corner_radius& radius, const float border_width, const color& border_color, const color& fill_color);
+        void flush();
+
+        // Quads are only drawn inside the rectangle until begin() or
+        // reset_scissor(). Changing it flushes what was queued under the old one:
+        void set_scissor(const float x, const float y, const float w, const float h);
+        void reset_scissor();
+
+        inline bool empty() const { return m_instances.empty(); }
+        inline const stats& get_stats() const { return m_stats; }
+        inline void reset_stats() { m_stats = stats(); }
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,404 @@
+#include "rect_batch.h"
+#include "cpu_features.h"
+#include <climits>
+#include <algorithm>
+#if SPACETHEORY_SIMD_X86
+#include <immintrin.h>
+#endif
+
+using namespace spacetheory;
+
+// ----------------------------------------------------------------------------
+// KERNELS
+// ----------------------------------------------------------------------------
+// Each processes [begin, count) and returns where it stopped, the scalar ones
+// finish whatever the vector ones leave over.
+
+namespace {
+
+    struct rect_columns {
+        int * x, * y, * w, * h;
+        size_t count;
+    };
+
+    struct bounds_state {
+        int min_x = INT_MAX, min_y = INT_MAX, max_right = INT_MIN, max_bottom = INT_MIN;
+        bool any = false;
+    };
+
+    // SCALAR:
+
+    void offset_scalar(rect_columns r, size_t i, const int dx, const int dy)
+    {
+        for (; i < r.count; ++i) {
+            r.x[i] += dx;
+            r.y[i] += dy;
+        }
+    }
+
+    void intersect_scalar(rect_columns r, size_t i, const rectangle& clip)
+    {
+        for (; i < r.count; ++i) {
+            const rectangle result = rectangle::intersect(rectangle(r.x[i], r.y[i], r.w[i], r.h[i]), clip);
+            r.x[i] = result.x;
+            r.y[i] = result.y;
+            r.w[i] = result.w;
+            r.h[i] = result.h;
+        }
+    }
+
+    void bounds_scalar(const rect_columns& r, size_t i, bounds_state& b)
+    {
+        for (; i < r.count; ++i) {
+            if (r.w[i] == 0 || r.h[i] == 0) continue;
+            b.min_x = std::min(b.min_x, r.x[i]);
+            b.min_y = std::min(b.min_y, r.y[i]);
+            b.max_right = std::max(b.max_right, r.x[i] + r.w[i]);
+            b.max_bottom = std::max(b.max_bottom, r.y[i] + r.h[i]);
+            b.any = true;
+        }
+    }
+
+    void query_area_scalar(const rect_columns& r, size_t i, const rectangle& area, std::vector<uint32_t>& hits)
+    {
+        for (; i < r.count; ++i) {
+            if (rectangle::has_intersection(area, rectangle(r.x[i], r.y[i], r.w[i], r.h[i]))) hits.push_back((uint32_t) i);
+        }
+    }
+
+    void query_point_scalar(const rect_columns& r, size_t i, const point& pt, std::vector<uint32_t>& hits)
+    {
+        for (; i < r.count; ++i) {
+            if (rectangle(r.x[i], r.y[i], r.w[i], r.h[i]).contains(pt)) hits.push_back((uint32_t) i);
+        }
+    }
+
+#if SPACETHEORY_SIMD_X86
+    // SSE2:
+    // No 32 bit min/max before SSE4.1, they're selected with compare masks.
+
+    inline __m128i load4(const int * p) { return _mm_loadu_si128((const __m128i *) p); }
+    inline void store4(int * p, const __m128i v) { _mm_storeu_si128((__m128i *) p, v); }
+    inline __m128i select4(const __m128i mask, const __m128i a, const __m128i b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+    inline __m128i max4(const __m128i a, const __m128i b) { return select4(_mm_cmpgt_epi32(a, b), a, b); }
+    inline __m128i min4(const __m128i a, const __m128i b) { return select4(_mm_cmpgt_epi32(a, b), b, a); }
+    inline unsigned mask4(const __m128i v) { return (unsigned) _mm_movemask_ps(_mm_castsi128_ps(v)); }
+
+    inline void push_hits(unsigned mask, const size_t base, std::vector<uint32_t>& hits)
+    {
+        while (mask) {
+            hits.push_back((uint32_t) (base + lowest_bit(mask)));
+            mask &= mask - 1;
+        }
+    }
+
+    size_t offset_sse2(rect_columns r, const int dx, const int dy)
+    {
+        const __m128i vdx = _mm_set1_epi32(dx), vdy = _mm_set1_epi32(dy);
+        size_t i = 0;
+        for (; i + 4 <= r.count; i += 4) {
+            store4(r.x + i, _mm_add_epi32(load4(r.x + i), vdx));
+            store4(r.y + i, _mm_add_epi32(load4(r.y + i), vdy));
+        }
+        return i;
+    }
+
+    size_t intersect_sse2(rect_columns r, const rectangle& clip)
+    {
+        const __m128i cx = _mm_set1_epi32(clip.x), cy = _mm_set1_epi32(clip.y);
+        const __m128i cr = _mm_set1_epi32(clip.x + clip.w), cb = _mm_set1_epi32(clip.y + clip.h);
+        size_t i = 0;
+        for (; i + 4 <= r.count; i += 4) {
+            const __m128i x = load4(r.x + i), y = load4(r.y + i);
+            const __m128i right = _mm_add_epi32(x, load4(r.w + i)), bottom = _mm_add_epi32(y, load4(r.h + i));
+            const __m128i nx = max4(x, cx), ny = max4(y, cy);
+            store4(r.x + i, nx);
+            store4(r.y + i, ny);
+            store4(r.w + i, _mm_sub_epi32(min4(right, cr), nx));
+            store4(r.h + i, _mm_sub_epi32(min4(bottom, cb), ny));
+        }
+        return i;
+    }
+
+    size_t bounds_sse2(const rect_columns& r, bounds_state& b)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i highest = _mm_set1_epi32(INT_MAX), lowest = _mm_set1_epi32(INT_MIN);
+        __m128i min_x = highest, min_y = highest, max_right = lowest, max_bottom = lowest, any = zero;
+        size_t i = 0;
+        for (; i + 4 <= r.count; i += 4) {
+            const __m128i x = load4(r.x + i), y = load4(r.y + i), w = load4(r.w + i), h = load4(r.h + i);
+            const __m128i empty = _mm_or_si128(_mm_cmpeq_epi32(w, zero), _mm_cmpeq_epi32(h, zero));
+            min_x = min4(min_x, select4(empty, highest, x));
+            min_y = min4(min_y, select4(empty, highest, y));
+            max_right = max4(max_right, select4(empty, lowest, _mm_add_epi32(x, w)));
+            max_bottom = max4(max_bottom, select4(empty, lowest, _mm_add_epi32(y, h)));
+            any = _mm_or_si128(any, _mm_andnot_si128(empty, _mm_cmpeq_epi32(zero, zero)));
+        }
+
+        // REDUCE THE LANES:
+        alignas(16) int lanes[4][4];
+        _mm_store_si128((__m128i *) lanes[0], min_x);
+        _mm_store_si128((__m128i *) lanes[1], min_y);
+        _mm_store_si128((__m128i *) lanes[2], max_right);
+        _mm_store_si128((__m128i *) lanes[3], max_bottom);
+        if (mask4(any)) {
+            for (int l = 0; l < 4; ++l) {
+                b.min_x = std::min(b.min_x, lanes[0][l]);
+                b.min_y = std::min(b.min_y, lanes[1][l]);
+                b.max_right = std::max(b.max_right, lanes[2][l]);
+                b.max_bottom = std::max(b.max_bottom, lanes[3][l]);
+            }
+            b.any = true;
+        }
+        return i;
+    }
+
+    size_t query_area_sse2(const rect_columns& r, const rectangle& area, std::vector<uint32_t>& hits)
+    {
+        const __m128i ax = _mm_set1_epi32(area.x), ay = _mm_set1_epi32(area.y);
+        const __m128i ar = _mm_set1_epi32(area.right()), ab = _mm_set1_epi32(area.bottom());
+        size_t i = 0;
+        for (; i + 4 <= r.count; i += 4) {
+            const __m128i x = load4(r.x + i), y = load4(r.y + i);
+            const __m128i right = _mm_add_epi32(x, load4(r.w + i)), bottom = _mm_add_epi32(y, load4(r.h + i));
+            const __m128i miss = _mm_or_si128(
+                _mm_or_si128(_mm_cmpgt_epi32(x, ar), _mm_cmpgt_epi32(ax, right)),
+                _mm_or_si128(_mm_cmpgt_epi32(y, ab), _mm_cmpgt_epi32(ay, bottom)));
+            push_hits(~mask4(miss) & 0xF, i, hits);
+        }
+        return i;
+    }
+
+    size_t query_point_sse2(const rect_columns& r, const point& pt, std::vector<uint32_t>& hits)
+    {
+        const __m128i px = _mm_set1_epi32(pt.x), py = _mm_set1_epi32(pt.y);
+        size_t i = 0;
+        for (; i + 4 <= r.count; i += 4) {
+            const __m128i x = load4(r.x + i), y = load4(r.y + i);
+            const __m128i right = _mm_add_epi32(x, load4(r.w + i)), bottom = _mm_add_epi32(y, load4(r.h + i));
+            const __m128i inside = _mm_and_si128(
+                _mm_andnot_si128(_mm_cmpgt_epi32(x, px), _mm_cmpgt_epi32(right, px)),
+                _mm_andnot_si128(_mm_cmpgt_epi32(y, py), _mm_cmpgt_epi32(bottom, py)));
+            push_hits(mask4(inside), i, hits);
+        }
+        return i;
+    }
+
+    // AVX2:
+
+    SPACETHEORY_TARGET_AVX2 inline __m256i load8(const int * p) { return _mm256_loadu_si256((const __m256i *) p); }
+    SPACETHEORY_TARGET_AVX2 inline void store8(int * p, const __m256i v) { _mm256_storeu_si256((__m256i *) p, v); }
+    SPACETHEORY_TARGET_AVX2 inline unsigned mask8(const __m256i v) { return (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(v)); }
+
+    SPACETHEORY_TARGET_AVX2 size_t offset_avx2(rect_columns r, const int dx, const int dy)
+    {
+        const __m256i vdx = _mm256_set1_epi32(dx), vdy = _mm256_set1_epi32(dy);
+        size_t i = 0;
+        for (; i + 8 <= r.count; i += 8) {
+            store8(r.x + i, _mm256_add_epi32(load8(r.x + i), vdx));
+            store8(r.y + i, _mm256_add_epi32(load8(r.y + i), vdy));
+        }
+        return i;
+    }
+
+    SPACETHEORY_TARGET_AVX2 size_t intersect_avx2(rect_columns r, const rectangle& clip)
+    {
+        const __m256i cx = _mm256_set1_epi32(clip.x), cy = _mm256_set1_epi32(clip.y);
+        const __m256i cr = _mm256_set1_epi32(clip.x + clip.w), cb = _mm256_set1_epi32(clip.y + clip.h);
+        size_t i = 0;
+        for (; i + 8 <= r.count; i += 8) {
+            const __m256i x = load8(r.x + i), y = load8(r.y + i);
+            const __m256i right = _mm256_add_epi32(x, load8(r.w + i)), bottom = _mm256_add_epi32(y, load8(r.h + i));
+            const __m256i nx = _mm256_max_epi32(x, cx), ny = _mm256_max_epi32(y, cy);
+            store8(r.x + i, nx);
+            store8(r.y + i, ny);
+            store8(r.w + i, _mm256_sub_epi32(_mm256_min_epi32(right, cr), nx));
+            store8(r.h + i, _mm256_sub_epi32(_mm256_min_epi32(bottom, cb), ny));
+        }
+        return i;
+    }
+
+    SPACETHEORY_TARGET_AVX2 size_t bounds_avx2(const rect_columns& r, bounds_state& b)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i highest = _mm256_set1_epi32(INT_MAX), lowest = _mm256_set1_epi32(INT_MIN);
+        __m256i min_x = highest, min_y = highest, max_right = lowest, max_bottom = lowest, any = zero;
+        size_t i = 0;
+        for (; i + 8 <= r.count; i += 8) {
+            const __m256i x = load8(r.x + i), y = load8(r.y + i), w = load8(r.w + i), h = load8(r.h + i);
+            const __m256i empty = _mm256_or_si256(_mm256_cmpeq_epi32(w, zero), _mm256_cmpeq_epi32(h, zero));
+            min_x = _mm256_min_epi32(min_x, _mm256_blendv_epi8(x, highest, empty));
+            min_y = _mm256_min_epi32(min_y, _mm256_blendv_epi8(y, highest, empty));
+            max_right = _mm256_max_epi32(max_right, _mm256_blendv_epi8(_mm256_add_epi32(x, w), lowest, empty));
+            max_bottom = _mm256_max_epi32(max_bottom, _mm256_blendv_epi8(_mm256_add_epi32(y, h), lowest, empty));
+            any = _mm256_or_si256(any, _mm256_andnot_si256(empty, _mm256_cmpeq_epi32(zero, zero)));
+        }
+
+        // REDUCE THE LANES:
+        alignas(32) int lanes[4][8];
+        _mm256_store_si256((__m256i *) lanes[0], min_x);
+        _mm256_store_si256((__m256i *) lanes[1], min_y);
+        _mm256_store_si256((__m256i *) lanes[2], max_right);
+        _mm256_store_si256((__m256i *) lanes[3], max_bottom);
+        if (mask8(any)) {
+            for (int l = 0; l < 8; ++l) {
+                b.min_x = std::min(b.min_x, lanes[0][l]);
+                b.min_y = std::min(b.min_y, lanes[1][l]);
+                b.max_right = std::max(b.max_right, lanes[2][l]);
+                b.max_bottom = std::max(b.max_bottom, lanes[3][l]);
+            }
+            b.any = true;
+        }
+        return i;
+    }
+
+    SPACETHEORY_TARGET_AVX2 size_t query_area_avx2(const rect_columns& r, const rectangle& area, std::vector<uint32_t>& hits)
+    {
+        const __m256i ax = _mm256_set1_epi32(area.x), ay = _mm256_set1_epi32(area.y);
+        const __m256i ar = _mm256_set1_epi32(area.right()), ab = _mm256_set1_epi32(area.bottom());
+        size_t i = 0;
+        for (; i + 8 <= r.count; i += 8) {
+            const __m256i x = load8(r.x + i), y = load8(r.y + i);
+            const __m256i right = _mm256_add_epi32(x, load8(r.w + i)), bottom = _mm256_add_epi32(y, load8(r.h + i));
+            const __m256i miss = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpgt_epi32(x, ar), _mm256_cmpgt_epi32(ax, right)),
+                _mm256_or_si256(_mm256_cmpgt_epi32(y, ab), _mm256_cmpgt_epi32(ay, bottom)));
+            push_hits(~mask8(miss) & 0xFF, i, hits);
+        }
+        return i;
+    }
+
+    SPACETHEORY_TARGET_AVX2 size_t query_point_avx2(const rect_columns& r, const point& pt, std::vector<uint32_t>& hits)
+    {
+        const __m256i px = _mm256_set1_epi32(pt.x), py = _mm256_set1_epi32(pt.y);
+        size_t i = 0;
+        for (; i + 8 <= r.count; i += 8) {
+            const __m256i x = load8(r.x + i), y = load8(r.y + i);
+            const __m256i right = _mm256_add_epi32(x, load8(r.w + i)), bottom = _mm256_add_epi32(y, load8(r.h + i));
+            const __m256i inside = _mm256_and_si256(
+                _mm256_andnot_si256(_mm256_cmpgt_epi32(x, px), _mm256_cmpgt_epi32(right, px)),
+                _mm256_andnot_si256(_mm256_cmpgt_epi32(y, py), _mm256_cmpgt_epi32(bottom, py)));
+            push_hits(mask8(inside), i, hits);
+        }
+        return i;
+    }
+#endif
+
+}
+
+// ----------------------------------------------------------------------------
+// RECT BATCH
+// ----------------------------------------------------------------------------
+
+void rect_batch::reserve(const size_t count)
+{
+    m_x.reserve(count);
+    m_y.reserve(count);
+    m_w.reserve(count);
+    m_h.reserve(count);
+}
+
+void rect_batch::clear()
+{
+    m_x.clear();
+    m_y.clear();
+    m_w.clear();
+    m_h.clear();
+}
+
+size_t rect_batch::add(const rectangle& rect)
+{
+    m_x.push_back(rect.x);
+    m_y.push_back(rect.y);
+    m_w.push_back(rect.w);
+    m_h.push_back(rect.h);
+    return m_x.size() - 1;
+}
+
+void rect_batch::add(const rectangle * rects, const size_t count)
+{
+    reserve(size() + count);
+    for (size_t i = 0; i < count; ++i) add(rects[i]);
+}
+
+void rect_batch::set(const size_t index, const rectangle& rect)
+{
+    m_x[index] = rect.x;
+    m_y[index] = rect.y;
+    m_w[index] = rect.w;
+    m_h[index] = rect.h;
+}
+
+rectangle rect_batch::get(const size_t index) const
+{
+    return rectangle(m_x[index], m_y[index], m_w[index], m_h[index]);
+}
+
+void rect_batch::remove(const size_t index)
+{
+    const size_t last = size() - 1;
+    if (index != last) set(index, get(last));
+    m_x.pop_back();
+    m_y.pop_back();
+    m_w.pop_back();
+    m_h.pop_back();
+}
+
+void rect_batch::offset(const int x, const int y)
+{
+    const rect_columns r = { m_x.data(), m_y.data(), m_w.data(), m_h.data(), size() };
+    size_t done = 0;
+#if SPACETHEORY_SIMD_X86
+    done = cpu_features::get().avx2 ? offset_avx2(r, x, y) : offset_sse2(r, x, y);
+#endif
+    offset_scalar(r, done, x, y);
+}
+
+void rect_batch::intersect(const rectangle& clip)
+{
+    const rect_columns r = { m_x.data(), m_y.data(), m_w.data(), m_h.data(), size() };
+    size_t done = 0;
+#if SPACETHEORY_SIMD_X86
+    done = cpu_features::get().avx2 ? intersect_avx2(r, clip) : intersect_sse2(r, clip);
+#endif
+    intersect_scalar(r, done, clip);
+}
+
+rectangle rect_batch::bounds() const
+{
+    const rect_columns r = { (int *) m_x.data(), (int *) m_y.data(), (int *) m_w.data(), (int *) m_h.data(), size() };
+    bounds_state b;
+    size_t done = 0;
+#if SPACETHEORY_SIMD_X86
+    done = cpu_features::get().avx2 ? bounds_avx2(r, b) : bounds_sse2(r, b);
+#endif
+    bounds_scalar(r, done, b);
+
+    if (!b.any) return rectangle();
+    return rectangle(b.min_x, b.min_y, b.max_right - b.min_x, b.max_bottom - b.min_y);
+}
+
+size_t rect_batch::query(const rectangle& area, std::vector<uint32_t>& hits) const
+{
+    const rect_columns r = { (int *) m_x.data(), (int *) m_y.data(), (int *) m_w.data(), (int *) m_h.data(), size() };
+    const size_t before = hits.size();
+    size_t done = 0;
+#if SPACETHEORY_SIMD_X86
+    done = cpu_features::get().avx2 ? query_area_avx2(r, area, hits) : query_area_sse2(r, area, hits);
+#endif
+    query_area_scalar(r, done, area, hits);
+    return hits.size() - before;
+}
+
+size_t rect_batch::query(const point& pt, std::vector<uint32_t>& hits) const
+{
+    const rect_columns r = { (int *) m_x.data(), (int *) m_y.data(), (int *) m_w.data(), (int *) m_h.data(), size() };
+    const size_t before = hits.size();
+    size_t done = 0;
+#if SPACETHEORY_SIMD_X86
+    done = cpu_features::get().avx2 ? query_point_avx2(r, pt, hits) : query_point_sse2(r, pt, hits);
+#endif
+    query_point_scalar(r, done, pt, hits);
+    return hits.size() - before;
+}
\ No newline at end of file
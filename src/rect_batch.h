@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "rectangle.h"
+
+namespace spacetheory {
+
+    // Many rectangles stored as a structure of arrays (every x, then every y,
+    // ...) so the bulk operations below run 4 or 8 rectangles per instruction
+    // with SSE2 or AVX2, picked at runtime, and a scalar loop elsewhere. Each
+    // gives the same results as the rectangle function it's named after,
+    // applied one rectangle at a time.
+    class rect_batch {
+    private:
+        std::vector<int> m_x, m_y, m_w, m_h;
+
+    public:
+        inline size_t size() const { return m_x.size(); }
+        inline bool empty() const { return m_x.empty(); }
+        void reserve(const size_t count);
+        void clear();
+
+        size_t add(const rectangle& rect); // Returns its index
+        void add(const rectangle * rects, const size_t count);
+        void set(const size_t index, const rectangle& rect);
+        rectangle get(const size_t index) const;
+        // Moves the last rectangle into its place:
+        void remove(const size_t index);
+
+        inline const int * x() const { return m_x.data(); }
+        inline const int * y() const { return m_y.data(); }
+        inline const int * w() const { return m_w.data(); }
+        inline const int * h() const { return m_h.data(); }
+
+        // rectangle::offset on every rectangle:
+        void offset(const int x, const int y);
+        // Every rectangle becomes rectangle::intersect(it, clip):
+        void intersect(const rectangle& clip);
+        // rectangle::union_rect of them all, empty ones are skipped the same way:
+        rectangle bounds() const;
+
+        // Append the indices of the rectangles that rectangle::has_intersection
+        // says overlap the area, or that contain the point, and return how many:
+        size_t query(const rectangle& area, std::vector<uint32_t>& hits) const;
+        size_t query(const point& pt, std::vector<uint32_t>& hits) const;
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "rectangle.h"
+#include "cpu_features.h"
+#include <climits>
+#include <algorithm>
+#if SPACETHEORY_SIMD_X86
+#include <immintrin.h>
+#endif
+
+using namespace spacetheory;
+
+// ----------------------------------------------------------------------------
+// ENCLOSE POINTS
+// ----------------------------------------------------------------------------
+// point is two ints, so an array of them is x, y, x, y, ... and a register
+// holds whole points with x and y in alternate lanes. Mins and maxes are
+// taken per lane and the x and y lanes folded together at the end, no
+// shuffling the points apart first.
+
+namespace {
+
+    struct extent {
+        int min_x = INT_MAX, min_y = INT_MAX, max_x = INT_MIN, max_y = INT_MIN;
+        bool found = false;
+    };
+
+    void enclose_scalar(const point * points, size_t i, const size_t count, const rectangle * clip, extent& e)
+    {
+        for (; i < count; ++i) {
+            const point& pt = points[i];
+            if (clip && !clip->contains(pt)) continue;
+            e.min_x = std::min(e.min_x, pt.x);
+            e.min_y = std::min(e.min_y, pt.y);
+            e.max_x = std::max(e.max_x, pt.x);
+            e.max_y = std::max(e.max_y, pt.y);
+            e.found = true;
+        }
+    }
+
+#if SPACETHEORY_SIMD_X86
+    inline __m128i select4(const __m128i mask, const __m128i a, const __m128i b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+
+    // Folds x, y, x, y lanes into the extent:
+    template<size_t lanes>
+    void fold(const int (&mins)[lanes], const int (&maxs)[lanes], const bool found, extent& e)
+    {
+        if (!found) return;
+        for (size_t l = 0; l < lanes; l += 2) {
+            e.min_x = std::min(e.min_x, mins[l]);
+            e.min_y = std::min(e.min_y, mins[l + 1]);
+            e.max_x = std::max(e.max_x, maxs[l]);
+            e.max_y = std::max(e.max_y, maxs[l + 1]);
+        }
+        e.found = true;
+    }
+
+    size_t enclose_sse2(const point * points, const size_t count, const rectangle * clip, extent& e)
+    {
+        const __m128i highest = _mm_set1_epi32(INT_MAX), lowest = _mm_set1_epi32(INT_MIN);
+        __m128i mins = highest, maxs = lowest, found = _mm_setzero_si128();
+
+        // Clip as x, y pairs, inclusive minimum and exclusive maximum like
+        // rectangle::contains:
+        __m128i clip_min = _mm_setzero_si128(), clip_max = _mm_setzero_si128();
+        if (clip) {
+            clip_min = _mm_setr_epi32(clip->x, clip->y, clip->x, clip->y);
+            clip_max = _mm_setr_epi32(clip->right(), clip->bottom(), clip->right(), clip->bottom());
+        }
+
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2) {
+            const __m128i v = _mm_loadu_si128((const __m128i *) (points + i));
+            __m128i inside = _mm_cmpeq_epi32(v, v);
+            if (clip) {
+                // Per lane, then a point is in if both its lanes are:
+                inside = _mm_andnot_si128(_mm_cmpgt_epi32(clip_min, v), _mm_cmpgt_epi32(clip_max, v));
+                inside = _mm_and_si128(inside, _mm_shuffle_epi32(inside, _MM_SHUFFLE(2, 3, 0, 1)));
+            }
+            const __m128i low = select4(inside, v, highest), high = select4(inside, v, lowest);
+            mins = select4(_mm_cmpgt_epi32(mins, low), low, mins);
+            maxs = select4(_mm_cmpgt_epi32(high, maxs), high, maxs);
+            found = _mm_or_si128(found, inside);
+        }
+
+        alignas(16) int min_lanes[4], max_lanes[4];
+        _mm_store_si128((__m128i *) min_lanes, mins);
+        _mm_store_si128((__m128i *) max_lanes, maxs);
+        fold(min_lanes, max_lanes, _mm_movemask_epi8(found) != 0, e);
+        return i;
+    }
+
+    SPACETHEORY_TARGET_AVX2 size_t enclose_avx2(const point * points, const size_t count, const rectangle * clip, extent& e)
+    {
+        const __m256i highest = _mm256_set1_epi32(INT_MAX), lowest = _mm256_set1_epi32(INT_MIN);
+        __m256i mins = highest, maxs = lowest, found = _mm256_setzero_si256();
+
+        __m256i clip_min = _mm256_setzero_si256(), clip_max = _mm256_setzero_si256();
+        if (clip) {
+            clip_min = _mm256_setr_epi32(clip->x, clip->y, clip->x, clip->y, clip->x, clip->y, clip->x, clip->y);
+            clip_max = _mm256_setr_epi32(clip->right(), clip->bottom(), clip->right(), clip->bottom(),
+                clip->right(), clip->bottom(), clip->right(), clip->bottom());
+        }
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const __m256i v = _mm256_loadu_si256((const __m256i *) (points + i));
+            __m256i inside = _mm256_cmpeq_epi32(v, v);
+            if (clip) {
+                inside = _mm256_andnot_si256(_mm256_cmpgt_epi32(clip_min, v), _mm256_cmpgt_epi32(clip_max, v));
+                inside = _mm256_and_si256(inside, _mm256_shuffle_epi32(inside, _MM_SHUFFLE(2, 3, 0, 1)));
+            }
+            mins = _mm256_min_epi32(mins, _mm256_blendv_epi8(highest, v, inside));
+            maxs = _mm256_max_epi32(maxs, _mm256_blendv_epi8(lowest, v, inside));
+            found = _mm256_or_si256(found, inside);
+        }
+
+        alignas(32) int min_lanes[8], max_lanes[8];
+        _mm256_store_si256((__m256i *) min_lanes, mins);
+        _mm256_store_si256((__m256i *) max_lanes, maxs);
+        fold(min_lanes, max_lanes, _mm256_movemask_epi8(found) != 0, e);
+        return i;
+    }
+#endif
+
+}
+
+bool rectangle::enclose_points(const point* points, const size_t count, const rectangle* clip_rect, rectangle* result)
+{
+    if(count < 1) return false;
+    if(clip_rect != nullptr && clip_rect->empty()) return false; // Special case for empty rectangle:
+
+    // Special case: if no result was requested, the first point counting is
+    // enough:
+    if(result == nullptr) {
+        if(clip_rect == nullptr) return true;
+        for(size_t i = 0; i < count; ++i) {
+            if(clip_rect->contains(points[i])) return true;
+        }
+        return false;
+    }
+
+    extent e;
+    size_t done = 0;
+#if SPACETHEORY_SIMD_X86
+    done = cpu_features::get().avx2 ? enclose_avx2(points, count, clip_rect, e) : enclose_sse2(points, count, clip_rect, e);
+#endif
+    enclose_scalar(points, done, count, clip_rect, e);
+
+    if(!e.found) return false;
+
+    result->x = e.min_x;
+    result->y = e.min_y;
+    result->w = (e.max_x - e.min_x) + 1;
+    result->h = (e.max_y - e.min_y) + 1;
+    return true;
+}
\ No newline at end of file
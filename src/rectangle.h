@@ -2,6 +2,7 @@
 #include "point.h"
 #include "size.h"
 #include <sstream>
+#include <type_traits>
 #include <vector>
 
 namespace spacetheory {
@@ -12,11 +13,8 @@ namespace spacetheory {
 
             rectangle(const int x = 0, const int y = 0, const int w = 0, const int h = 0) { this->x = x; this->y = y; this->w = w; this->h = h; }
             rectangle(const point& pt, const size& sz) { this->x = pt.x; this->y = pt.y; this->w = sz.w; this->h = sz.h; }
-            rectangle(const point& pt1, const point& pt2) { this->x = x; this->y = y; this->w = pt2.x - pt1.x; this->h = pt2.y - pt1.y; }
-            rectangle(const rectangle& rect) { this->x = rect.x; this->y = rect.y; this->w = rect.w; this->h = rect.h; }
-            rectangle(const int * array) { this->x = array[0]; this->y = array[1]; this->w = array[1]; this->h = array[3]; }
-
-            virtual ~rectangle() {}
+            rectangle(const point& pt1, const point& pt2) { this->x = pt1.x; this->y = pt1.y; this->w = pt2.x - pt1.x; this->h = pt2.y - pt1.y; }
+            rectangle(const int * array) { this->x = array[0]; this->y = array[1]; this->w = array[2]; this->h = array[3]; }
 
             void clear() { x = y = w = h = 0; }
 
@@ -186,82 +184,56 @@ namespace spacetheory {
                 return result;
             }
 
-            bool enclose_points(const std::vector<point> points, const rectangle* clip_rect = nullptr)
+            bool enclose_points(const std::vector<point>& points, const rectangle* clip_rect = nullptr)
             {
-                return rectangle::enclose_points(points, clip_rect, this);
+                return rectangle::enclose_points(points.data(), points.size(), clip_rect, this);
             }
 
-            static bool enclose_points(const std::vector<point> points, const rectangle* clip_rect = nullptr, rectangle* result = nullptr)
+            static bool enclose_points(const std::vector<point>& points, const rectangle* clip_rect = nullptr, rectangle* result = nullptr)
             {
-                int minx = 0, miny = 0, maxx = 0, maxy = 0;
-                int x, y;
-
-                if(points.size() < 1) {
-                    return false;
-                }
-
-                if(clip_rect != nullptr) {
-                    bool added = false;
-                    const int clip_minx = clip_rect->x;
-                    const int clip_miny = clip_rect->y;
-                    const int clip_maxx = clip_rect->x + clip_rect->w - 1;
-                    const int clip_maxy = clip_rect->y + clip_rect->h - 1;
-
-                    if(clip_rect->empty()) return false; // Special case for empty rectangle:
-
-                    for(auto i = points.begin(); i != points.end(); i++) {
-                        x = (*i).x;
-                        y = (*i).y;
-
-                        if(x < clip_minx || x > clip_maxx || y < clip_miny || y > clip_maxy) continue;
-
-                        if(!added) {
-                            // Special case: if no result was requested, we are done:
-                            if(result == nullptr) return true;
+                return rectangle::enclose_points(points.data(), points.size(), clip_rect, result);
+            }
 
-                            // First point added:
-                            minx = maxx = x;
-                            miny = maxy = y;
-                            added = true;
-                            continue;
-                        }
+            // Contiguous points, reduced 2 to 4 at a time with SSE2 or AVX2
+            // (rectangle.cpp). Only points inside clip_rect count if it's given;
+            // false if no point counts:
+            static bool enclose_points(const point* points, const size_t count, const rectangle* clip_rect = nullptr, rectangle* result = nullptr);
 
-                        if(x < minx) minx = x;
-                        else if(x > maxx) maxx = x;
+            // Any other range of points, one at a time:
+            template<typename iterator>
+            static bool enclose_points(iterator first, iterator last, const rectangle* clip_rect = nullptr, rectangle* result = nullptr)
+            {
+                if(clip_rect != nullptr && clip_rect->empty()) return false; // Special case for empty rectangle:
 
-                        if(y < miny) miny = y;
-                        else if(y > maxy) maxy = y;
-                    }
+                bool added = false;
+                int minx = 0, miny = 0, maxx = 0, maxy = 0;
+                for(; first != last; ++first) {
+                    const point& pt = *first;
+                    if(clip_rect != nullptr && !clip_rect->contains(pt)) continue;
 
-                    if(!added) return false;
-                }
-                else {
                     // Special case: if no result was requested, we are done:
                     if(result == nullptr) return true;
 
-                    // No clipping, always add the first point:
-                    minx = maxx = points[0].x;
-                    miny = maxy = points[0].y;
-
-                    for(auto i = points.begin() + 1; i != points.end(); i++) {
-                        x = (*i).x;
-                        y = (*i).y;
-
-                        if(x < minx) minx = x;
-                        else if(x > maxx) maxx = x;
-
-                        if(y < miny) miny = y;
-                        else if(y > maxy) maxy = y;
+                    if(!added) {
+                        minx = maxx = pt.x;
+                        miny = maxy = pt.y;
+                        added = true;
+                        continue;
                     }
-                }
 
-                if(result != nullptr) {
-                    result->x = minx;
-                    result->y = miny;
-                    result->w = (maxx - minx) + 1;
-                    result->h = (maxy - miny) + 1;
+                    // Both bounds are checked for every point, not one or the other:
+                    if(pt.x < minx) minx = pt.x;
+                    if(pt.x > maxx) maxx = pt.x;
+                    if(pt.y < miny) miny = pt.y;
+                    if(pt.y > maxy) maxy = pt.y;
                 }
 
+                if(!added) return false;
+
+                result->x = minx;
+                result->y = miny;
+                result->w = (maxx - minx) + 1;
+                result->h = (maxy - miny) + 1;
                 return true;
             }
 
@@ -300,7 +272,6 @@ namespace spacetheory {
                 return ss.str();
             }
 
-            rectangle& operator=(const rectangle& rect) { x = rect.x; y = rect.y; w = rect.w; h = rect.h; return *this; }
             rectangle operator+(const point& pt) { return rectangle(x + pt.x, y + pt.y, w, h); }
             void operator+=(const point& pt) { offset(pt); }
             rectangle operator-(const point& pt) { return rectangle(x - pt.x, y - pt.y, w, h); }
@@ -316,4 +287,10 @@ namespace spacetheory {
             bool operator==(const rectangle& rect) const { return (x == rect.x && y == rect.y && w == rect.w && h == rect.h); }
             bool operator!=(const rectangle& rect) const { return !(*this == rect); }
         };
+
+        // Four ints and nothing else, rect_batch and anything storing rectangles
+        // in bulk relies on that:
+        static_assert(std::is_trivially_copyable<rectangle>::value, "rectangle has to stay trivially copyable");
+        static_assert(sizeof(rectangle) == sizeof(int) * 4, "rectangle has to stay tightly packed");
+
 }
\ No newline at end of file
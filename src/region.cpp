@@ -0,0 +1,264 @@
+#include "region.h"
+#include <algorithm>
+#include <climits>
+
+using namespace spacetheory;
+
+region::region() : m_extents{ 0, 0, 0, 0 }
+{
+}
+
+region::region(const rectangle& rect) : m_extents{ 0, 0, 0, 0 }
+{
+    if (rect.w > 0 && rect.h > 0) {
+        m_boxes.push_back(box{ rect.x, rect.y, rect.x + rect.w, rect.y + rect.h });
+        m_extents = m_boxes.front();
+    }
+}
+
+rectangle region::bounds() const
+{
+    return rectangle(m_extents.x1, m_extents.y1, m_extents.x2 - m_extents.x1, m_extents.y2 - m_extents.y1);
+}
+
+long long region::area() const
+{
+    long long pixels = 0;
+    for (auto& b : m_boxes) pixels += (long long) (b.x2 - b.x1) * (long long) (b.y2 - b.y1);
+    return pixels;
+}
+
+void region::clear()
+{
+    m_boxes.clear();
+    m_extents = box{ 0, 0, 0, 0 };
+}
+
+void region::translate(const int x, const int y)
+{
+    for (auto& b : m_boxes) {
+        b.x1 += x;
+        b.x2 += x;
+        b.y1 += y;
+        b.y2 += y;
+    }
+    if (!empty()) {
+        m_extents.x1 += x;
+        m_extents.x2 += x;
+        m_extents.y1 += y;
+        m_extents.y2 += y;
+    }
+}
+
+bool region::contains(const point& pt) const
+{
+    if (empty() || pt.x < m_extents.x1 || pt.x >= m_extents.x2 || pt.y < m_extents.y1 || pt.y >= m_extents.y2) return false;
+    for (auto& b : m_boxes) {
+        if (b.y1 > pt.y) break; // Bands are sorted, the rest are below
+        if (pt.y < b.y2 && pt.x >= b.x1 && pt.x < b.x2) return true;
+    }
+    return false;
+}
+
+bool region::has_intersection(const rectangle& rect) const
+{
+    const int x2 = rect.x + rect.w, y2 = rect.y + rect.h;
+    if (empty() || rect.w <= 0 || rect.h <= 0) return false;
+    if (rect.x >= m_extents.x2 || x2 <= m_extents.x1 || rect.y >= m_extents.y2 || y2 <= m_extents.y1) return false;
+    for (auto& b : m_boxes) {
+        if (b.y1 >= y2) break;
+        if (b.y2 > rect.y && b.x1 < x2 && b.x2 > rect.x) return true;
+    }
+    return false;
+}
+
+void region::update_extents()
+{
+    if (m_boxes.empty()) {
+        m_extents = box{ 0, 0, 0, 0 };
+        return;
+    }
+
+    // Bands are sorted, so only the sides need looking at every box:
+    m_extents = box{ m_boxes.front().x1, m_boxes.front().y1, m_boxes.front().x2, m_boxes.back().y2 };
+    for (auto& b : m_boxes) {
+        m_extents.x1 = std::min(m_extents.x1, b.x1);
+        m_extents.x2 = std::max(m_extents.x2, b.x2);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// BAND OPERATIONS
+// ----------------------------------------------------------------------------
+
+void region::combine(const box * a, const box * a_end, const box * b, const box * b_end, const operation op, std::vector<int>& spans)
+{
+    // The spans of one band from each region (either may be empty), combined
+    // into x1, x2 pairs:
+    spans.clear();
+    switch (op) {
+    case operation::unite:
+        while (a != a_end || b != b_end) {
+            const box * next = (b == b_end || (a != a_end && a->x1 <= b->x1)) ? a++ : b++;
+            if (!spans.empty() && next->x1 <= spans.back()) spans.back() = std::max(spans.back(), next->x2);
+            else {
+                spans.push_back(next->x1);
+                spans.push_back(next->x2);
+            }
+        }
+        break;
+
+    case operation::intersect:
+        while (a != a_end && b != b_end) {
+            const int x1 = std::max(a->x1, b->x1), x2 = std::min(a->x2, b->x2);
+            if (x1 < x2) {
+                spans.push_back(x1);
+                spans.push_back(x2);
+            }
+            if (a->x2 < b->x2) a++;
+            else b++;
+        }
+        break;
+
+    case operation::subtract:
+        for (; a != a_end; ++a) {
+            int x1 = a->x1;
+            while (b != b_end && b->x2 <= x1) b++; // Entirely left of what's left of a
+            for (const box * cut = b; cut != b_end && cut->x1 < a->x2; ++cut) {
+                if (cut->x1 > x1) {
+                    spans.push_back(x1);
+                    spans.push_back(cut->x1);
+                }
+                x1 = std::max(x1, cut->x2);
+                if (x1 >= a->x2) break;
+            }
+            if (x1 < a->x2) {
+                spans.push_back(x1);
+                spans.push_back(a->x2);
+            }
+        }
+        break;
+    }
+}
+
+void region::apply(const region& a, const region& b, const operation op, region& result)
+{
+    std::vector<box> boxes;
+    boxes.reserve(a.m_boxes.size() + b.m_boxes.size());
+    std::vector<int> spans;
+
+    const box * ai = a.m_boxes.data(), * a_end = ai + a.m_boxes.size();
+    const box * bi = b.m_boxes.data(), * b_end = bi + b.m_boxes.size();
+    size_t previous_band = 0, previous_count = 0; // Last band added, for coalescing
+
+    int y = std::min(ai != a_end ? ai->y1 : bi->y1, bi != b_end ? bi->y1 : ai->y1);
+    while (ai != a_end || bi != b_end) {
+        // NEXT BAND OF EACH:
+        const box * a_band_end = ai;
+        while (a_band_end != a_end && a_band_end->y1 == ai->y1) a_band_end++;
+        const box * b_band_end = bi;
+        while (b_band_end != b_end && b_band_end->y1 == bi->y1) b_band_end++;
+
+        // Skip a gap where neither has anything:
+        int top = y;
+        if ((ai == a_end || ai->y1 > top) && (bi == b_end || bi->y1 > top)) {
+            top = std::min(ai != a_end ? ai->y1 : bi->y1, bi != b_end ? bi->y1 : ai->y1);
+        }
+
+        // THIS SLICE:
+        // Down to wherever either band starts or ends next.
+        const bool a_in = ai != a_end && ai->y1 <= top;
+        const bool b_in = bi != b_end && bi->y1 <= top;
+        int bottom = INT_MAX;
+        if (ai != a_end) bottom = std::min(bottom, a_in ? ai->y2 : ai->y1);
+        if (bi != b_end) bottom = std::min(bottom, b_in ? bi->y2 : bi->y1);
+
+        combine(a_in ? ai : a_band_end, a_band_end, b_in ? bi : b_band_end, b_band_end, op, spans);
+
+        if (!spans.empty()) {
+            // COALESCE:
+            // Joins the band above when it touches and has the same spans.
+            const size_t count = spans.size() / 2;
+            bool same = previous_count == count && !boxes.empty() && boxes[previous_band].y2 == top;
+            for (size_t i = 0; same && i < count; ++i) {
+                same = boxes[previous_band + i].x1 == spans[i * 2] && boxes[previous_band + i].x2 == spans[i * 2 + 1];
+            }
+
+            if (same) {
+                for (size_t i = 0; i < count; ++i) boxes[previous_band + i].y2 = bottom;
+            }
+            else {
+                previous_band = boxes.size();
+                previous_count = count;
+                for (size_t i = 0; i < count; ++i) boxes.push_back(box{ spans[i * 2], top, spans[i * 2 + 1], bottom });
+            }
+        }
+
+        y = bottom;
+        if (a_in && ai->y2 <= y) ai = a_band_end;
+        if (b_in && bi->y2 <= y) bi = b_band_end;
+
+        // Nothing more can come of an intersection once either side is done,
+        // or of a subtraction once there's nothing left to subtract from:
+        if (op == operation::intersect && (ai == a_end || bi == b_end)) break;
+        if (op == operation::subtract && ai == a_end) break;
+    }
+
+    result.m_boxes.swap(boxes);
+    result.update_extents();
+}
+
+region& region::operator|=(const region& other)
+{
+    if (other.empty()) return *this;
+    if (empty()) return *this = other;
+    apply(*this, other, operation::unite, *this);
+    return *this;
+}
+
+region& region::operator&=(const region& other)
+{
+    if (empty() || other.empty() || other.m_extents.x1 >= m_extents.x2 || other.m_extents.x2 <= m_extents.x1
+        || other.m_extents.y1 >= m_extents.y2 || other.m_extents.y2 <= m_extents.y1) {
+        clear();
+        return *this;
+    }
+    apply(*this, other, operation::intersect, *this);
+    return *this;
+}
+
+region& region::operator-=(const region& other)
+{
+    if (empty() || other.empty()) return *this;
+    apply(*this, other, operation::subtract, *this);
+    return *this;
+}
+
+region region::operator|(const region& other) const
+{
+    region result(*this);
+    return result |= other;
+}
+
+region region::operator&(const region& other) const
+{
+    region result(*this);
+    return result &= other;
+}
+
+region region::operator-(const region& other) const
+{
+    region result(*this);
+    return result -= other;
+}
+
+bool region::operator==(const region& other) const
+{
+    // Both are minimal, so the same area means the same boxes:
+    if (m_boxes.size() != other.m_boxes.size()) return false;
+    for (size_t i = 0; i < m_boxes.size(); ++i) {
+        const box& a = m_boxes[i], & b = other.m_boxes[i];
+        if (a.x1 != b.x1 || a.y1 != b.y1 || a.x2 != b.x2 || a.y2 != b.y2) return false;
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+#include "rectangle.h"
+
+namespace spacetheory {
+
+    // An area made of any number of rectangles, kept the way window systems
+    // keep clip regions: horizontal bands sorted top to bottom, each a list of
+    // non-overlapping spans sorted left to right, with bands that match the one
+    // above merged into it. Union, intersection and subtraction walk both
+    // regions' bands once, so they're linear in the rectangles involved, and
+    // the result is again a minimal set of non-overlapping rectangles.
+    //
+    // Unlike rectangle::union_rect, two distant rectangles stay two
+    // rectangles instead of becoming everything between them.
+    class region {
+    private:
+        enum class operation { unite, intersect, subtract };
+
+        struct box {
+            int x1, y1, x2, y2; // Right and bottom exclusive
+        };
+
+        std::vector<box> m_boxes;
+        box m_extents;
+
+        static void combine(const box * a, const box * a_end, const box * b, const box * b_end, const operation op, std::vector<int>& spans);
+        static void apply(const region& a, const region& b, const operation op, region& result);
+        void update_extents();
+
+    public:
+        region();
+        region(const rectangle& rect);
+
+        inline bool empty() const { return m_boxes.empty(); }
+        // Rectangles making up the region, in band order:
+        inline size_t size() const { return m_boxes.size(); }
+        inline rectangle operator[](const size_t index) const
+        {
+            const box& b = m_boxes[index];
+            return rectangle(b.x1, b.y1, b.x2 - b.x1, b.y2 - b.y1);
+        }
+        rectangle bounds() const;
+        long long area() const; // Pixels covered
+
+        void clear();
+        void translate(const int x, const int y);
+
+        bool contains(const point& pt) const;
+        bool has_intersection(const rectangle& rect) const; // Overlap, touching doesn't count
+
+        region& operator|=(const region& other);
+        region& operator&=(const region& other);
+        region& operator-=(const region& other);
+        region operator|(const region& other) const;
+        region operator&(const region& other) const;
+        region operator-(const region& other) const;
+
+        bool operator==(const region& other) const;
+        bool operator!=(const region& other) const { return !(*this == other); }
+    };
+
+}
\ No newline at end of file
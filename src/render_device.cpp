@@ -0,0 +1,64 @@
+#include "render_device.h"
+#include "error.h"
+#include <glad\glad.h>
+#define NANOVG_GL3_IMPLEMENTATION
+#include <nanovg.h>
+#include <nanovg_gl.h>
+#include <nanovg_gl_utils.h>
+
+using namespace spacetheory;
+
+render_device * render_device::s_current = nullptr;
+
+render_device::render_device(const bool linear) : m_vg(nullptr), m_linear(linear), m_active(nullptr)
+{
+    int flags = NVG_STENCIL_STROKES | NVG_ANTIALIAS;
+#ifdef _DEBUG
+    flags |= NVG_DEBUG;
+#endif
+    // Owned by the guard until nothing below can throw anymore:
+    std::unique_ptr<NVGcontext, void (*)(NVGcontext *)> vg(nvgCreateGL3(flags), nvgDeleteGL3);
+    if(!vg) {
+        throw spacetheory::error("Failed to create NVG Context");
+    }
+    m_vg = vg.get();
+
+    try {
+        m_quads.reset(new quad_batch(16384, linear));
+        m_textures.reset(new texture_cache(m_vg));
+        m_targets.reset(new render_target_pool(m_vg));
+    }
+    catch(...) {
+        // Same order as the destructor, the guard deletes the context after:
+        m_targets.reset();
+        m_textures.reset();
+        m_quads.reset();
+        throw;
+    }
+    m_textures->set_srgb(linear);
+    m_targets->set_srgb(linear);
+
+    // Encodes on write and decodes for blending, for sRGB targets only:
+    if(linear) glEnable(GL_FRAMEBUFFER_SRGB);
+
+    vg.release();
+    if(!s_current) s_current = this;
+}
+
+render_device::~render_device()
+{
+    if(s_current == this) s_current = nullptr;
+
+    // Everything holding NanoVG images goes before the context does:
+    m_targets.reset();
+    m_textures.reset();
+    m_quads.reset();
+    nvgDeleteGL3((NVGcontext *) m_vg);
+    if(m_linear) glDisable(GL_FRAMEBUFFER_SRGB);
+}
+
+void render_device::end_frame()
+{
+    // Offscreen targets released this frame start counting toward reuse:
+    m_targets->end_frame();
+}
\ No newline at end of file
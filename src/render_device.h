@@ -0,0 +1,61 @@
+#pragma once
+#include <memory>
+#include "quad_batch.h"
+#include "texture_cache.h"
+#include "render_target_pool.h"
+
+namespace spacetheory {
+
+    class graphics2d;
+
+    // Everything 2D rendering keeps per OpenGL context: the NanoVG context,
+    // the quad batch, the texture cache and the offscreen target pool. Every
+    // graphics2d drawing with a device shares these, so offscreen surfaces
+    // share fonts and images with the screen instead of duplicating them.
+    //
+    // Created and destroyed with its context current, and has to outlive the
+    // graphics2d objects using it. One device per context makes rendering to
+    // several windows possible.
+    //
+    // Everything is drawn with premultiplied alpha. A linear device also
+    // blends in linear space: targets and textures are stored sRGB encoded
+    // with GL_FRAMEBUFFER_SRGB enabled, and colors (given sRGB encoded as
+    // always) are decoded before they're drawn.
+    class render_device {
+    private:
+        static render_device * s_current;
+
+        void * m_vg; // NVGcontext
+        bool m_linear;
+        std::unique_ptr<quad_batch> m_quads;
+        std::unique_ptr<texture_cache> m_textures;
+        std::unique_ptr<render_target_pool> m_targets;
+        graphics2d * m_active; // Between its begin() and end()
+
+    public:
+        render_device(const bool linear = false);
+        render_device(const render_device&) = delete;
+        render_device& operator=(const render_device&) = delete;
+        ~render_device();
+
+        // The device graphics2d uses when it isn't given one, the first device
+        // created until another is made current:
+        static render_device * current() { return s_current; }
+        static void set_current(render_device * device) { s_current = device; }
+
+        inline bool linear() const { return m_linear; }
+        inline void * nvg_context() const { return m_vg; }
+        inline quad_batch * quads() const { return m_quads.get(); }
+        inline texture_cache * textures() const { return m_textures.get(); }
+        inline render_target_pool * targets() const { return m_targets.get(); }
+
+        // The graphics2d drawing with the shared NanoVG context and quad batch,
+        // set by its begin(). Another begin() suspends it until that one ends:
+        inline graphics2d * active_target() const { return m_active; }
+        inline void set_active_target(graphics2d * target) { m_active = target; }
+
+        // Once a frame, after presenting:
+        void end_frame();
+    };
+
+}
\ No newline at end of file
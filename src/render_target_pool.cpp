@@ -0,0 +1,120 @@
+#include "render_target_pool.h"
+#include <glad\glad.h>
+#include <nanovg.h>
+#include <nanovg_gl.h>
+#include <nanovg_gl_utils.h>
+#include "gl_state_cache.h"
+
+using namespace spacetheory;
+
+static const int srgb_key_flag = 1 << 15; // Above NanoVG's image flags
+
+render_target_pool::render_target_pool(void * nvg_context, const unsigned reuse_latency, const unsigned max_idle_frames)
+    : m_vg(nvg_context), m_frame(0), m_reuse_latency(reuse_latency), m_max_idle_frames(max_idle_frames), m_srgb(false)
+{
+}
+
+render_target_pool::~render_target_pool()
+{
+    purge();
+    for (auto& l : m_live) nvgluDeleteFramebuffer((NVGLUframebuffer *) l.first);
+    gl_state_cache::active().forget(gl_state_cache::texture_state);
+}
+
+uint64_t render_target_pool::make_key(const int width, const int height, const int flags)
+{
+    return ((uint64_t) (uint32_t) width << 40) | ((uint64_t) ((uint32_t) height & 0xFFFFFF) << 16) | (uint64_t) (flags & 0xFFFF);
+}
+
+size_t render_target_pool::target_bytes(const uint64_t key)
+{
+    // RGBA8 color texture plus an 8 bit stencil renderbuffer:
+    const size_t width = (size_t) (key >> 40);
+    const size_t height = (size_t) ((key >> 16) & 0xFFFFFF);
+    return width * height * 5;
+}
+
+void * render_target_pool::acquire(const int width, const int height, const int image_flags)
+{
+    const uint64_t key = make_key(width, height, image_flags | (m_srgb ? srgb_key_flag : 0));
+
+    // REUSE:
+    // The oldest release is the likeliest to be done on the GPU.
+    auto it = m_free.find(key);
+    if (it != m_free.end() && !it->second.empty() && it->second.front().released + m_reuse_latency <= m_frame) {
+        void * fbo = it->second.front().fbo;
+        it->second.erase(it->second.begin());
+        m_live[fbo] = key;
+        m_stats.pooled--;
+        m_stats.live++;
+        m_stats.hits++;
+        return fbo;
+    }
+
+    // CREATE:
+    // NanoVG binds the texture and sets the unpack alignment on its own:
+    NVGLUframebuffer * fbo = nvgluCreateFramebuffer((NVGcontext *) m_vg, width, height, image_flags);
+    gl_state_cache& gl = gl_state_cache::active();
+    gl.forget(gl_state_cache::texture_state | gl_state_cache::unpack_state);
+    if (!fbo) return nullptr;
+
+    if (m_srgb) {
+        // NanoVG only makes RGBA8 textures, the attached storage is replaced
+        // with the same size in sRGB:
+        gl.bind_texture_2d(0, fbo->texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+
+    m_live[fbo] = key;
+    m_stats.live++;
+    m_stats.misses++;
+    m_stats.bytes += target_bytes(key);
+    return fbo;
+}
+
+void render_target_pool::release(void * framebuffer)
+{
+    auto it = m_live.find(framebuffer);
+    if (it == m_live.end()) return;
+
+    m_free[it->second].push_back(target{ framebuffer, m_frame });
+    m_live.erase(it);
+    m_stats.live--;
+    m_stats.pooled++;
+}
+
+void render_target_pool::end_frame()
+{
+    m_frame++;
+
+    // FREE WHAT WENT UNUSED:
+    for (auto it = m_free.begin(); it != m_free.end();) {
+        std::vector<target>& targets = it->second;
+        size_t expired = 0;
+        while (expired < targets.size() && targets[expired].released + m_max_idle_frames < m_frame) {
+            nvgluDeleteFramebuffer((NVGLUframebuffer *) targets[expired].fbo);
+            expired++;
+        }
+        if (expired) {
+            gl_state_cache::active().forget(gl_state_cache::texture_state); // Deleted textures may have been bound
+            targets.erase(targets.begin(), targets.begin() + expired);
+            m_stats.pooled -= expired;
+            m_stats.freed += expired;
+            m_stats.bytes -= expired * target_bytes(it->first);
+        }
+
+        if (targets.empty()) it = m_free.erase(it);
+        else ++it;
+    }
+}
+
+void render_target_pool::purge()
+{
+    for (auto& f : m_free) {
+        for (auto& t : f.second) nvgluDeleteFramebuffer((NVGLUframebuffer *) t.fbo);
+        m_stats.pooled -= f.second.size();
+        m_stats.bytes -= f.second.size() * target_bytes(f.first);
+    }
+    m_free.clear();
+    gl_state_cache::active().forget(gl_state_cache::texture_state);
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+namespace spacetheory {
+
+    // Recycles NanoVG framebuffers so short-lived offscreen surfaces (effects,
+    // layers, scratch targets) don't allocate and free GPU memory every frame.
+    // Released targets go back into the pool under their size and image flags
+    // and are handed out again once enough frames have passed that the GPU
+    // can't still be reading them; targets nobody asked for in a while are
+    // freed.
+    class render_target_pool {
+    public:
+        struct stats {
+            size_t live = 0;        // Handed out
+            size_t pooled = 0;      // Waiting for reuse
+            size_t bytes = 0;       // Held by both, color and stencil
+            size_t hits = 0;        // Acquires served from the pool
+            size_t misses = 0;      // Acquires that created a framebuffer
+            size_t freed = 0;       // Pooled framebuffers freed for going unused
+
+            inline double hit_rate() const { return hits + misses ? (double) hits / (double) (hits + misses) : 0.0; }
+        };
+
+    private:
+        struct target {
+            void * fbo;             // NVGLUframebuffer
+            uint64_t released;      // Frame it came back
+        };
+
+        void * m_vg; // NVGcontext
+        uint64_t m_frame;
+        unsigned m_reuse_latency;
+        unsigned m_max_idle_frames;
+        bool m_srgb;
+        std::unordered_map<uint64_t, std::vector<target>> m_free; // Oldest release first
+        std::unordered_map<void *, uint64_t> m_live;              // Framebuffer to key
+        stats m_stats;
+
+        static uint64_t make_key(const int width, const int height, const int flags);
+        static size_t target_bytes(const uint64_t key);
+
+    public:
+        // reuse_latency: frames a released target waits before it's reused.
+        // max_idle_frames: frames a pooled target waits before it's freed.
+        render_target_pool(void * nvg_context, const unsigned reuse_latency = 2, const unsigned max_idle_frames = 120);
+        render_target_pool(const render_target_pool&) = delete;
+        render_target_pool& operator=(const render_target_pool&) = delete;
+        ~render_target_pool(); // Targets still handed out are freed too
+
+        // Returns an NVGLUframebuffer, nullptr if one couldn't be created:
+        void * acquire(const int width, const int height, const int image_flags = 0);
+        void release(void * framebuffer);
+
+        // Targets acquired afterwards store sRGB encoded colors, so blending
+        // into them and sampling them happens in linear space (with
+        // GL_FRAMEBUFFER_SRGB on). Pooled under their own keys:
+        inline void set_srgb(const bool srgb) { m_srgb = srgb; }
+        inline bool is_srgb() const { return m_srgb; }
+
+        // Once a frame, after presenting:
+        void end_frame();
+        // Frees every pooled target:
+        void purge();
+
+        inline const stats& get_stats() const { return m_stats; }
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "scene2d.h"
+
+using namespace spacetheory;
+
+scene2d::scene2d(const uint32_t width, const uint32_t height, const color& background)
+    : m_width(width), m_height(height), m_background(background), m_next_id(1)
+{
+}
+
+scene2d::item_id scene2d::add(const rectangle& bounds)
+{
+    const item_id id = m_next_id++;
+    item& i = m_items[id];
+    i.bounds = bounds;
+    i.rendered_hash = 0;
+    i.rendered = false;
+    return id;
+}
+
+void scene2d::remove(const item_id id)
+{
+    auto it = m_items.find(id);
+    if(it == m_items.end()) return;
+
+    if(it->second.rendered) invalidate(it->second.bounds);
+    m_items.erase(it);
+}
+
+void scene2d::move(const item_id id, const rectangle& bounds)
+{
+    auto it = m_items.find(id);
+    if(it == m_items.end() || it->second.bounds == bounds) return;
+
+    // Where it was and where it is now:
+    if(it->second.rendered) invalidate(it->second.bounds);
+    invalidate(bounds);
+    it->second.bounds = bounds;
+}
+
+graphics2d_command_list& scene2d::record(const item_id id)
+{
+    graphics2d_command_list& commands = m_items.at(id).commands;
+    commands.reset();
+    return commands;
+}
+
+void scene2d::invalidate(const item_id id)
+{
+    auto it = m_items.find(id);
+    if(it != m_items.end()) invalidate(it->second.bounds);
+}
+
+void scene2d::invalidate(const rectangle& area)
+{
+    m_damage |= region(area);
+}
+
+void scene2d::invalidate()
+{
+    m_damage = region(rectangle(0, 0, (int) m_width, (int) m_height));
+}
+
+void scene2d::set_background(const color& background)
+{
+    if(background == m_background) return;
+    m_background = background;
+    invalidate();
+}
+
+void scene2d::resize(const uint32_t width, const uint32_t height)
+{
+    if(width == m_width && height == m_height) return;
+
+    m_width = width;
+    m_height = height;
+    m_back.reset();
+}
+
+void scene2d::render(graphics2d& target, const float x, const float y)
+{
+    if(!target.is_ready() || m_width == 0 || m_height == 0) return;
+
+    const rectangle full(0, 0, (int) m_width, (int) m_height);
+    if(!m_back) invalidate();
+
+    // CHANGED RECORDINGS:
+    for(auto& i : m_items) {
+        if(!i.second.rendered || i.second.commands.hash() != i.second.rendered_hash) invalidate(i.second.bounds);
+    }
+
+    region area = m_damage & region(full);
+    m_damage.clear();
+    if(area.size() > max_damage_rects) area = region(area.bounds());
+
+    if(area.empty()) m_stats.idle_frames++;
+    else {
+        // Ending the target's frame drops its transform and clip, the caller
+        // gets them back afterwards:
+        const graphics2d::drawing_state state = target.get_drawing_state();
+        target.end();
+        if(!m_back) m_back.reset(new graphics2d(target.device(), m_width, m_height));
+        m_back->begin();
+
+        for(size_t r = 0; r < area.size(); ++r) {
+            const rectangle rect = area[r];
+
+            // CLEAR THE DAMAGE:
+            // Scissored to the clip, and a real clear, so a transparent
+            // background works too.
+            m_back->clip(rect);
+            m_back->clear(m_background, graphics2d::color_buffer | graphics2d::stencil_buffer);
+
+            // REDRAW WHAT OVERLAPS IT:
+            for(auto& i : m_items) {
+                item& it = i.second;
+                if(it.bounds.empty() || !rect.has_intersection(it.bounds)) continue;
+
+                it.commands.replay(*m_back);
+                m_back->reset_transform();
+                m_stats.items_drawn++;
+            }
+        }
+        m_back->end();
+        target.begin();
+        target.set_drawing_state(state);
+
+        for(auto& i : m_items) {
+            i.second.rendered = true;
+            i.second.rendered_hash = i.second.commands.hash();
+        }
+
+        if(area == region(full)) m_stats.full_redraws++;
+        else m_stats.partial_redraws++;
+        m_stats.pixels_redrawn += (uint64_t) area.area();
+    }
+
+    // COMPOSITE:
+    target.draw(*m_back, x, y);
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include "graphics2d.h"
+#include "graphics2d_command_list.h"
+#include "region.h"
+
+namespace spacetheory {
+
+    // A 2D scene drawn with damage tracking: each item is a recording tagged
+    // with the bounds it draws within, and the scene keeps its last frame in
+    // an offscreen back buffer. Only the area that changed since then, a
+    // region made of the damaged bounds, is cleared and redrawn one rectangle
+    // at a time (scissored, and only items overlapping it) before the back
+    // buffer is composited onto the target. A frame where nothing changed costs a single textured quad.
+    //
+    // Items are damaged by moving, removing or invalidating them, and by
+    // being re-recorded with different contents (compared by hash). Items are
+    // drawn in the order they were added.
+    class scene2d {
+    public:
+        typedef uint32_t item_id;
+
+        struct stats {
+            size_t full_redraws = 0;
+            size_t partial_redraws = 0;
+            size_t idle_frames = 0;     // Nothing changed, only composited
+            size_t items_drawn = 0;
+            uint64_t pixels_redrawn = 0;
+        };
+
+    private:
+        struct item {
+            rectangle bounds;
+            graphics2d_command_list commands;
+            uint64_t rendered_hash;
+            bool rendered;
+        };
+
+        uint32_t m_width, m_height;
+        color m_background;
+        std::unique_ptr<graphics2d> m_back; // Last frame, created on first render
+        std::map<item_id, item> m_items;    // Ids only grow, so this is drawing order
+        item_id m_next_id;
+        region m_damage;
+        stats m_stats;
+
+        // Items overlapping several damaged rectangles are replayed for each,
+        // past this many the damage's bounds are redrawn in one go instead:
+        static const size_t max_damage_rects = 16;
+
+    public:
+        scene2d(const uint32_t width, const uint32_t height, const color& background = graphics2d::white);
+        scene2d(const scene2d&) = delete;
+        scene2d& operator=(const scene2d&) = delete;
+
+        inline uint32_t width() const { return m_width; }
+        inline uint32_t height() const { return m_height; }
+        inline const region& damage() const { return m_damage; }
+        inline const stats& get_stats() const { return m_stats; }
+
+        // Bounds are in scene pixels and should cover everything the item's
+        // recording draws, anything outside them may be left behind:
+        item_id add(const rectangle& bounds);
+        void remove(const item_id id);
+        void move(const item_id id, const rectangle& bounds);
+        // Empties the item's recording and returns it to record the new
+        // contents, the item is damaged if they turn out different:
+        graphics2d_command_list& record(const item_id id);
+
+        void invalidate(const item_id id);
+        void invalidate(const rectangle& area);
+        void invalidate();
+        void set_background(const color& background);
+        // Everything is redrawn at the new size on the next render:
+        void resize(const uint32_t width, const uint32_t height);
+
+        // Redraws the damage into the back buffer and composites it onto the
+        // target, which has to be between its begin() and end(). The back
+        // buffer is redrawn with the target's frame ended around it, its
+        // transform and clip are put back after. The composite is drawn with
+        // them, x and y are in the target's transformed space:
+        void render(graphics2d& target, const float x = 0.0f, const float y = 0.0f);
+    };
+
+}
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <sstream>
+#include <type_traits>
 
 namespace spacetheory {
 
@@ -8,8 +9,6 @@ namespace spacetheory {
             int w, h;
 
             size(const int w = 0, const int h = 0) : w(w), h(h) {}
-            size(const size& sz) : w(sz.w), h(sz.h) {}
-            virtual ~size() {}
 
             void clear() { w = h = 0; }
 
@@ -56,4 +55,7 @@ namespace spacetheory {
             bool operator!=(size sz) { return (w != sz.w || h != sz.h); }
         };
 
+        static_assert(std::is_trivially_copyable<size>::value, "size has to stay trivially copyable");
+        static_assert(sizeof(size) == sizeof(int) * 2, "size has to stay tightly packed");
+
 }
\ No newline at end of file
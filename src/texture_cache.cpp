@@ -0,0 +1,588 @@
+#include "texture_cache.h"
+#include <glad\glad.h>
+#include <nanovg.h>
+#include <nanovg_gl.h>
+#include <stb_image.h> // Implemented by nanovg.c
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include "gl_state_cache.h"
+#include "logging.h"
+
+using namespace spacetheory;
+
+const size_t spacetheory::texture_cache::staging_sections;
+const size_t spacetheory::texture_cache::staging_section_size;
+
+static const int atlas_padding = 1; // Edge pixels repeated around every region so filtering doesn't bleed
+static std::mutex region_mutex; // Published handles are only written and snapshot under this
+
+texture_cache::texture_cache(void * nvg_context, const size_t memory_budget, const int page_size, const int max_atlas_image)
+    : m_vg(nvg_context), m_render_thread(std::this_thread::get_id()), m_budget(memory_budget), m_page_size(page_size), m_max_atlas_image(std::min(max_atlas_image, page_size - atlas_padding * 2)), m_srgb(false),
+    m_purge_requested(false), m_staging_buffer(0), m_staging_mapped(nullptr), m_staging_section(0), m_staging_used(0)
+{
+    for (auto& f : m_staging_fences) f = nullptr;
+
+    // STAGING BUFFER:
+    glGenBuffers(1, &m_staging_buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_staging_buffer);
+    if (GLAD_GL_ARB_buffer_storage) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, staging_sections * staging_section_size, NULL, flags);
+        m_staging_mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, staging_sections * staging_section_size, flags);
+    }
+    if (!m_staging_mapped) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, staging_sections * staging_section_size, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+texture_cache::~texture_cache()
+{
+    m_decoder.reset();
+
+    // Handles still held elsewhere keep their region description, but the
+    // images go with the cache (and the NanoVG context it's tied to):
+    NVGcontext * vg = (NVGcontext *) m_vg;
+    for (auto& e : m_entries) {
+        if (!e.atlas && !e.alias && e.handle->ready) nvgDeleteImage(vg, e.handle->image);
+    }
+    for (auto& p : m_pages) nvgDeleteImage(vg, p.image);
+    gl_state_cache::active().forget(gl_state_cache::texture_state);
+
+    for (auto& f : m_staging_fences) {
+        if (f) glDeleteSync((GLsync) f);
+    }
+    if (m_staging_buffer) {
+        if (m_staging_mapped) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_staging_buffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &m_staging_buffer);
+    }
+}
+
+texture_handle texture_cache::load(const std::string& path)
+{
+    // Nowhere to upload to from here:
+    if (!on_render_thread()) return load_async(path);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // SAME PATH:
+    auto by_path = m_by_path.find(path);
+    if (by_path != m_by_path.end()) {
+        m_entries.splice(m_entries.begin(), m_entries, by_path->second);
+        m_stats.hits++;
+        return by_path->second->handle;
+    }
+
+    // READ THE FILE:
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file) {
+        SPACETHEORY_LOG(log_level::warning) << "Unable to open image \"" << path << "\"" << std::endl;
+        return nullptr;
+    }
+    const std::vector<uint8_t> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // SAME CONTENTS UNDER ANOTHER PATH:
+    const uint64_t hash = image_decoder::hash_bytes(contents.data(), contents.size());
+    auto range = m_by_hash.equal_range(hash);
+    for (auto i = range.first; i != range.second; ++i) {
+        if (i->second->file_size != contents.size()) continue;
+        i->second->paths.push_back(path);
+        m_by_path[path] = i->second;
+        m_entries.splice(m_entries.begin(), m_entries, i->second);
+        m_stats.hits++;
+        return i->second->handle;
+    }
+
+    // DECODE:
+    int width = 0, height = 0, components = 0;
+    uint8_t * pixels = stbi_load_from_memory(contents.data(), (int) contents.size(), &width, &height, &components, 4);
+    if (!pixels) {
+        SPACETHEORY_LOG(log_level::warning) << "Unable to decode image \"" << path << "\" (" << stbi_failure_reason() << ")" << std::endl;
+        return nullptr;
+    }
+    m_stats.misses++;
+
+    // UPLOAD:
+    entry e;
+    e.paths.push_back(path);
+    e.hash = hash;
+    e.file_size = contents.size();
+    e.handle = std::make_shared<texture_region>();
+    e.atlas = nullptr;
+    e.bytes = 0;
+    e.pending = false;
+    int padding = 0;
+    const bool placed = place(width, height, *e.handle, e.atlas, padding);
+    if (placed) {
+        upload_direct(*e.handle, pixels, padding);
+        if (!e.atlas) e.bytes = (size_t) width * height * 4;
+    }
+    stbi_image_free(pixels);
+    if (!placed) return nullptr;
+
+    m_entries.push_front(std::move(e));
+    m_by_path[path] = m_entries.begin();
+    m_by_hash.insert(std::make_pair(hash, m_entries.begin()));
+    m_stats.entries++;
+
+    texture_handle result = m_entries.front().handle;
+    trim_entries();
+    return result;
+}
+
+texture_handle texture_cache::load_async(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return queue_load(path);
+}
+
+texture_handle texture_cache::queue_load(const std::string& path)
+{
+    auto by_path = m_by_path.find(path);
+    if (by_path != m_by_path.end()) {
+        m_entries.splice(m_entries.begin(), m_entries, by_path->second);
+        m_stats.hits++;
+        return by_path->second->handle;
+    }
+
+    // PLACEHOLDER:
+    // Filled in by pump() once the image is decoded and uploaded. Pending
+    // entries are never evicted, they aren't using any texture memory yet.
+    entry e;
+    e.paths.push_back(path);
+    e.hash = 0;
+    e.file_size = 0;
+    e.handle = std::make_shared<texture_region>(texture_region{ 0, 0, 0, 0, 0, 0, 0, false });
+    e.atlas = nullptr;
+    e.bytes = 0;
+    e.pending = true;
+    m_entries.push_front(std::move(e));
+    m_by_path[path] = m_entries.begin();
+    m_stats.entries++;
+    m_stats.pending++;
+
+    if (!m_decoder) m_decoder = std::make_unique<image_decoder>();
+    m_decoder->submit(path);
+
+    return m_entries.front().handle;
+}
+
+void texture_cache::pump(const double budget_ms)
+{
+    // Background loads queued meanwhile wait for this, for up to the budget:
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_purge_requested) {
+        m_purge_requested = false;
+        purge_entries();
+    }
+    if (!m_decoder) return;
+
+    image_decoder::result decoded;
+    while (m_decoder->poll(decoded)) m_decoded.push_back(std::move(decoded));
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto budget = std::chrono::duration<double, std::milli>(budget_ms);
+    bool first = true;
+    while (!m_decoded.empty() && (first || std::chrono::steady_clock::now() - start < budget)) {
+        // Out of staging space (the GPU hasn't caught up), try next frame:
+        if (!finish_async(m_decoded.front())) break;
+        m_decoded.pop_front();
+        first = false;
+    }
+
+    trim_entries();
+}
+
+bool texture_cache::finish_async(image_decoder::result& decoded)
+{
+    auto by_path = m_by_path.find(decoded.path);
+    if (by_path == m_by_path.end() || !by_path->second->pending) return true; // Purged meanwhile
+    auto it = by_path->second;
+    entry& e = *it;
+
+    if (!decoded.ok) {
+        SPACETHEORY_LOG(log_level::warning) << "Unable to load image \"" << decoded.path << "\"" << std::endl;
+        m_by_path.erase(by_path);
+        m_entries.erase(it);
+        m_stats.entries--;
+        m_stats.pending--;
+        return true;
+    }
+
+    // SAME CONTENTS AS A CACHED IMAGE:
+    // The placeholder becomes a copy of that region, and keeps it alive.
+    auto range = m_by_hash.equal_range(decoded.hash);
+    for (auto i = range.first; i != range.second; ++i) {
+        if (i->second->file_size != decoded.file_size) continue;
+        {
+            std::lock_guard<std::mutex> lock(region_mutex);
+            *e.handle = *i->second->handle;
+        }
+        e.alias = i->second->handle;
+        e.pending = false;
+        m_stats.pending--;
+        m_stats.hits++;
+        return true;
+    }
+
+    // STAGE AND UPLOAD:
+    // Staging space is reserved before anything is placed so that a retry
+    // doesn't leave an empty region behind in the atlas.
+    const bool fits_atlas = decoded.width <= m_max_atlas_image && decoded.height <= m_max_atlas_image;
+    const int padding = fits_atlas ? atlas_padding : 0;
+    const size_t bytes = (size_t) (decoded.width + padding * 2) * (decoded.height + padding * 2) * 4;
+    size_t offset = 0;
+    const bool staged = bytes <= staging_section_size;
+    if (staged && !reserve_staging(bytes, offset)) return false;
+
+    texture_region region = {};
+    int placed_padding = 0;
+    if (!place(decoded.width, decoded.height, region, e.atlas, placed_padding)) {
+        SPACETHEORY_LOG(log_level::warning) << "Unable to create a texture for \"" << decoded.path << "\"" << std::endl;
+        m_by_path.erase(by_path);
+        m_entries.erase(it);
+        m_stats.entries--;
+        m_stats.pending--;
+        return true;
+    }
+    if (staged) upload_staged(region, decoded.pixels.get(), placed_padding, offset);
+    else upload_direct(region, decoded.pixels.get(), placed_padding);
+
+    region.ready = true;
+    {
+        std::lock_guard<std::mutex> lock(region_mutex);
+        *e.handle = region;
+    }
+    e.hash = decoded.hash;
+    e.file_size = decoded.file_size;
+    if (!e.atlas) e.bytes = (size_t) decoded.width * decoded.height * 4;
+    e.pending = false;
+    m_by_hash.insert(std::make_pair(e.hash, it));
+    m_stats.misses++;
+    m_stats.pending--;
+    m_stats.uploads++;
+    return true;
+}
+
+int texture_cache::create_image(const int width, const int height)
+{
+    // NanoVG binds textures and sets the unpack alignment on its own:
+    const int image = nvgCreateImageRGBA((NVGcontext *) m_vg, width, height, 0, NULL);
+    gl_state_cache& gl = gl_state_cache::active();
+    gl.forget(gl_state_cache::texture_state | gl_state_cache::unpack_state);
+    if (!image || !m_srgb) return image;
+
+    // Same size, sRGB storage. Uploads write the same bytes either way:
+    gl.bind_texture_2d(0, nvglImageHandleGL3((NVGcontext *) m_vg, image));
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    return image;
+}
+
+bool texture_cache::place(const int width, const int height, texture_region& region, page *& atlas, int& padding)
+{
+    atlas = nullptr;
+
+    // TEXTURE OF ITS OWN:
+    if (width > m_max_atlas_image || height > m_max_atlas_image) {
+        const int image = create_image(width, height);
+        if (!image) return false;
+
+        region = texture_region{ image, width, height, 0, 0, width, height, true };
+        padding = 0;
+        m_stats.bytes += (size_t) width * height * 4;
+        return true;
+    }
+
+    // ATLAS:
+    // Newest pages first, they're the least likely to be full.
+    const int padded_width = width + atlas_padding * 2;
+    const int padded_height = height + atlas_padding * 2;
+    int x = 0, y = 0;
+    for (auto p = m_pages.rbegin(); p != m_pages.rend() && !atlas; ++p) {
+        if (skyline_insert(*p, padded_width, padded_height, x, y)) atlas = &(*p);
+    }
+    if (!atlas) {
+        const int image = create_image(m_page_size, m_page_size);
+        if (!image) return false;
+
+        m_pages.push_back(page{ image, m_page_size, m_page_size, { skyline_node{ 0, 0, m_page_size } }, 0 });
+        m_stats.pages++;
+        m_stats.bytes += (size_t) m_page_size * m_page_size * 4;
+        atlas = &m_pages.back();
+        if (!skyline_insert(*atlas, padded_width, padded_height, x, y)) {
+            atlas = nullptr;
+            return false;
+        }
+    }
+
+    atlas->entries++;
+    region = texture_region{ atlas->image, atlas->width, atlas->height, x + atlas_padding, y + atlas_padding, width, height, true };
+    padding = atlas_padding;
+    return true;
+}
+
+void texture_cache::write_padded(uint8_t * destination, const uint8_t * pixels, const int width, const int height, const int padding)
+{
+    // The image with its outermost pixels repeated, so linear filtering at the
+    // region's edges samples the image instead of its neighbours:
+    const int padded_width = width + padding * 2;
+    const int padded_height = height + padding * 2;
+    for (int py = 0; py < padded_height; ++py) {
+        const int sy = std::min(std::max(py - padding, 0), height - 1);
+        const uint8_t * row = pixels + (size_t) sy * width * 4;
+        uint8_t * out = destination + (size_t) py * padded_width * 4;
+        for (int px = 0; px < padding; ++px) std::copy(row, row + 4, out + px * 4);
+        std::copy(row, row + (size_t) width * 4, out + padding * 4);
+        for (int px = padding + width; px < padded_width; ++px) std::copy(row + (width - 1) * 4, row + width * 4, out + px * 4);
+    }
+}
+
+void texture_cache::upload_direct(const texture_region& region, const uint8_t * pixels, const int padding)
+{
+    const int padded_width = region.width + padding * 2;
+    const int padded_height = region.height + padding * 2;
+    std::vector<uint8_t> padded;
+    const uint8_t * source = pixels;
+    if (padding) {
+        padded.resize((size_t) padded_width * padded_height * 4);
+        write_padded(padded.data(), pixels, region.width, region.height, padding);
+        source = padded.data();
+    }
+
+    // Straight to the texture since nvgUpdateImage only updates whole images.
+    // Nothing is restored: NanoVG binds its textures again after every
+    // flush and texture update, and sets the unpack alignment itself:
+    gl_state_cache& gl = gl_state_cache::active();
+    gl.bind_texture_2d(0, nvglImageHandleGL3((NVGcontext *) m_vg, region.image));
+    gl.unpack_alignment(1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, region.x - padding, region.y - padding, padded_width, padded_height, GL_RGBA, GL_UNSIGNED_BYTE, source);
+}
+
+bool texture_cache::reserve_staging(const size_t bytes, size_t& offset)
+{
+    if (m_staging_used + bytes > staging_section_size) {
+        // NEXT SECTION:
+        // Only if the GPU is done reading it, never wait; the upload is simply
+        // retried next frame.
+        const size_t next = (m_staging_section + 1) % staging_sections;
+        GLsync fence = (GLsync) m_staging_fences[next];
+        if (fence) {
+            const GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) return false;
+            glDeleteSync(fence);
+            m_staging_fences[next] = nullptr;
+        }
+
+        // Fence the uploads reading the section being left:
+        m_staging_fences[m_staging_section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_staging_section = next;
+        m_staging_used = 0;
+    }
+
+    offset = m_staging_section * staging_section_size + m_staging_used;
+    m_staging_used += (bytes + 255) & ~(size_t) 255; // Keeps every upload's source aligned
+    return true;
+}
+
+void texture_cache::upload_staged(const texture_region& region, const uint8_t * pixels, const int padding, const size_t offset)
+{
+    const int padded_width = region.width + padding * 2;
+    const int padded_height = region.height + padding * 2;
+    const size_t bytes = (size_t) padded_width * padded_height * 4;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_staging_buffer);
+
+    // WRITE THE STAGING RANGE:
+    // Without persistent mapping the range is mapped unsynchronized, the
+    // section fences already guarantee the GPU isn't reading it.
+    uint8_t * destination = nullptr;
+    if (m_staging_mapped) destination = (uint8_t *) m_staging_mapped + offset;
+    else destination = (uint8_t *) glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!destination) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        upload_direct(region, pixels, padding);
+        return;
+    }
+    write_padded(destination, pixels, region.width, region.height, padding);
+    if (!m_staging_mapped) glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    // UPLOAD FROM THE BUFFER:
+    gl_state_cache& gl = gl_state_cache::active();
+    gl.bind_texture_2d(0, nvglImageHandleGL3((NVGcontext *) m_vg, region.image));
+    gl.unpack_alignment(1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, region.x - padding, region.y - padding, padded_width, padded_height, GL_RGBA, GL_UNSIGNED_BYTE, (const GLvoid *) offset);
+
+    // NanoVG uploads from client memory, it must never see this bound:
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+bool texture_cache::skyline_fit(const page& p, const size_t index, const int width, const int height, int& y)
+{
+    // The lowest a rectangle starting at this node can sit is on the highest
+    // node under its width:
+    const int x = p.skyline[index].x;
+    if (x + width > p.width) return false;
+
+    y = 0;
+    int remaining = width;
+    for (size_t i = index; remaining > 0; ++i) {
+        if (i >= p.skyline.size()) return false;
+        y = std::max(y, p.skyline[i].y);
+        if (y + height > p.height) return false;
+        remaining -= p.skyline[i].width;
+    }
+    return true;
+}
+
+bool texture_cache::skyline_insert(page& p, const int width, const int height, int& x, int& y)
+{
+    // BOTTOM-LEFT:
+    // The position that keeps the top of the rectangle lowest, ties go to the
+    // narrowest node to leave wide gaps for wide images.
+    size_t best = p.skyline.size();
+    int best_top = p.height + 1, best_width = p.width + 1;
+    for (size_t i = 0; i < p.skyline.size(); ++i) {
+        int fit_y = 0;
+        if (!skyline_fit(p, i, width, height, fit_y)) continue;
+        if (fit_y + height < best_top || (fit_y + height == best_top && p.skyline[i].width < best_width)) {
+            best = i;
+            best_top = fit_y + height;
+            best_width = p.skyline[i].width;
+            y = fit_y;
+        }
+    }
+    if (best == p.skyline.size()) return false;
+    x = p.skyline[best].x;
+
+    // RAISE THE SKYLINE:
+    // The new node covers the rectangle, the nodes it shadows shrink or go.
+    p.skyline.insert(p.skyline.begin() + best, skyline_node{ x, y + height, width });
+    for (size_t i = best + 1; i < p.skyline.size();) {
+        skyline_node& node = p.skyline[i];
+        const int shadow = (x + width) - node.x;
+        if (shadow <= 0) break;
+        if (shadow < node.width) {
+            node.x += shadow;
+            node.width -= shadow;
+            break;
+        }
+        p.skyline.erase(p.skyline.begin() + i);
+    }
+
+    // Neighbours at the same height become one node:
+    for (size_t i = 0; i + 1 < p.skyline.size();) {
+        if (p.skyline[i].y == p.skyline[i + 1].y) {
+            p.skyline[i].width += p.skyline[i + 1].width;
+            p.skyline.erase(p.skyline.begin() + i + 1);
+        }
+        else ++i;
+    }
+    return true;
+}
+
+void texture_cache::evict(std::list<entry>::iterator it)
+{
+    NVGcontext * vg = (NVGcontext *) m_vg;
+
+    for (const auto& path : it->paths) m_by_path.erase(path);
+    auto range = m_by_hash.equal_range(it->hash);
+    for (auto i = range.first; i != range.second; ++i) {
+        if (i->second == it) {
+            m_by_hash.erase(i);
+            break;
+        }
+    }
+
+    if (it->alias) {
+        // Nothing of its own, the region it copied stays cached
+    }
+    else if (it->atlas) {
+        // A skyline can't take back space from the middle, so an atlas page
+        // only gives its memory back once its last region is gone:
+        page * atlas = it->atlas;
+        if (--atlas->entries == 0) {
+            nvgDeleteImage(vg, atlas->image);
+            m_stats.bytes -= (size_t) atlas->width * atlas->height * 4;
+            m_stats.pages--;
+            m_pages.remove_if([atlas](const page& p) { return &p == atlas; });
+        }
+    }
+    else {
+        nvgDeleteImage(vg, it->handle->image);
+        m_stats.bytes -= it->bytes;
+    }
+
+    // A deleted texture that was bound leaves nothing bound:
+    gl_state_cache::active().forget(gl_state_cache::texture_state);
+
+    m_entries.erase(it);
+    m_stats.entries--;
+    m_stats.evictions++;
+}
+
+void texture_cache::trim()
+{
+    // Other threads leave it to pump(), eviction deletes textures:
+    if (!on_render_thread()) return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    trim_entries();
+}
+
+void texture_cache::purge()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (on_render_thread()) purge_entries();
+    else m_purge_requested = true;
+}
+
+void texture_cache::set_budget(const size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = bytes;
+    if (on_render_thread()) trim_entries();
+}
+
+size_t texture_cache::get_budget() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_budget;
+}
+
+texture_cache::stats texture_cache::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+texture_region texture_cache::snapshot(const texture_handle& handle)
+{
+    std::lock_guard<std::mutex> lock(region_mutex);
+    return *handle;
+}
+
+void texture_cache::trim_entries()
+{
+    // Oldest first, skipping anything a caller still holds or still loading:
+    for (auto it = m_entries.end(); it != m_entries.begin() && m_stats.bytes > m_budget;) {
+        --it;
+        if (it->pending || it->handle.use_count() > 1) continue;
+        auto victim = it++;
+        evict(victim);
+    }
+}
+
+void texture_cache::purge_entries()
+{
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (it->pending || it->handle.use_count() > 1) ++it;
+        else evict(it++);
+    }
+}
\ No newline at end of file
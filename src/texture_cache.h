@@ -0,0 +1,170 @@
+#pragma once
+#include <stdint.h>
+#include <list>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include "image_decoder.h"
+
+namespace spacetheory {
+
+    // Where an image ended up: a sub-rectangle of an atlas page, or the whole of
+    // a texture of its own when it's too big for the atlas. Images loaded in
+    // the background are placeholders (not ready, no size) until uploaded.
+    struct texture_region {
+        int image;                      // NanoVG image
+        int page_width, page_height;    // Size of that image
+        int x, y, width, height;        // Pixels of this region within it
+        bool ready;
+    };
+
+    typedef std::shared_ptr<const texture_region> texture_handle;
+
+    // Loads images once and keeps them around while they fit a memory budget.
+    // Loads are deduplicated by path, and by content hash so the same file
+    // under another path doesn't decode and upload again. Small images are
+    // packed into shared atlas pages with a skyline packer so drawing many of
+    // them doesn't switch textures. Entries are evicted least recently used
+    // first, but only once nothing outside the cache holds their handle.
+    //
+    // load_async() decodes on worker threads and hands back a placeholder right
+    // away; pump(), called once a frame on the render thread, uploads finished
+    // images through a ring of pixel buffers under a time budget so a level's
+    // worth of images doesn't land in a single frame.
+    //
+    // THREADS:
+    // OpenGL is only touched on the render thread, the one the cache was
+    // created on until set_render_thread() says otherwise (see
+    // loop_setup::threaded_rendering). Everything else is safe from any
+    // thread: load() from another thread queues a background load instead,
+    // and purge() is left to the next pump(), which trims anyway.
+    class texture_cache {
+    public:
+        struct stats {
+            size_t hits = 0;        // Loads served from the cache
+            size_t misses = 0;      // Loads that decoded a file
+            size_t evictions = 0;
+            size_t entries = 0;
+            size_t pages = 0;       // Atlas pages
+            size_t bytes = 0;       // Texture memory held, atlas pages count in full
+            size_t pending = 0;     // Background loads not uploaded yet
+            size_t uploads = 0;     // Background loads uploaded
+        };
+
+    private:
+        struct skyline_node {
+            int x, y, width;
+        };
+
+        struct page {
+            int image;
+            int width, height;
+            std::vector<skyline_node> skyline;
+            size_t entries; // Regions still cached, the page goes with the last one
+        };
+
+        struct entry {
+            std::vector<std::string> paths;
+            uint64_t hash;
+            size_t file_size;
+            std::shared_ptr<texture_region> handle;
+            page * atlas;       // nullptr for a texture of its own
+            size_t bytes;       // Only for textures of their own
+            bool pending;       // Still decoding or waiting for its upload
+            texture_handle alias; // Background load whose contents were already cached
+        };
+
+        void * m_vg; // NVGcontext
+        std::atomic<std::thread::id> m_render_thread;
+
+        // Guards everything below but the staging buffer, which only the
+        // render thread uses:
+        mutable std::mutex m_mutex;
+        size_t m_budget;
+        int m_page_size;
+        int m_max_atlas_image;
+        bool m_srgb;
+
+        std::list<entry> m_entries;         // Most recently used first
+        std::list<page> m_pages;
+        std::unordered_map<std::string, std::list<entry>::iterator> m_by_path;
+        std::unordered_multimap<uint64_t, std::list<entry>::iterator> m_by_hash;
+        stats m_stats;
+
+        // BACKGROUND LOADING:
+        std::unique_ptr<image_decoder> m_decoder; // Started by the first load_async
+        std::deque<image_decoder::result> m_decoded; // Waiting for upload
+        bool m_purge_requested; // From another thread, for the next pump()
+
+        // Pixel unpack buffer written as a ring of fenced sections, persistently
+        // mapped when ARB_buffer_storage is available:
+        static const size_t staging_sections = 4;
+        static const size_t staging_section_size = 4 * 1024 * 1024;
+        uint32_t m_staging_buffer;
+        void * m_staging_mapped;
+        void * m_staging_fences[staging_sections]; // GLsync
+        size_t m_staging_section, m_staging_used;
+
+        static bool skyline_fit(const page& p, const size_t index, const int width, const int height, int& y);
+        static bool skyline_insert(page& p, const int width, const int height, int& x, int& y);
+        static void write_padded(uint8_t * destination, const uint8_t * pixels, const int width, const int height, const int padding);
+
+        int create_image(const int width, const int height);
+        bool place(const int width, const int height, texture_region& region, page *& atlas, int& padding);
+        void upload_direct(const texture_region& region, const uint8_t * pixels, const int padding);
+        bool reserve_staging(const size_t bytes, size_t& offset);
+        void upload_staged(const texture_region& region, const uint8_t * pixels, const int padding, const size_t offset);
+        bool finish_async(image_decoder::result& decoded); // false to retry next frame
+        void evict(std::list<entry>::iterator it);
+        void trim_entries();
+        void purge_entries();
+        texture_handle queue_load(const std::string& path);
+        inline bool on_render_thread() const { return std::this_thread::get_id() == m_render_thread.load(std::memory_order_relaxed); }
+
+    public:
+        texture_cache(void * nvg_context, const size_t memory_budget = 256 * 1024 * 1024, const int page_size = 2048, const int max_atlas_image = 256);
+        texture_cache(const texture_cache&) = delete;
+        texture_cache& operator=(const texture_cache&) = delete;
+        ~texture_cache();
+
+        // Returns nullptr if the file can't be read or decoded. A path that's
+        // still loading in the background returns its placeholder, and so does
+        // any thread but the render thread, with load_async():
+        texture_handle load(const std::string& path);
+        // Never blocks; the handle stays not ready for good if loading fails:
+        texture_handle load_async(const std::string& path);
+        // Uploads background loads until budget_ms is spent, at least one per
+        // call so loading always progresses. Render thread only:
+        void pump(const double budget_ms);
+
+        // Evicts unused entries until the cache is within its budget, only on
+        // the render thread:
+        void trim();
+        // Evicts every unused entry, on the next pump() from other threads:
+        void purge();
+
+        // A consistent copy of a handle's region. pump() fills placeholders in
+        // on the render thread, so other threads read them through this:
+        static texture_region snapshot(const texture_handle& handle);
+
+        // The thread that pumps and uploads, the one it's handed to when the
+        // OpenGL context moves:
+        inline void set_render_thread(const std::thread::id& id) { m_render_thread.store(id, std::memory_order_relaxed); }
+
+        void set_budget(const size_t bytes);
+        size_t get_budget() const;
+        stats get_stats() const;
+
+        // Textures created afterwards are stored sRGB encoded, so sampling
+        // decodes them to linear. Set it before loading anything when drawing
+        // to linear targets:
+        inline void set_srgb(const bool srgb) { m_srgb = srgb; }
+        inline bool is_srgb() const { return m_srgb; }
+    };
+
+}
\ No newline at end of file
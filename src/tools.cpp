@@ -1,8 +1,13 @@
 #include <SDL.h>
+#ifdef _WIN32
+#include <Windows.h>
+#pragma comment(lib, "winmm.lib") // timeBeginPeriod, timeEndPeriod
+#endif
 #include <glad\glad.h>
 #include "tools.h"
 #include <sstream>
 #include <vector>
+#include <thread>
 
 using namespace spacetheory;
 
@@ -43,6 +48,37 @@ std::string tools::friendly_duration(const clock::time_point& start, const clock
     return result.str();
 }
 
+void tools::wait_until(const clock::time_point& deadline)
+{
+    // Sleep granularity is about a millisecond at best (with timer_resolution
+    // active), so stop sleeping a couple of milliseconds early and spin:
+    const auto spin_threshold = std::chrono::milliseconds(2);
+
+    auto now = clock::now();
+    while (deadline - now > spin_threshold) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        now = clock::now();
+    }
+
+    while (clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+tools::timer_resolution::timer_resolution()
+{
+#ifdef _WIN32
+    timeBeginPeriod(1);
+#endif
+}
+
+tools::timer_resolution::~timer_resolution()
+{
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+}
+
 std::string sdltools::SDL_GLattrToString(const SDL_GLattr attr)
 {
     switch (attr) {
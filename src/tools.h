@@ -10,6 +10,18 @@ namespace spacetheory {
         using clock = std::chrono::high_resolution_clock;
 
         std::string friendly_duration(const clock::time_point& start, const clock::time_point& end, const bool abbreviate = true);
+
+        // Sleeps while the deadline is far enough away for the scheduler to be
+        // trusted, then spins for the remainder:
+        void wait_until(const clock::time_point& deadline);
+
+        class timer_resolution {
+            // Raises the OS timer resolution for the lifetime of the object so
+            // that short sleeps in wait_until() don't oversleep.
+        public:
+            timer_resolution();
+            ~timer_resolution();
+        };
     }
 
     namespace sdltools {
@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+namespace spacetheory {
+
+    // Hands the latest value from one writer thread to one reader thread
+    // without locks or waiting on either side. The writer fills back() and
+    // publishes it; the reader picks up whatever was published last with
+    // update() and reads front(). Values published faster than they're read
+    // are replaced, the reader only ever sees the newest.
+    template<typename value_type>
+    class triple_buffer {
+    private:
+        static const uint8_t index_mask = 0x3;
+        static const uint8_t fresh_bit = 0x4; // The middle slot hasn't been read yet
+
+        value_type m_slots[3];
+        std::atomic<uint8_t> m_middle;  // Index of the slot between the two threads, and fresh_bit
+        uint8_t m_back;                 // Writer's slot
+        uint8_t m_front;                // Reader's slot
+
+    public:
+        triple_buffer() : m_middle(1), m_back(0), m_front(2) {}
+        triple_buffer(const triple_buffer&) = delete;
+        triple_buffer& operator=(const triple_buffer&) = delete;
+
+        // WRITER:
+        inline value_type& back() { return m_slots[m_back]; }
+        inline void publish()
+        {
+            const uint8_t previous = m_middle.exchange(m_back | fresh_bit, std::memory_order_acq_rel);
+            m_back = previous & index_mask;
+        }
+
+        // READER:
+        inline bool has_update() const { return (m_middle.load(std::memory_order_acquire) & fresh_bit) != 0; }
+        inline bool update()
+        {
+            if (!has_update()) return false;
+            const uint8_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+            m_front = previous & index_mask;
+            return true;
+        }
+        inline const value_type& front() const { return m_slots[m_front]; }
+    };
+
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "uniform_grid.h"
+#include <algorithm>
+
+using namespace spacetheory;
+
+uniform_grid::uniform_grid(const rectangle& area, const int cell_size)
+    : m_area(area), m_cell_size(std::max(cell_size, 1)), m_query(0), m_count(0)
+{
+    m_columns = std::max((area.w + m_cell_size - 1) / m_cell_size, 1);
+    m_rows = std::max((area.h + m_cell_size - 1) / m_cell_size, 1);
+    m_cells.resize((size_t) m_columns * (size_t) m_rows);
+}
+
+void uniform_grid::cell_range(const rectangle& bounds, int& x0, int& y0, int& x1, int& y1) const
+{
+    // Right and bottom count as inside, the same as has_intersection:
+    x0 = std::min(std::max((bounds.x - m_area.x) / m_cell_size, 0), m_columns - 1);
+    y0 = std::min(std::max((bounds.y - m_area.y) / m_cell_size, 0), m_rows - 1);
+    x1 = std::min(std::max((bounds.right() - m_area.x) / m_cell_size, 0), m_columns - 1);
+    y1 = std::min(std::max((bounds.bottom() - m_area.y) / m_cell_size, 0), m_rows - 1);
+
+    // Division rounds toward zero, left of or above the area is cell 0 anyway:
+    if (x1 < x0) std::swap(x0, x1);
+    if (y1 < y0) std::swap(y0, y1);
+}
+
+void uniform_grid::link(const uint32_t id, const entry& e)
+{
+    for (int y = e.y0; y <= e.y1; ++y) {
+        for (int x = e.x0; x <= e.x1; ++x) m_cells[(size_t) y * m_columns + x].push_back(id);
+    }
+}
+
+void uniform_grid::unlink(const uint32_t id, const entry& e)
+{
+    for (int y = e.y0; y <= e.y1; ++y) {
+        for (int x = e.x0; x <= e.x1; ++x) {
+            std::vector<uint32_t>& cell = m_cells[(size_t) y * m_columns + x];
+            auto it = std::find(cell.begin(), cell.end(), id);
+            if (it != cell.end()) {
+                *it = cell.back();
+                cell.pop_back();
+            }
+        }
+    }
+}
+
+bool uniform_grid::contains(const uint32_t id) const
+{
+    return id < m_entries.size() && m_entries[id].used;
+}
+
+void uniform_grid::clear()
+{
+    for (auto& c : m_cells) c.clear();
+    m_entries.clear();
+    m_seen.clear();
+    m_count = 0;
+}
+
+void uniform_grid::insert(const uint32_t id, const rectangle& bounds)
+{
+    if (contains(id)) {
+        move(id, bounds);
+        return;
+    }
+
+    if (id >= m_entries.size()) {
+        m_entries.resize((size_t) id + 1, entry{ rectangle(), 0, 0, 0, 0, false });
+        m_seen.resize((size_t) id + 1, 0);
+    }
+
+    entry& e = m_entries[id];
+    e.bounds = bounds;
+    e.used = true;
+    cell_range(bounds, e.x0, e.y0, e.x1, e.y1);
+    link(id, e);
+    m_count++;
+}
+
+void uniform_grid::move(const uint32_t id, const rectangle& bounds)
+{
+    if (!contains(id)) return;
+
+    entry& e = m_entries[id];
+    e.bounds = bounds;
+
+    // Most moves stay within the same cells:
+    int x0, y0, x1, y1;
+    cell_range(bounds, x0, y0, x1, y1);
+    if (x0 == e.x0 && y0 == e.y0 && x1 == e.x1 && y1 == e.y1) return;
+
+    unlink(id, e);
+    e.x0 = x0;
+    e.y0 = y0;
+    e.x1 = x1;
+    e.y1 = y1;
+    link(id, e);
+}
+
+void uniform_grid::remove(const uint32_t id)
+{
+    if (!contains(id)) return;
+
+    entry& e = m_entries[id];
+    unlink(id, e);
+    e.used = false;
+    m_count--;
+}
+
+void uniform_grid::next_query() const
+{
+    // Stamps wrap after 4 billion queries, forget them all then:
+    if (++m_query == 0) {
+        std::fill(m_seen.begin(), m_seen.end(), 0);
+        m_query = 1;
+    }
+}
+
+bool uniform_grid::first_visit(const uint32_t id) const
+{
+    if (m_seen[id] == m_query) return false;
+    m_seen[id] = m_query;
+    return true;
+}
+
+size_t uniform_grid::query(const rectangle& area, std::vector<uint32_t>& hits) const
+{
+    const size_t before = hits.size();
+    next_query();
+
+    int x0, y0, x1, y1;
+    cell_range(area, x0, y0, x1, y1);
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            for (auto id : m_cells[(size_t) y * m_columns + x]) {
+                if (first_visit(id) && rectangle::has_intersection(area, m_entries[id].bounds)) hits.push_back(id);
+            }
+        }
+    }
+    return hits.size() - before;
+}
+
+size_t uniform_grid::query(const point& pt, std::vector<uint32_t>& hits) const
+{
+    // One cell, and nothing is listed twice in a cell:
+    const size_t before = hits.size();
+    int x0, y0, x1, y1;
+    cell_range(rectangle(pt.x, pt.y, 0, 0), x0, y0, x1, y1);
+    for (auto id : m_cells[(size_t) y0 * m_columns + x0]) {
+        if (m_entries[id].bounds.contains(pt)) hits.push_back(id);
+    }
+    return hits.size() - before;
+}
\ No newline at end of file
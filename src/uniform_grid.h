@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "rectangle.h"
+
+namespace spacetheory {
+
+    // Spatial index over a fixed area split into equal cells, each listing the
+    // entries overlapping it. Best when entries are similar in size and spread
+    // out evenly (tiles, particles, widgets on a panel); loose_quadtree copes
+    // better with a mix of sizes. Entries outside the area are kept in the
+    // border cells, so they're still found, just less efficiently.
+    //
+    // Entries are identified by the caller's own ids (entity or item indices),
+    // kept in arrays indexed by id, so ids should be small and dense. Queries
+    // follow rectangle::has_intersection and rectangle::contains.
+    class uniform_grid {
+    private:
+        struct entry {
+            rectangle bounds;
+            int x0, y0, x1, y1; // Cells covered, inclusive
+            bool used;
+        };
+
+        rectangle m_area;
+        int m_cell_size;
+        int m_columns, m_rows;
+        std::vector<std::vector<uint32_t>> m_cells;
+        std::vector<entry> m_entries;           // By id
+        mutable std::vector<uint32_t> m_seen;   // Query stamp by id, entries span cells
+        mutable uint32_t m_query;
+        size_t m_count;
+
+        void cell_range(const rectangle& bounds, int& x0, int& y0, int& x1, int& y1) const;
+        void link(const uint32_t id, const entry& e);
+        void unlink(const uint32_t id, const entry& e);
+        bool first_visit(const uint32_t id) const;
+        void next_query() const;
+
+    public:
+        // Cells a few times the typical entry (128 to 256 pixels for entries
+        // up to 64) keep view-sized queries fastest; smaller cells favour point
+        // queries but cost far more per insert and move. "demo --bench
+        // spatial_index" sweeps it:
+        uniform_grid(const rectangle& area, const int cell_size);
+
+        inline size_t size() const { return m_count; }
+        inline const rectangle& area() const { return m_area; }
+        bool contains(const uint32_t id) const;
+        void clear();
+
+        void insert(const uint32_t id, const rectangle& bounds); // Moves it if it's already there
+        void move(const uint32_t id, const rectangle& bounds);
+        void remove(const uint32_t id);
+
+        // Append the ids found and return how many, in no particular order:
+        size_t query(const rectangle& area, std::vector<uint32_t>& hits) const;
+        size_t query(const point& pt, std::vector<uint32_t>& hits) const;
+    };
+
+}
\ No newline at end of file
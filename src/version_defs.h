@@ -28,6 +28,7 @@
 #define SPACETHEORY_COPYRIGHT_SHORT     "Copyright  2018 John Tullos.\0"
 
 #define SPACETHEORY_LOGFILE             "engine.log"
+#define SPACETHEORY_ASYNC_LOGFILE       "engine.async.log"
 
 // KEEP EXTRA SPACES BELOW THIS LINE, IT'S A BUG WITH RESOURCE FILES INCLUDING
 // THIS HEADER CAUSING A "UNEXPECTED END OF FILE FOUND" ERROR